@@ -0,0 +1,573 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_FILE "benchbuffer.bin"
+
+// benchmark methods
+static void benchPinLatency (int maxFrames);
+static void benchMissIO (int numPages);
+static void benchScan (int numPages, bool mappedIO, bool directIO);
+static void benchFlush (int numPages);
+static void benchPageSizeScan (int numBytes, int pageSize);
+static void benchHitRatio (const char *name, ReplacementStrategy strategy, void *stratData);
+static void benchConcurrentPins (int numThreads, int numShards);
+static void benchCleaner (double cleanFraction);
+static void benchPrefetchScan (int numPages, int mode);
+static void benchPoolSetup (int numFrames);
+
+// helper methods
+static double elapsedNanos (struct timespec *start, struct timespec *end);
+static long runMixedWorkload (BM_BufferPool *bm, BM_PageHandle *h, bool interleaved);
+static void *runPinWorker (void *arg);
+static int compareDoubles (const void *left, const void *right);
+
+// work of one thread of benchConcurrentPins
+typedef struct PinWorker {
+  BM_BufferPool *bm;
+  unsigned int seed;
+  int numPins;
+} PinWorker;
+
+#define CONCURRENT_FRAMES 1024
+#define CONCURRENT_HOT_PAGES 512
+#define CLEANER_FRAMES 256
+#define CLEANER_PAGES 4096
+
+// main method, an optional argument caps the largest pool size
+int
+main (int argc, char **argv)
+{
+  int maxFrames = (argc > 1) ? atoi(argv[1]) : 100000;
+
+  initStorageManager();
+
+  benchPinLatency(maxFrames);
+  benchPoolSetup(10000);
+  benchMissIO(20000);
+  benchFlush(20000);
+
+  printf("\nscan of 5000 pages through a 100 frame pool\n");
+  benchScan(5000, false, false);
+  benchScan(5000, true, false);
+  benchScan(5000, false, true);
+
+  printf("\nscan of 5000 pages summing every byte, direct I/O into a 100 frame pool\n");
+  benchPrefetchScan(5000, 0);
+  benchPrefetchScan(5000, 1);
+  benchPrefetchScan(5000, 2);
+
+  printf("\nscan of 20 MB through a 100 frame pool by page size\n");
+  benchPageSizeScan(20 << 20, 4096);
+  benchPageSizeScan(20 << 20, 16384);
+  benchPageSizeScan(20 << 20, 65536);
+
+  int k = 2, agingPeriod = 1000;
+  printf("\nhit ratio of point lookups on 80 hot pages mixed with one-off scans, 100 frame pool\n");
+  printf("%-8s %11s %13s\n", "", "scan bursts", "interleaved");
+  benchHitRatio("FIFO", RS_FIFO, NULL);
+  benchHitRatio("LRU", RS_LRU, NULL);
+  benchHitRatio("CLOCK", RS_CLOCK, NULL);
+  benchHitRatio("LRU-2", RS_LRU_K, &k);
+  benchHitRatio("2Q", RS_2Q, NULL);
+  benchHitRatio("ARC", RS_ARC, NULL);
+  benchHitRatio("LFU", RS_LFU, NULL);
+  benchHitRatio("LFU aged", RS_LFU, &agingPeriod);
+
+  printf("\npin/unpin throughput on %d hot pages of a %d frame LRU pool, 1%% of pins dirty the page\n",
+         CONCURRENT_HOT_PAGES, CONCURRENT_FRAMES);
+  printf("%8s %8s %14s\n", "threads", "shards", "Mpins/s");
+  benchConcurrentPins(1, 0);
+  benchConcurrentPins(1, 1);
+  benchConcurrentPins(4, 1);
+  benchConcurrentPins(1, 16);
+  benchConcurrentPins(2, 16);
+  benchConcurrentPins(4, 16);
+  benchConcurrentPins(8, 16);
+
+  printf("\nrandom writes to %d pages through a %d frame LRU pool, every pin dirties its page\n",
+         CLEANER_PAGES, CLEANER_FRAMES);
+  printf("%-14s %10s %10s %10s\n", "writer", "avg ns", "p99 ns", "writes");
+  benchCleaner(0);
+  benchCleaner(0.25);
+
+  return 0;
+}
+
+// nanoseconds between two timestamps
+double
+elapsedNanos (struct timespec *start, struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+// average latency of a pin/unpin pair on a resident page for growing pool sizes
+void
+benchPinLatency (int maxFrames)
+{
+  const int numLookups = 1000000;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int numFrames, i;
+
+  printf("pin hit latency\n");
+  printf("%10s %12s\n", "frames", "ns/pin");
+
+  for (numFrames = 10; numFrames <= maxFrames; numFrames *= 10)
+    {
+      CHECK(createPageFile(BENCH_FILE));
+      CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_FIFO, NULL));
+
+      // make every frame resident
+      for (i = 0; i < numFrames; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          CHECK(unpinPage(bm, h, h->pageNum));
+        }
+
+      // pin resident pages in a scattered order
+      srand(42);
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (i = 0; i < numLookups; i++)
+        {
+          PageNumber pageNum = rand() % numFrames;
+          CHECK(pinPage(bm, h, pageNum));
+          CHECK(unpinPage(bm, h, pageNum));
+        }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      printf("%10d %12.1f\n", numFrames, elapsedNanos(&start, &end) / numLookups);
+
+      CHECK(shutdownBufferPool(bm));
+      CHECK(destroyPageFile(BENCH_FILE));
+    }
+
+  free(bm);
+  free(h);
+}
+
+// cost of page misses and write-backs through the pool's file handle
+void
+benchMissIO (int numPages)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, 10, RS_FIFO, NULL));
+
+  // every pin misses and every eviction writes a dirty page back
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numPages; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("\nmiss and write-back cost over %d pages\n", numPages);
+  printf("%-24s %12.1f\n", "ns per pin", elapsedNanos(&start, &end) / numPages);
+  printf("%-24s %12d\n", "read I/Os", getNumReadIO(bm));
+  printf("%-24s %12.1f\n", "ns per read I/O", (double) getReadIOTime(bm) / getNumReadIO(bm));
+  printf("%-24s %12d\n", "write I/Os", getNumWriteIO(bm));
+  printf("%-24s %12.1f\n", "ns per write I/O", (double) getWriteIOTime(bm) / getNumWriteIO(bm));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// forceFlushPool of a pool whose every frame is dirty, written as one batch
+void
+benchFlush (int numPages)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, numPages, RS_FIFO, NULL));
+  for (i = 0; i < numPages; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  CHECK(forceFlushPool(bm));
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("\nflush of %d dirty pages\n", numPages);
+  printf("%-24s %12.1f\n", "ns per page", elapsedNanos(&start, &end) / numPages);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// repeated scans of a file larger than the pool, copying pages, borrowing them from a mapping or reading them directly
+void
+benchScan (int numPages, bool mappedIO, bool directIO)
+{
+  const int numScans = 5;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .mappedIO = mappedIO, .directIO = directIO };
+  struct timespec start, end;
+  long checksum = 0;
+  int i, scan;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, 100, RS_FIFO, NULL));
+  for (i = 0; i < numPages; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, 100, RS_FIFO, NULL, &options));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (scan = 0; scan < numScans; scan++)
+    for (i = 0; i < numPages; i++)
+      {
+        CHECK(pinPage(bm, h, i));
+        checksum += h->data[5];
+        CHECK(unpinPage(bm, h, h->pageNum));
+      }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-24s %12.1f ns/page (checksum %ld)\n", mappedIO ? "mapped" : directIO ? "direct into frames" : "read into frames",
+         elapsedNanos(&start, &end) / (numScans * numPages), checksum);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// repeated scans of the same number of bytes stored in pages of different sizes
+void
+benchPageSizeScan (int numBytes, int pageSize)
+{
+  const int numScans = 5;
+  int numPages = numBytes / pageSize;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  long checksum = 0;
+  int i, scan;
+
+  CHECK(createPageFileWithPageSize(BENCH_FILE, pageSize));
+  CHECK(initBufferPool(bm, BENCH_FILE, 100, RS_FIFO, NULL));
+  for (i = 0; i < numPages; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, BENCH_FILE, 100, RS_FIFO, NULL));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (scan = 0; scan < numScans; scan++)
+    for (i = 0; i < numPages; i++)
+      {
+        CHECK(pinPage(bm, h, i));
+        checksum += h->data[5];
+        CHECK(unpinPage(bm, h, h->pageNum));
+      }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%7d byte pages %9.1f ns/KB %8d reads (checksum %ld)\n", pageSize,
+         elapsedNanos(&start, &end) / (numScans * (numBytes / 1024.0)), getNumReadIO(bm), checksum);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// pins of a workload mixing random lookups on a hot set with sequential reads of cold pages, the scan runs in bursts or a page at a time between lookups
+long
+runMixedWorkload (BM_BufferPool *bm, BM_PageHandle *h, bool interleaved)
+{
+  const int numRounds = 200, numLookups = 300, hotPages = 80, scanPages = 200, coldPages = 4000;
+  long pins = 0, scanned = 0;
+  int round, i;
+
+  srand(42);
+  for (round = 0; round < numRounds; round++)
+    for (i = 0; i < numLookups + scanPages; i++, pins++)
+      {
+        // 3 lookups for every 2 scanned pages, either all lookups first or mixed
+        bool lookup = interleaved ? (i % 5 < 3) : (i < numLookups);
+        PageNumber pageNum = lookup ? rand() % hotPages : hotPages + scanned++ % coldPages;
+        CHECK(pinPage(bm, h, pageNum));
+        CHECK(unpinPage(bm, h, h->pageNum));
+      }
+  return pins;
+}
+
+// hit ratio of the mixed workload for a replacement strategy, at most 60% since scanned pages always miss
+void
+benchHitRatio (const char *name, ReplacementStrategy strategy, void *stratData)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  double hits[2];
+  long pins = 0;
+  int interleaved;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (interleaved = 0; interleaved < 2; interleaved++)
+    {
+      CHECK(createPageFile(BENCH_FILE));
+      CHECK(initBufferPool(bm, BENCH_FILE, 100, strategy, stratData));
+      long workloadPins = runMixedWorkload(bm, h, interleaved);
+      hits[interleaved] = 100.0 * (workloadPins - getNumReadIO(bm)) / workloadPins;
+      pins += workloadPins;
+      CHECK(shutdownBufferPool(bm));
+      CHECK(destroyPageFile(BENCH_FILE));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-8s %10.2f%% %12.2f%% %9.1f ns/pin\n", name, hits[0], hits[1], elapsedNanos(&start, &end) / pins);
+
+  free(bm);
+  free(h);
+}
+
+// random pins and unpins of the hot pages, run by every thread of benchConcurrentPins
+void *
+runPinWorker (void *arg)
+{
+  PinWorker *worker = arg;
+  BM_PageHandle h;
+  int i;
+
+  for (i = 0; i < worker->numPins; i++)
+    {
+      PageNumber pageNum = rand_r(&worker->seed) % CONCURRENT_HOT_PAGES;
+      CHECK(pinPage(worker->bm, &h, pageNum));
+      if (i % 100 == 0)
+        CHECK(markDirty(worker->bm, &h, pageNum));
+      CHECK(unpinPage(worker->bm, &h, pageNum));
+    }
+  return NULL;
+}
+
+// pin throughput of a thread-safe pool for a number of threads and shards, 0 shards is the single-threaded pool
+void
+benchConcurrentPins (int numThreads, int numShards)
+{
+  const int pinsPerThread = 1000000;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .shards = numShards };
+  PinWorker workers[8];
+  pthread_t threads[8];
+  struct timespec start, end;
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, CONCURRENT_FRAMES, RS_LRU, NULL, &options));
+  for (i = 0; i < CONCURRENT_HOT_PAGES; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numThreads; i++)
+    {
+      workers[i].bm = bm;
+      workers[i].seed = 42 + i;
+      workers[i].numPins = pinsPerThread;
+      pthread_create(&threads[i], NULL, runPinWorker, &workers[i]);
+    }
+  for (i = 0; i < numThreads; i++)
+    pthread_join(threads[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%8d %8d %14.2f\n", numThreads, numShards,
+         1e3 * numThreads * pinsPerThread / elapsedNanos(&start, &end));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// order of pin latencies for the percentile of benchCleaner
+int
+compareDoubles (const void *left, const void *right)
+{
+  double l = *(const double *) left, r = *(const double *) right;
+  return (l > r) - (l < r);
+}
+
+// pin latency when dirty victims are written by the pinning thread or ahead of time by the background writer
+void
+benchCleaner (double cleanFraction)
+{
+  const int numPins = 100000;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .shards = 1, .cleanFraction = cleanFraction, .cleanIntervalMs = 1 };
+  double *latencies = malloc(sizeof(double) * numPins);
+  struct timespec start, end;
+  unsigned int seed = 42;
+  double total = 0;
+  char name[32];
+  int i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, CLEANER_FRAMES, RS_LRU, NULL, &options));
+  CHECK(pinPage(bm, h, CLEANER_PAGES - 1)); // grow the file up front so pins only cost reads and writes
+  CHECK(unpinPage(bm, h, h->pageNum));
+
+  for (i = 0; i < numPins; i++)
+    {
+      PageNumber pageNum = rand_r(&seed) % CLEANER_PAGES;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      CHECK(pinPage(bm, h, pageNum));
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      h->data[0] = 'x';
+      CHECK(markDirty(bm, h, pageNum));
+      CHECK(unpinPage(bm, h, pageNum));
+      latencies[i] = elapsedNanos(&start, &end);
+      total += latencies[i];
+    }
+  qsort(latencies, numPins, sizeof(double), compareDoubles);
+
+  if (cleanFraction > 0)
+    sprintf(name, "cleaner %.0f%%", 100 * cleanFraction);
+  else
+    sprintf(name, "pinning thread");
+  printf("%-14s %10.0f %10.0f %10d\n", name, total / numPins, latencies[numPins * 99 / 100], getNumWriteIO(bm));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(latencies);
+  free(bm);
+  free(h);
+}
+
+// scan that works on every page: pins only, read-ahead of 16 page windows, or prefetches that keep 8 to 16 pages in flight
+void
+benchPrefetchScan (int numPages, int mode)
+{
+  const char *names[] = { "pins only", "read-ahead windows", "prefetch in flight" };
+  const int window = 16;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .directIO = true };
+  struct timespec start, end;
+  long checksum = 0;
+  int i, j;
+
+  CHECK(createPageFile(BENCH_FILE));
+  CHECK(initBufferPool(bm, BENCH_FILE, 100, RS_FIFO, NULL));
+  for (i = 0; i < numPages; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      memset(h->data, i, PAGE_SIZE);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPoolWithOptions(bm, BENCH_FILE, 100, RS_FIFO, NULL, &options));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numPages; i++)
+    {
+      if (mode == 1 && i % window == 0)
+        {
+          CHECK(readAheadPages(bm, i, window));
+        }
+      else if (mode == 2 && i % (window / 2) == 0)
+        {
+          CHECK(prefetchPages(bm, i, window));
+        }
+      CHECK(pinPage(bm, h, i));
+      for (j = 0; j < PAGE_SIZE; j++)
+        checksum += (unsigned char) h->data[j];
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("%-24s %12.1f ns/page (checksum %ld)\n", names[mode], elapsedNanos(&start, &end) / numPages, checksum);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  free(bm);
+  free(h);
+}
+
+// time to create and shut down an empty pool, then to scan the frames' pages once
+void
+benchPoolSetup (int numFrames)
+{
+  const int numRounds = 20;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  struct timespec start, end;
+  double setupNanos = 0, scanNanos = 0;
+  int round, i;
+
+  CHECK(createPageFile(BENCH_FILE));
+  for (round = 0; round < numRounds; round++)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_CLOCK, NULL));
+      CHECK(shutdownBufferPool(bm));
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      setupNanos += elapsedNanos(&start, &end);
+    }
+
+  // first touch of every frame's page, pages are new so nothing is read
+  CHECK(initBufferPool(bm, BENCH_FILE, numFrames, RS_CLOCK, NULL));
+  CHECK(ensureCapacity(numFrames, &bm->fH));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (i = 0; i < numFrames; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h, i));
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  scanNanos = elapsedNanos(&start, &end);
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile(BENCH_FILE));
+
+  printf("\n%d frame pool: init+shutdown %.1f us, first pin of every frame %.1f us\n",
+         numFrames, setupNanos / numRounds / 1000, scanNanos / 1000);
+
+  free(bm);
+  free(h);
+}
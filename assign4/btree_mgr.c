@@ -488,7 +488,8 @@ RC openBtree(BTreeHandle **tree, char *idxId)
     if (*tree == NULL)
         return RC_WRITE_FAILED;
 
-    rc = initBufferPool(bm, idxId, 10, RS_CLOCK, NULL);
+    BM_PoolOptions options = { .shared = true };
+    rc = initBufferPoolWithOptions(bm, idxId, 10, RS_CLOCK, NULL, &options);
     if (rc != RC_OK)
         return rc;
 
@@ -592,6 +593,15 @@ RC getKeyType(BTreeHandle *tree, DataType *result)
     return RC_OK;
 }
 
+RC resizeIndexBuffer(BTreeHandle *tree, int numPages)
+{
+    if (tree == NULL)
+        return RC_IM_KEY_NOT_FOUND;
+
+    RM_bTree_mgmtData *meta = (RM_bTree_mgmtData *)tree->mgmtData;
+    return resizeBufferPool(meta->bp, numPages);
+}
+
 
 RM_BtreeNode *findKey_locateLeafNode(BTreeHandle *tree, Value *key)
 {
@@ -53,6 +53,7 @@ extern RC createBtree (char *idxId, DataType keyType, int n);
 extern RC openBtree (BTreeHandle **tree, char *idxId);
 extern RC closeBtree (BTreeHandle *tree);
 extern RC deleteBtree (char *idxId);
+extern RC resizeIndexBuffer (BTreeHandle *tree, int numPages);
 
 // access information about a b-tree
 extern RC getNumNodes (BTreeHandle *tree, int *result);
@@ -5,11 +5,257 @@
 #include <string.h>
 // #include <stdbool.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/mman.h>
 
 /*
     // Helper functions for Pinning related functions
 */
 
+// Reading a monotonic clock in nanoseconds for the I/O latency counters
+long long currentTimeNanos()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// Adding one operation to a latency histogram, in the bucket of the highest power of two not above its nanoseconds
+void recordLatency(BM_LatencyHistogram *histogram, long long nanos)
+{
+    int bucket = (nanos > 1) ? 63 - __builtin_clzll((unsigned long long)nanos) : 0;
+    if (bucket >= BM_LATENCY_BUCKETS)
+    {
+        bucket = BM_LATENCY_BUCKETS - 1;
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->totalNanos += nanos;
+    if (nanos > histogram->maxNanos)
+    {
+        histogram->maxNanos = nanos;
+    }
+}
+
+// Counting a pin that succeeded as a hit or a miss, timed from start if the pool times its pins
+void notePin(BufferManager *bufferManager, bool hit, long long start)
+{
+    if (hit)
+    {
+        bufferManager->pinHits++;
+    }
+    else
+    {
+        bufferManager->pinMisses++;
+    }
+    if (bufferManager->pinTiming)
+    {
+        recordLatency(hit ? &bufferManager->pinHitLatency : &bufferManager->pinMissLatency, currentTimeNanos() - start);
+    }
+}
+
+// Counting a wait of a pin that began at start, pins of every shard add to the pool's counters at once
+void notePinWait(BufferManager *bufferManager, long long start)
+{
+    __atomic_add_fetch(&bufferManager->pinWaits, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bufferManager->pinWaitNanos, currentTimeNanos() - start, __ATOMIC_RELAXED);
+}
+
+// Keys of the process-wide pool keep the page number in the low bits and the file's slot above them
+#define SHARED_PAGE_BITS 40
+#define SHARED_PAGE_MASK ((1LL << SHARED_PAGE_BITS) - 1)
+
+// The process-wide pool of initSharedBufferPool, its mgmtData is NULL while none is running
+static BM_BufferPool sharedPool;
+static pthread_mutex_t sharedRegistryLatch = PTHREAD_MUTEX_INITIALIZER; // Guards starting, stopping and the file slots
+
+// Finding the registered file a key of the process-wide pool belongs to, NULL in pools of a single file
+BM_SharedFile *fileOfKey(BufferManager *bufferManager, PageNumber key)
+{
+    if (bufferManager->sharedFiles == NULL || key < 0)
+    {
+        return NULL;
+    }
+    return &bufferManager->sharedFiles[key >> SHARED_PAGE_BITS];
+}
+
+// Finding the handle and page number a transfer of a frame's page goes through, pools of one file use their own handle
+SM_FileHandle *resolvePage(BufferManager *bufferManager, PageNumber key, SM_FileHandle *fHandle, PageNumber *pageNum)
+{
+    BM_SharedFile *file = fileOfKey(bufferManager, key);
+    *pageNum = (file != NULL) ? (key & SHARED_PAGE_MASK) : key;
+    return (file != NULL) ? file->fileHandle : fHandle;
+}
+
+// Counting finished transfers against the registered file they were for, a no-op in pools of a single file
+// Transfers run without any pool latch, so the counters are added to atomically like those of the pools
+void noteFileIO(BM_SharedFile *file, SM_IOType type, int pages, long long elapsed)
+{
+    if (file == NULL)
+    {
+        return;
+    }
+    if (type == SM_IO_READ)
+    {
+        __atomic_add_fetch(&file->readOperations, pages, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&file->readIOTime, elapsed, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_add_fetch(&file->writeOperations, pages, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&file->writeIOTime, elapsed, __ATOMIC_RELAXED);
+    }
+}
+
+// Finding the registration of a pool's file with the process-wide pool, NULL for pools with frames of their own
+BM_SharedFile *sharedFileOf(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = (bufferPool != NULL) ? bufferPool->mgmtData : NULL;
+    return (bufferManager != NULL) ? bufferManager->sharedFile : NULL;
+}
+
+// Turning a page of a registered file into its key, the operation then goes to the process-wide pool instead
+BM_BufferPool *targetPool(BM_BufferPool *const bufferPool, PageNumber *pageNum)
+{
+    BM_SharedFile *file = sharedFileOf(bufferPool);
+    if (file == NULL)
+    {
+        return bufferPool;
+    }
+    *pageNum += file->keyBase;
+    return &sharedPool;
+}
+
+// Copying a registered file's I/O counters into its pool, the file latch of the process-wide pool serializes the copies
+void gatherFileIO(BufferManager *bufferManager)
+{
+    BufferManager *sharedManager = sharedPool.mgmtData;
+    BM_SharedFile *file = bufferManager->sharedFile;
+    pthread_mutex_lock(&sharedManager->fileLatch);
+    bufferManager->readOperations = __atomic_load_n(&file->readOperations, __ATOMIC_RELAXED);
+    bufferManager->writeOperations = __atomic_load_n(&file->writeOperations, __ATOMIC_RELAXED);
+    bufferManager->readIOTime = __atomic_load_n(&file->readIOTime, __ATOMIC_RELAXED);
+    bufferManager->writeIOTime = __atomic_load_n(&file->writeIOTime, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&sharedManager->fileLatch);
+}
+
+// Sub-function to tell whether a frame holds a page of the given registered file
+bool holdsFilePage(BufferManager *shardManager, PageFrame *frame, BM_SharedFile *file)
+{
+    return frame->pageID != NO_PAGE && fileOfKey(shardManager, frame->pageID) == file;
+}
+
+// Counting a page of the process-wide pool in or out of the frames its file holds
+void noteFileResident(BufferManager *bufferManager, PageNumber key, int delta)
+{
+    BM_SharedFile *file = fileOfKey(bufferManager, key);
+    if (file != NULL)
+    {
+        __atomic_add_fetch(&file->resident, delta, __ATOMIC_RELAXED); // Shards change it under different latches
+    }
+}
+
+// Reading a block through the pool's file handle and accounting for its latency
+RC timedReadBlock(BufferManager *bufferManager, PageNumber pageNum, SM_FileHandle *fHandle, char *memPage)
+{
+    PageNumber filePage;
+    SM_FileHandle *fileHandle = resolvePage(bufferManager, pageNum, fHandle, &filePage);
+    long long start = currentTimeNanos();
+    RC result = readBlock(filePage, fileHandle, memPage);
+    long long elapsed = currentTimeNanos() - start;
+    __atomic_add_fetch(&bufferManager->readIOTime, elapsed, __ATOMIC_RELAXED);
+    noteFileIO(fileOfKey(bufferManager, pageNum), SM_IO_READ, (result == RC_OK) ? 1 : 0, elapsed);
+    return result;
+}
+
+// Writing a block through the pool's file handle and accounting for its latency
+RC timedWriteBlock(BufferManager *bufferManager, PageNumber pageNum, SM_FileHandle *fHandle, char *memPage)
+{
+    PageNumber filePage;
+    SM_FileHandle *fileHandle = resolvePage(bufferManager, pageNum, fHandle, &filePage);
+    long long start = currentTimeNanos();
+    RC result = writeBlock(filePage, fileHandle, memPage);
+    long long elapsed = currentTimeNanos() - start;
+    __atomic_add_fetch(&bufferManager->writeIOTime, elapsed, __ATOMIC_RELAXED);
+    noteFileIO(fileOfKey(bufferManager, pageNum), SM_IO_WRITE, (result == RC_OK) ? 1 : 0, elapsed);
+    return result;
+}
+
+// Submitting a batch of page transfers and waiting for all of them, timed as read or write I/O
+RC transferFileBatch(BufferManager *bufferManager, SM_FileHandle *fileHandle, SM_IORequest *requests, int count)
+{
+    if (count == 0)
+    {
+        return RC_OK;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        requests[i].completed = 0;
+    }
+
+    long long start = currentTimeNanos();
+    RC result = submitBlockIO(fileHandle, requests, count);
+    if (result == RC_OK)
+    {
+        result = waitBlockIO(fileHandle, requests, count);
+    }
+    else
+    {
+        reapBlockIO(fileHandle, count); // Collect whatever was already submitted
+    }
+    long long elapsed = currentTimeNanos() - start;
+
+    if (requests[0].type == SM_IO_READ)
+    {
+        __atomic_add_fetch(&bufferManager->readIOTime, elapsed, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_add_fetch(&bufferManager->writeIOTime, elapsed, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+// Submitting a batch whose page numbers are keys of the pool, the process-wide pool sends each file its own batch
+// Requests of one file next to each other share a batch, their page numbers are keys again on return
+RC transferBatch(BufferManager *bufferManager, SM_FileHandle *fileHandle, SM_IORequest *requests, int count)
+{
+    if (bufferManager->sharedFiles == NULL)
+    {
+        return transferFileBatch(bufferManager, fileHandle, requests, count);
+    }
+
+    RC result = RC_OK;
+    int batchStart = 0;
+    while (batchStart < count)
+    {
+        BM_SharedFile *file = fileOfKey(bufferManager, requests[batchStart].pageNum);
+        int batchEnd = batchStart;
+        while (batchEnd < count && fileOfKey(bufferManager, requests[batchEnd].pageNum) == file)
+        {
+            requests[batchEnd].pageNum &= SHARED_PAGE_MASK;
+            batchEnd++;
+        }
+
+        long long start = currentTimeNanos();
+        RC batchResult = transferFileBatch(bufferManager, file->fileHandle, requests + batchStart, batchEnd - batchStart);
+        int done = 0;
+        for (int i = batchStart; i < batchEnd; i++)
+        {
+            done += (requests[i].completed && requests[i].result == RC_OK) ? 1 : 0;
+            requests[i].pageNum += file->keyBase;
+        }
+        noteFileIO(file, requests[batchStart].type, done, currentTimeNanos() - start);
+        if (batchResult != RC_OK && result == RC_OK)
+        {
+            result = batchResult; // Keep going, report the first failure
+        }
+        batchStart = batchEnd;
+    }
+    return result;
+}
+
 // Displaying the current state of frames in the buffer
 void printBufferPoolFrames(BufferManager *bufferManager)
 {
@@ -20,7 +266,7 @@ void printBufferPoolFrames(BufferManager *bufferManager)
     do
     {
         printf("Frame %d:\n", frameCount);
-        printf("  Page ID: %d\n", currentFrame->pageID);
+        printf("  Page ID: %lld\n", currentFrame->pageID);
         printf("  Is Modified: %s\n", currentFrame->isModified ? "true" : "false");
         printf("  Reference Count: %d\n", currentFrame->referenceCount);
         printf("  Next Frame: %p\n", (void *)currentFrame->nextFrame);
@@ -36,1028 +282,5137 @@ void incrementFixCount(PageFrame *frame)
     frame->referenceCount++;
 }
 
-// Checking if a page is already pinned in the buffer
-PageFrame *alreadyPinned(BM_BufferPool *const bufferPool, const PageNumber pageID)
+/*
+    // Helper functions for the page table that maps a page number to its frame
+*/
+
+// Hashing a page number to its home slot (Fibonacci hashing)
+int pageTableHash(BufferManager *bufferManager, PageNumber pageID)
 {
-    BufferManager *bufferMgr = bufferPool->mgmtData;
-    PageFrame *currentFrame = bufferMgr->firstFrame;
+    unsigned long long key = (unsigned long long)pageID * 11400714819323198485ull;
+    return (int)(key >> (64 - bufferManager->pageTableBits));
+}
 
-    if (currentFrame == NULL)
+// Allocating an empty page table with at least twice as many slots as frames
+RC createPageTable(BufferManager *bufferManager, int totalFrames)
+{
+    int bits = 4;
+    while ((1 << bits) < totalFrames * 2)
     {
-        return NULL; // Return NULL if the buffer is empty
+        bits++;
     }
 
-    while (true)
+    bufferManager->pageTable = malloc(sizeof(PageTableEntry) << bits);
+    if (bufferManager->pageTable == NULL)
     {
-        if (currentFrame == NULL)
-        {
-            return NULL; // Return NULL if the buffer is empty
-        }
-        bool isFound = (currentFrame->pageID == pageID); // Check if the current frame matches the pageID
-
-        switch (isFound)
-        {
-        case true:
-            incrementFixCount(currentFrame);
-            return currentFrame; // Page is already pinned
-        case false:
-            // Continue checking the next frame
-            break;
-        }
-
-        currentFrame = currentFrame->nextFrame; // Move to the next frame
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    bufferManager->pageTableSize = 1 << bits;
+    bufferManager->pageTableBits = bits;
 
-        // Check if we have looped back to the first frame
-        if (currentFrame == bufferMgr->firstFrame)
-        {
-            return NULL; // Page not found
-        }
+    for (int i = 0; i < bufferManager->pageTableSize; i++)
+    {
+        bufferManager->pageTable[i].pageID = NO_PAGE; // Every slot starts empty
+        bufferManager->pageTable[i].frame = NULL;
     }
+    return RC_OK;
 }
 
-// Writing a dirty page back to disk
-RC handleDirtyFrame(PageFrame *framePtr, SM_FileHandle *fileHandle, BufferManager *buffer)
+// Finding the frame that holds a page, NULL if the page is not resident
+PageFrame *pageTableLookup(BufferManager *bufferManager, PageNumber pageID)
 {
-    if (framePtr->isModified)
+    int mask = bufferManager->pageTableSize - 1;
+    int slot = pageTableHash(bufferManager, pageID);
+
+    // Probe linearly until the page or an empty slot is found
+    while (bufferManager->pageTable[slot].pageID != NO_PAGE)
     {
-        RC result = writeBlock(framePtr->pageID, fileHandle, framePtr->pageData);
-        if (result != RC_OK)
-        {
-            return result;
-        }
-        else
+        if (bufferManager->pageTable[slot].pageID == pageID)
         {
-            framePtr->isModified = false; // Clearing the modified flag
-            buffer->writeOperations++;    // Incrementing write operation count
+            return bufferManager->pageTable[slot].frame;
         }
+        slot = (slot + 1) & mask;
     }
-    return RC_OK;
+    return NULL;
 }
 
-// Loading a page from disk and pinning it in memory
-RC readAndPinPage(PageFrame *framePtr, PageNumber pageID, SM_FileHandle *fileHandle, BufferManager *buffer)
+// Recording that a page now lives in the given frame
+void pageTableInsert(BufferManager *bufferManager, PageNumber pageID, PageFrame *frame)
 {
-    RC result = readBlock(pageID, fileHandle, framePtr->pageData);
-    if (result != RC_OK)
+    int mask = bufferManager->pageTableSize - 1;
+    int slot = pageTableHash(bufferManager, pageID);
+
+    while (bufferManager->pageTable[slot].pageID != NO_PAGE && bufferManager->pageTable[slot].pageID != pageID)
     {
-        return result;
+        slot = (slot + 1) & mask;
     }
-    else
+    if (bufferManager->pageTable[slot].pageID == NO_PAGE)
     {
-        buffer->readOperations++;   // Incrementing read operation count
-        framePtr->pageID = pageID;  // Setting the page ID
-        framePtr->referenceCount++; // Increasing the reference count
+        noteFileResident(bufferManager, pageID, 1);
     }
-    return RC_OK;
+    bufferManager->pageTable[slot].pageID = pageID;
+    bufferManager->pageTable[slot].frame = frame;
 }
 
-void printFrameDetails(BufferManager *bufferManager)
+// Forgetting a page, shifting later entries of its probe chain back into the hole
+void pageTableRemove(BufferManager *bufferManager, PageNumber pageID)
 {
-    if (bufferManager == NULL || bufferManager->firstFrame == NULL)
-    {
-        printf("No frames available to print.\n");
-        return;
-    }
+    int mask = bufferManager->pageTableSize - 1;
+    int hole = pageTableHash(bufferManager, pageID);
 
-    PageFrame *currentFrame = bufferManager->firstFrame;
-    PageFrame *startFrame = currentFrame; // Store the starting frame to detect a full loop
-    int frameIndex = 0;
-
-    printf("Frame Details:\n");
-    do
+    while (bufferManager->pageTable[hole].pageID != pageID)
     {
-        printf("Frame %d:\n", frameIndex);
-        printf("  Address: %p\n", (void *)currentFrame); // Print frame address
-        printf("  Page ID: %d\n", currentFrame->pageID);
-        printf("  Is Modified: %s\n", currentFrame->isModified ? "true" : "false");
-        printf("  Reference Count: %d\n", currentFrame->referenceCount);
-        printf("  Accessed: %s\n", currentFrame->accessed ? "true" : "false");
-        printf("  Data: ");
-        for (int i = 0; i < PAGE_SIZE; i++)
+        if (bufferManager->pageTable[hole].pageID == NO_PAGE)
         {
-            printf("%c", currentFrame->pageData[i]); // Print data in the frame
+            return; // Page was not in the table
         }
-        printf("\n\n");
-
-        currentFrame = currentFrame->nextFrame; // Move to the next frame
-        frameIndex++;
-    } while (currentFrame != NULL && currentFrame != startFrame); // Check for full loop
-}
+        hole = (hole + 1) & mask;
+    }
+    noteFileResident(bufferManager, pageID, -1);
 
-// Function to write back the current frame if it's dirty
-RC writeBackIfDirty(PageFrame *currentFrame, SM_FileHandle *fHandle, BufferManager *bufferManager)
-{
-    if (currentFrame->isModified)
+    int next = (hole + 1) & mask;
+    while (bufferManager->pageTable[next].pageID != NO_PAGE)
     {
-        RC result = writeBlock(currentFrame->pageID, fHandle, currentFrame->pageData);
-        if (result != RC_OK)
+        int home = pageTableHash(bufferManager, bufferManager->pageTable[next].pageID);
+
+        // The entry may fill the hole only if the hole lies between its home slot and its current slot
+        if (((next - home) & mask) >= ((next - hole) & mask))
         {
-            return result; // Check for errors
+            bufferManager->pageTable[hole] = bufferManager->pageTable[next];
+            hole = next;
         }
-        currentFrame->isModified = false; // Reset the dirty flag
-        bufferManager->writeOperations++; // Increment write operations
+        next = (next + 1) & mask;
     }
-    return RC_OK; // Return success
+    bufferManager->pageTable[hole].pageID = NO_PAGE;
+    bufferManager->pageTable[hole].frame = NULL;
 }
 
-// Function to read the requested page into the current frame
-RC readPageIntoFrame(PageFrame *currentFrame, int pageNum, SM_FileHandle *fHandle, BufferManager *bufferManager)
-{
-    // Attempt to read the block from the file
-    RC result = readBlock(pageNum, fHandle, currentFrame->pageData);
-    if (result == RC_READ_NON_EXISTING_PAGE)
-    {
-        return RC_READ_NON_EXISTING_PAGE; // Return specific error for non-existing page
-    }
-    else if (result != RC_OK)
-    {
-        return result; // Return any other error encountered
-    }
-
-    // If successful, increment the buffer manager's read operations
-    bufferManager->readOperations++;
+// Returned by a deferred pin whose victim has to be written back before its frame can take the page
+#define RC_BM_VICTIM_DIRTY 399
 
-    // Update the current frame with the newly loaded page details
-    currentFrame->pageID = pageNum;
-    currentFrame->referenceCount++;  // Increment the reference count
+/*
+    // Helper functions for the LRU-K replacement policy
+*/
 
-    return RC_OK; // Return success
-}
+// K used when initBufferPool gets no stratData for RS_LRU_K
+#define LRUK_DEFAULT_K 2
 
+// Back-to-back pins of the same page (one per record of a scan) are correlated and count as a single reference
+#define LRUK_CORRELATED_PERIOD 1
 
-RC pinThisPage(BM_BufferPool *const bm, PageFrame *currentFrame, PageNumber pageNum)
+// Hashing a page number to its home slot in the history table (Fibonacci hashing)
+int lrukHash(LRUKState *state, PageNumber pageID)
 {
-    // Accessing the buffer manager
-    BufferManager *bufferManager = bm->mgmtData;
+    unsigned long long key = (unsigned long long)pageID * 11400714819323198485ull;
+    return (int)(key >> (64 - state->tableBits));
+}
 
-    SM_FileHandle fHandle; // File handle for page operations
-    RC result;
+// Allocating the LRU-K state with room for a history per frame and as many retained ones
+RC createLRUKState(BufferManager *bufferManager, int totalFrames, void *strategyData)
+{
+    int k = (strategyData != NULL) ? *(int *)strategyData : LRUK_DEFAULT_K;
+    if (k < 1)
+    {
+        return RC_WRITE_FAILED; // K counts at least the last reference
+    }
 
-    // Open the page file
-    result = openPageFile(bm->pageFile, &fHandle);
-    if (result != RC_OK)
+    LRUKState *state = calloc(1, sizeof(LRUKState));
+    if (state == NULL)
     {
-        return result; // Return error if file opening fails
+        return RC_MEMORY_ALLOCATION_ERROR;
     }
+    state->k = k;
+    state->retainedLimit = totalFrames;
 
-    // Ensure the file has enough pages to accommodate the requested page
-    result = ensureCapacity(pageNum, &fHandle);
-    if (result != RC_OK)
+    // Twice as many slots as histories keeps probe chains short
+    int bits = 4;
+    while ((1 << bits) < (totalFrames + state->retainedLimit) * 2)
     {
-        closePageFile(&fHandle); // Close the file handle on error
-        return result;
+        bits++;
+    }
+    state->tableSize = 1 << bits;
+    state->tableBits = bits;
+    state->table = malloc(sizeof(LRUKHistory) * state->tableSize);
+    state->timeSlab = calloc((size_t)state->tableSize * k, sizeof(long long));
+    state->retainedPages = malloc(sizeof(PageNumber) * state->retainedLimit);
+    state->retainedSeq = malloc(sizeof(long long) * state->retainedLimit);
+    if (state->table == NULL || state->timeSlab == NULL || state->retainedPages == NULL || state->retainedSeq == NULL)
+    {
+        free(state->table);
+        free(state->timeSlab);
+        free(state->retainedPages);
+        free(state->retainedSeq);
+        free(state);
+        return RC_MEMORY_ALLOCATION_ERROR;
     }
 
-    // Write the current frame back to disk if it's dirty
-    result = writeBackIfDirty(currentFrame, &fHandle, bufferManager);
-    if (result != RC_OK)
+    for (int i = 0; i < state->tableSize; i++)
     {
-        closePageFile(&fHandle); // Close the file handle on error
-        return result;
+        state->table[i].pageID = NO_PAGE; // Every slot starts empty
+        state->table[i].times = state->timeSlab + (size_t)i * k;
     }
+    bufferManager->lruK = state;
+    return RC_OK;
+}
 
-    // Read the requested page into the current frame
-    result = readPageIntoFrame(currentFrame, pageNum, &fHandle, bufferManager);
-    if (result == RC_READ_NON_EXISTING_PAGE)
+// Freeing the LRU-K state of a pool
+void freeLRUKState(BufferManager *bufferManager)
+{
+    LRUKState *state = bufferManager->lruK;
+    if (state != NULL)
     {
-        closePageFile(&fHandle);
-        return RC_READ_NON_EXISTING_PAGE; // Handle the specific error for non-existing page
+        free(state->table);
+        free(state->timeSlab);
+        free(state->retainedPages);
+        free(state->retainedSeq);
+        free(state);
+        bufferManager->lruK = NULL;
     }
-    else if (result != RC_OK)
+}
+
+// Finding the history of a page, NULL if none is kept
+LRUKHistory *lrukLookup(LRUKState *state, PageNumber pageID)
+{
+    int mask = state->tableSize - 1;
+    int slot = lrukHash(state, pageID);
+
+    while (state->table[slot].pageID != NO_PAGE)
     {
-        closePageFile(&fHandle); // Close the file handle on error
-        return result;           // Return other errors
+        if (state->table[slot].pageID == pageID)
+        {
+            return &state->table[slot];
+        }
+        slot = (slot + 1) & mask;
     }
+    return NULL;
+}
 
-    // Update the page number for the current frame
-    currentFrame->pageID = pageNum;
+// Finding the history of a page, starting an empty one if none is kept
+LRUKHistory *lrukLookupOrInsert(LRUKState *state, PageNumber pageID)
+{
+    int mask = state->tableSize - 1;
+    int slot = lrukHash(state, pageID);
 
-    // Close the file handle
-    closePageFile(&fHandle);
+    while (state->table[slot].pageID != NO_PAGE && state->table[slot].pageID != pageID)
+    {
+        slot = (slot + 1) & mask;
+    }
 
-    return RC_OK; // Return success if all operations are successful
+    LRUKHistory *history = &state->table[slot];
+    if (history->pageID == NO_PAGE)
+    {
+        history->pageID = pageID;
+        memset(history->times, 0, sizeof(long long) * state->k);
+        history->last = 0;
+        history->retainedAt = 0;
+    }
+    return history;
 }
 
-/*
-    // Helper functions based on Pinning Frame with different strategies like FIFO and LRU Stategies
-*/
-
-bool findAvailableFrame(BufferManager *buffer, PageFrame **framePtr)
+// Dropping the history of a page, shifting later entries of its probe chain back into the hole
+void lrukRemove(LRUKState *state, PageNumber pageID)
 {
-    PageFrame *currentFrame = buffer->firstFrame;
+    int mask = state->tableSize - 1;
+    int hole = lrukHash(state, pageID);
 
-    // Loop to find an available frame
-    do
+    while (state->table[hole].pageID != pageID)
     {
-        switch (currentFrame->referenceCount)
+        if (state->table[hole].pageID == NO_PAGE)
         {
-        case 0:
-            *framePtr = currentFrame; // Assign the found frame to framePtr
-            return true;              // Found an available frame
-        default:
-            // Do nothing, will continue to the next frame
-            break;
+            return; // No history kept for the page
         }
+        hole = (hole + 1) & mask;
+    }
 
-        currentFrame = currentFrame->nextFrame; // Move to the next frame
-
-        switch ((currentFrame == buffer->firstFrame)? 1 : 0)
+    int next = (hole + 1) & mask;
+    while (state->table[next].pageID != NO_PAGE)
+    {
+        int home = lrukHash(state, state->table[next].pageID);
+        if (((next - home) & mask) >= ((next - hole) & mask))
         {
-        case 1:
-            *framePtr = NULL; // No available frame found
-            return false;     // Indicate that no frame was found
-        case 0:
-            break; 
-        default:
-            break; // Continue looping if not back at the first frame
+            // Swap instead of copy, so every slot keeps owning one array of times
+            LRUKHistory moved = state->table[next];
+            state->table[next] = state->table[hole];
+            state->table[hole] = moved;
+            hole = next;
         }
+        next = (next + 1) & mask;
+    }
+    state->table[hole].pageID = NO_PAGE;
+}
 
-    } while (true); // Infinite loop, will return from inside
+// Recording a pin of a page, correlated pins only move its last reference time
+void lrukReference(LRUKState *state, PageNumber pageID)
+{
+    LRUKHistory *history = lrukLookupOrInsert(state, pageID);
+    long long now = ++state->clock;
 
-    // This line is never reached, included for clarity
-    *framePtr = NULL;
-    return false; // Indicate that no frame was found
+    history->retainedAt = 0; // Resident again, the ring entry from its eviction goes stale
+    if (history->times[0] != 0 && now - history->last <= LRUK_CORRELATED_PERIOD)
+    {
+        history->last = now;
+        return;
+    }
+
+    memmove(history->times + 1, history->times, sizeof(long long) * (state->k - 1));
+    history->times[0] = now;
+    history->last = now;
 }
 
-void updateFrameList(BufferManager *buffer, PageFrame *currentFrame)
+// Keeping the history of an evicted page for a while, the oldest retained history makes room
+void lrukRetain(LRUKState *state, PageNumber pageID)
 {
-    if (currentFrame == buffer->firstFrame)
+    LRUKHistory *history = lrukLookup(state, pageID);
+    if (history == NULL)
     {
-        buffer->firstFrame = currentFrame->nextFrame;
+        return; // Loaded by read-ahead and never pinned
     }
 
-    switch (1)
+    if (state->retainedCount == state->retainedLimit)
     {
-    case 1:
-        currentFrame->prevFrame->nextFrame = currentFrame->nextFrame;
-        break;
+        // Only drop the oldest history if it was not referenced again since it was retained
+        PageNumber oldest = state->retainedPages[state->retainedHead];
+        LRUKHistory *old = lrukLookup(state, oldest);
+        if (old != NULL && old->retainedAt == state->retainedSeq[state->retainedHead])
+        {
+            lrukRemove(state, oldest);
+            history = lrukLookup(state, pageID); // Removal may have moved the entry
+        }
+        state->retainedHead = (state->retainedHead + 1) % state->retainedLimit;
+        state->retainedCount--;
     }
 
-    switch (1)
+    history->retainedAt = ++state->evictions;
+    int tail = (state->retainedHead + state->retainedCount) % state->retainedLimit;
+    state->retainedPages[tail] = pageID;
+    state->retainedSeq[tail] = history->retainedAt;
+    state->retainedCount++;
+}
+
+// Choosing the unpinned frame whose K-th most recent reference is oldest, pages seen fewer than K times go first in LRU order
+PageFrame *lrukChooseVictim(BufferManager *bufferManager)
+{
+    LRUKState *state = bufferManager->lruK;
+    PageFrame *currentFrame = bufferManager->firstFrame;
+    PageFrame *victim = NULL;
+    long long victimKth = 0;
+    long long victimLast = 0;
+
+    do
     {
-    case 1:
-        currentFrame->nextFrame->prevFrame = currentFrame->prevFrame;
-        break;
-    }
+        if (currentFrame->referenceCount == 0)
+        {
+            if (currentFrame->pageID == NO_PAGE)
+            {
+                return currentFrame; // Empty frames are used first
+            }
 
-    switch (1)
+            LRUKHistory *history = lrukLookup(state, currentFrame->pageID);
+            long long kth = (history != NULL) ? history->times[state->k - 1] : 0;
+            long long last = (history != NULL) ? history->last : 0;
+            if (victim == NULL || kth < victimKth || (kth == victimKth && last < victimLast))
+            {
+                victim = currentFrame;
+                victimKth = kth;
+                victimLast = last;
+            }
+        }
+        currentFrame = currentFrame->nextFrame;
+    } while (currentFrame != bufferManager->firstFrame);
+
+    return victim;
+}
+
+/*
+    // Helper functions for the 2Q and ARC replacement policies
+*/
+
+// Hashing a page number to its home slot in the queue index (Fibonacci hashing)
+int queueHash(QueuePolicy *policy, PageNumber pageID)
+{
+    unsigned long long key = (unsigned long long)pageID * 11400714819323198485ull;
+    return (int)(key >> (64 - policy->indexBits));
+}
+
+// Allocating empty queues, 2Q remembers half a pool of ghosts and ARC a whole pool
+RC createQueuePolicy(BufferManager *bufferManager, int totalFrames, ReplacementStrategy strategy)
+{
+    QueuePolicy *policy = calloc(1, sizeof(QueuePolicy));
+    if (policy == NULL)
     {
-    case 1:
-        currentFrame->prevFrame = buffer->lastFrame;
-        break;
+        return RC_MEMORY_ALLOCATION_ERROR;
     }
-
-    switch (1)
+    policy->strategy = strategy;
+    policy->frames = totalFrames;
+    policy->recentLimit = (totalFrames / 4 > 0) ? totalFrames / 4 : 1;
+    policy->ghostLimit = (strategy == RS_2Q) ? ((totalFrames / 2 > 0) ? totalFrames / 2 : 1) : totalFrames;
+    policy->target = 0;
+    policy->lastPage = NO_PAGE;
+    policy->freeCursor = bufferManager->firstFrame;
+    policy->capacity = totalFrames + policy->ghostLimit;
+
+    int bits = 4;
+    while ((1 << bits) < policy->capacity * 2)
     {
-    case 1:
-        buffer->lastFrame->nextFrame = currentFrame;
-        break;
+        bits++;
+    }
+    policy->indexSize = 1 << bits;
+    policy->indexBits = bits;
+    policy->nodes = malloc(sizeof(QueueNode) * policy->capacity);
+    policy->index = malloc(sizeof(int) * policy->indexSize);
+    if (policy->nodes == NULL || policy->index == NULL)
+    {
+        free(policy->nodes);
+        free(policy->index);
+        free(policy);
+        return RC_MEMORY_ALLOCATION_ERROR;
     }
 
-    switch (1)
+    for (int i = 0; i < policy->indexSize; i++)
     {
-    case 1:
-        buffer->lastFrame = currentFrame;
-        break;
+        policy->index[i] = -1; // Every slot starts empty
+    }
+    for (int i = 0; i < policy->capacity; i++)
+    {
+        policy->nodes[i].pageID = NO_PAGE;
+        policy->nodes[i].next = (i + 1 < policy->capacity) ? i + 1 : -1;
     }
+    policy->freeNode = 0;
+    for (int q = 0; q < QUEUE_COUNT; q++)
+    {
+        policy->queues[q].head = -1;
+        policy->queues[q].tail = -1;
+        policy->queues[q].size = 0;
+    }
+    bufferManager->queuePolicy = policy;
+    return RC_OK;
+}
 
-    switch (1)
+// Freeing the queues of a pool
+void freeQueuePolicy(BufferManager *bufferManager)
+{
+    QueuePolicy *policy = bufferManager->queuePolicy;
+    if (policy != NULL)
     {
-    case 1:
-        currentFrame->nextFrame = buffer->firstFrame;
-        break;
+        free(policy->nodes);
+        free(policy->index);
+        free(policy);
+        bufferManager->queuePolicy = NULL;
     }
+}
 
-    switch (1)
+// Finding the node of a page, -1 if the page is on no queue
+int queueLookup(QueuePolicy *policy, PageNumber pageID)
+{
+    int mask = policy->indexSize - 1;
+    int slot = queueHash(policy, pageID);
+
+    while (policy->index[slot] != -1)
     {
-    case 1:
-        buffer->firstFrame->prevFrame = currentFrame;
-        break;
+        if (policy->nodes[policy->index[slot]].pageID == pageID)
+        {
+            return policy->index[slot];
+        }
+        slot = (slot + 1) & mask;
     }
+    return -1;
 }
 
-void moveToTail(BM_BufferPool *bufferPool, PageFrame *currentFrame)
+// Unlinking a node from its queue
+void queueUnlink(QueuePolicy *policy, int node)
 {
-    BufferManager *buffer = bufferPool->mgmtData;
+    QueueNode *n = &policy->nodes[node];
+    PageQueue *queue = &policy->queues[n->queue];
 
-    if (currentFrame == buffer->firstFrame)
+    if (n->prev != -1)
     {
-        buffer->firstFrame = currentFrame->nextFrame;
+        policy->nodes[n->prev].next = n->next;
+    }
+    else
+    {
+        queue->head = n->next;
+    }
+    if (n->next != -1)
+    {
+        policy->nodes[n->next].prev = n->prev;
+    }
+    else
+    {
+        queue->tail = n->prev;
     }
+    queue->size--;
+}
 
-    switch (1)
+// Linking a node in as the newest of a queue
+void queuePushHead(QueuePolicy *policy, int node, int queueID)
+{
+    QueueNode *n = &policy->nodes[node];
+    PageQueue *queue = &policy->queues[queueID];
+
+    n->queue = queueID;
+    n->prev = -1;
+    n->next = queue->head;
+    if (queue->head != -1)
     {
-    case 1:
-        currentFrame->prevFrame->nextFrame = currentFrame->nextFrame;
-        break;
+        policy->nodes[queue->head].prev = node;
+    }
+    else
+    {
+        queue->tail = node;
     }
+    queue->head = node;
+    queue->size++;
+}
 
-    switch (1)
+// Moving a node to the newest end of a queue, possibly another one
+void queueMoveToHead(QueuePolicy *policy, int node, int queueID)
+{
+    queueUnlink(policy, node);
+    queuePushHead(policy, node, queueID);
+}
+
+// Forgetting a page, its node returns to the free list and later entries of its probe chain shift back
+void queueRemove(QueuePolicy *policy, int node)
+{
+    int mask = policy->indexSize - 1;
+    int hole = queueHash(policy, policy->nodes[node].pageID);
+
+    while (policy->index[hole] != node)
     {
-    case 1:
-        currentFrame->nextFrame->prevFrame = currentFrame->prevFrame;
-        break;
+        hole = (hole + 1) & mask;
     }
 
-    switch (1)
+    int next = (hole + 1) & mask;
+    while (policy->index[next] != -1)
     {
-    case 1:
-        currentFrame->prevFrame = buffer->lastFrame;
-        break;
+        int home = queueHash(policy, policy->nodes[policy->index[next]].pageID);
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            policy->index[hole] = policy->index[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
     }
+    policy->index[hole] = -1;
 
-    switch (1)
+    queueUnlink(policy, node);
+    policy->nodes[node].pageID = NO_PAGE;
+    policy->nodes[node].next = policy->freeNode;
+    policy->freeNode = node;
+}
+
+// Dropping the oldest ghost of a queue, if it has any
+void queueDropOldest(QueuePolicy *policy, int queueID)
+{
+    if (policy->queues[queueID].tail != -1)
     {
-    case 1:
-        buffer->lastFrame->nextFrame = currentFrame;
-        break;
+        queueRemove(policy, policy->queues[queueID].tail);
     }
+}
 
-    switch (1)
+// Adding a page as the newest of a queue, the oldest ghost makes room if every node is taken
+int queueInsert(QueuePolicy *policy, PageNumber pageID, int queueID)
+{
+    if (policy->freeNode == -1)
     {
-    case 1:
-        buffer->lastFrame = currentFrame;
-        break;
+        int ghosts = (policy->queues[QUEUE_FREQUENT_GHOST].size > 0) ? QUEUE_FREQUENT_GHOST : QUEUE_RECENT_GHOST;
+        queueDropOldest(policy, ghosts);
     }
 
-    switch (1)
+    int node = policy->freeNode;
+    policy->freeNode = policy->nodes[node].next;
+    policy->nodes[node].pageID = pageID;
+    policy->nodes[node].prefetched = false;
+
+    int mask = policy->indexSize - 1;
+    int slot = queueHash(policy, pageID);
+    while (policy->index[slot] != -1)
     {
-    case 1:
-        currentFrame->nextFrame = buffer->firstFrame;
-        break;
+        slot = (slot + 1) & mask;
     }
+    policy->index[slot] = node;
 
-    switch (1)
+    queuePushHead(policy, node, queueID);
+    return node;
+}
+
+// Finding the oldest page of a resident queue whose frame is not pinned
+PageFrame *queueOldestUnpinned(BufferManager *bufferManager, int queueID)
+{
+    QueuePolicy *policy = bufferManager->queuePolicy;
+    for (int node = policy->queues[queueID].tail; node != -1; node = policy->nodes[node].prev)
     {
-    case 1:
-        buffer->firstFrame->prevFrame = currentFrame;
-        break;
+        PageFrame *frame = pageTableLookup(bufferManager, policy->nodes[node].pageID);
+        if (frame != NULL && frame->referenceCount == 0)
+        {
+            return frame;
+        }
     }
+    return NULL;
 }
 
-// Sub-function to find a frame to pin using the CLOCK algorithm
-PageFrame *findFrameToPin(BufferManager *buffer)
+// Finding an empty frame while the pool is filling up, resuming where the last search stopped
+PageFrame *queueFindEmptyFrame(BufferManager *bufferManager)
 {
-    PageFrame *currentFrame = buffer->firstFrame;
+    QueuePolicy *policy = bufferManager->queuePolicy;
+    if (policy->queues[QUEUE_RECENT].size + policy->queues[QUEUE_FREQUENT].size >= policy->frames)
+    {
+        return NULL; // Every frame holds a page
+    }
+
+    PageFrame *start = policy->freeCursor;
+    PageFrame *currentFrame = start;
     do
     {
-        // Check if the frame is unpinned and can be replaced
-        if (currentFrame->referenceCount == 0)
+        if (currentFrame->pageID == NO_PAGE && currentFrame->referenceCount == 0)
         {
-            if (!currentFrame->accessed) // refbit is 0, ready to be replaced
-            {
-                return currentFrame; // Found a frame to pin
-            }
-            currentFrame->accessed = false; // Reset reference bit
+            policy->freeCursor = currentFrame->nextFrame;
+            return currentFrame;
         }
-
-        // Move to the next frame in the buffer
         currentFrame = currentFrame->nextFrame;
-
-    } while (currentFrame != buffer->firstFrame); // Loop until we've checked all frames
-
-    return NULL; // No available frame found for replacement
+    } while (currentFrame != start);
+    return NULL;
 }
 
-void updateLinkedList(BufferManager *bufferManager, PageFrame *currentFrame)
+// Adapting to a miss before a frame is chosen, ARC moves its target towards the ghost list that was hit
+void queueNoteMiss(QueuePolicy *policy, PageNumber pageID)
 {
-    if (currentFrame == bufferManager->firstFrame)
+    int node = queueLookup(policy, pageID);
+    if (policy->strategy != RS_ARC || node == -1)
     {
-        bufferManager->firstFrame = currentFrame->nextFrame;
+        return;
     }
 
-    switch (1)
+    int recentGhosts = policy->queues[QUEUE_RECENT_GHOST].size;
+    int frequentGhosts = policy->queues[QUEUE_FREQUENT_GHOST].size;
+    if (policy->nodes[node].queue == QUEUE_RECENT_GHOST)
     {
-    case 1:
-        currentFrame->prevFrame->nextFrame = currentFrame->nextFrame;
-        break;
+        // Recency would have helped, so T1 may grow
+        int delta = (frequentGhosts > recentGhosts) ? frequentGhosts / recentGhosts : 1;
+        policy->target = (policy->target + delta < policy->frames) ? policy->target + delta : policy->frames;
     }
-
-    switch (1)
+    else if (policy->nodes[node].queue == QUEUE_FREQUENT_GHOST)
     {
-    case 1:
-        currentFrame->nextFrame->prevFrame = currentFrame->prevFrame;
-        break;
+        // Frequency would have helped, so T2 may grow
+        int delta = (recentGhosts > frequentGhosts) ? recentGhosts / frequentGhosts : 1;
+        policy->target = (policy->target - delta > 0) ? policy->target - delta : 0;
     }
+}
 
-    switch (1)
+// Deciding which queue the next victim comes from, for a miss on pageID or NO_PAGE when no page is involved
+bool queueTakesRecentFirst(QueuePolicy *policy, PageNumber pageID)
+{
+    int recent = policy->queues[QUEUE_RECENT].size;
+    if (policy->strategy == RS_2Q)
     {
-    case 1:
-        currentFrame->prevFrame = bufferManager->lastFrame;
-        break;
+        // 2Q takes pages seen only once first, as long as their queue is over its share
+        return recent > policy->recentLimit;
     }
 
-    switch (1)
+    // ARC's REPLACE keeps T1 near its target, ties go to T1 when the page comes back from B2
+    int node = (pageID != NO_PAGE) ? queueLookup(policy, pageID) : -1;
+    bool inFrequentGhosts = (node != -1 && policy->nodes[node].queue == QUEUE_FREQUENT_GHOST);
+    return recent >= 1 && ((inFrequentGhosts && recent == policy->target) || recent > policy->target);
+}
+
+// Choosing the frame for a page that missed, an empty one while there is one, otherwise by the policy's rule
+PageFrame *queueChooseVictim(BufferManager *bufferManager, PageNumber pageID)
+{
+    PageFrame *victim = queueFindEmptyFrame(bufferManager);
+    if (victim != NULL)
     {
-    case 1:
-        bufferManager->lastFrame->nextFrame = currentFrame;
-        break;
+        return victim;
     }
 
-    switch (1)
+    // Pinned pages cannot leave, so fall back to the other queue
+    bool fromRecent = queueTakesRecentFirst(bufferManager->queuePolicy, pageID);
+    victim = queueOldestUnpinned(bufferManager, fromRecent ? QUEUE_RECENT : QUEUE_FREQUENT);
+    if (victim == NULL)
     {
-    case 1:
-        bufferManager->lastFrame = currentFrame;
-        break;
+        victim = queueOldestUnpinned(bufferManager, fromRecent ? QUEUE_FREQUENT : QUEUE_RECENT);
     }
+    return victim;
+}
 
-    switch (1)
+// Recording a pin of a resident page
+void queueNoteHit(QueuePolicy *policy, PageNumber pageID)
+{
+    int node = queueLookup(policy, pageID);
+    bool correlated = (pageID == policy->lastPage);
+    policy->lastPage = pageID;
+    if (node == -1)
     {
-    case 1:
-        currentFrame->nextFrame = bufferManager->firstFrame;
-        break;
+        return;
     }
 
-    switch (1)
+    QueueNode *n = &policy->nodes[node];
+    if (n->prefetched)
     {
-    case 1:
-        bufferManager->firstFrame->prevFrame = currentFrame;
-        break;
+        n->prefetched = false; // The first pin of a read-ahead page is its first reference
+        return;
+    }
+    if (n->queue == QUEUE_FREQUENT)
+    {
+        queueMoveToHead(policy, node, QUEUE_FREQUENT);
+    }
+    else if (policy->strategy == RS_ARC && !correlated)
+    {
+        // ARC promotes on the second reference, back-to-back pins (one per record of a scan) are one reference
+        queueMoveToHead(policy, node, QUEUE_FREQUENT);
     }
+    // 2Q leaves pages in A1in alone, their repeated pins are correlated by definition
 }
 
-/*
-    // Functions based on Pinning Frame with different strategies like FIFO and LRU Stategies
-*/
-
-RC pinFIFO(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageID, bool fromLRU)
+// Recording that a page was loaded into a frame, ghosts come back as frequent pages
+void queueNoteLoaded(QueuePolicy *policy, PageNumber pageID, bool prefetched)
 {
-    // Check if the page is already pinned
-    if (!fromLRU && alreadyPinned(bufferPool, pageID))
+    int node = queueLookup(policy, pageID);
+    if (!prefetched)
     {
-        return RC_OK;
+        policy->lastPage = pageID;
     }
-    else
+
+    if (node != -1 && policy->nodes[node].queue >= QUEUE_RECENT_GHOST)
     {
-        BufferManager *bufferManager = bufferPool->mgmtData;
-        PageFrame *availableFrame = NULL;                                      // Pointer to hold the available frame
-        bool isAvailable = findAvailableFrame(bufferManager, &availableFrame); // Call with correct parameters
+        queueMoveToHead(policy, node, QUEUE_FREQUENT);
+        policy->nodes[node].prefetched = prefetched;
+        return;
+    }
+    if (node != -1)
+    {
+        return; // Already resident
+    }
 
-        switch (!isAvailable ? 1 : 0)
+    if (policy->strategy == RS_ARC)
+    {
+        // Keep |T1| + |B1| below c and the whole directory below 2c before T1 grows
+        PageQueue *queues = policy->queues;
+        if (queues[QUEUE_RECENT].size + queues[QUEUE_RECENT_GHOST].size >= policy->frames)
         {
-        case 1:
-            return RC_IM_NO_MORE_ENTRIES;
-            break;
-
-        default:
-            break;
+            queueDropOldest(policy, QUEUE_RECENT_GHOST);
         }
-        // Pin the page to the found frame
-        RC result = pinThisPage(bufferPool, availableFrame, pageID);
-        int val = (result != RC_OK) ? 1 : 0;
-        switch (val)
+        if (queues[QUEUE_RECENT].size + queues[QUEUE_FREQUENT].size + queues[QUEUE_RECENT_GHOST].size + queues[QUEUE_FREQUENT_GHOST].size >= 2 * policy->frames)
         {
-        case 1:
-            return result;
-            break; 
-
-        default:
-            break;
+            queueDropOldest(policy, QUEUE_FREQUENT_GHOST);
         }
-        // Set page handle data
-        pageHandle->pageNum = pageID;
-        pageHandle->data = availableFrame->pageData;
-
-        // Update the linked list to move the pinned frame to the tail
-        updateLinkedList(bufferManager, availableFrame);
-
-        return RC_OK;
     }
+    node = queueInsert(policy, pageID, QUEUE_RECENT);
+    policy->nodes[node].prefetched = prefetched;
 }
 
-RC pinLRU(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle,
-          const PageNumber pageID)
+// Recording that a page left its frame, it becomes a ghost of the queue it was on
+void queueNoteEvicted(QueuePolicy *policy, PageNumber pageID)
 {
-    // Check if the page is already pinned
-    PageFrame *currentFrame = alreadyPinned(bufferPool, pageID);
-
-    if (currentFrame)
-    {
-        // If the page is already pinned, move it to the tail of the list
-        moveToTail(bufferPool, currentFrame);
-    }
-    else
+    int node = queueLookup(policy, pageID);
+    if (node == -1)
     {
-        // If the page is not pinned, use FIFO to pin the page
-        return pinFIFO(bufferPool, pageHandle, pageID, true);
+        return;
     }
 
-    // Update the page handle with the page number and data
-    pageHandle->pageNum = pageID;
-    pageHandle->data = currentFrame->pageData;
-
-    return RC_OK; // Return success
-}
-
-RC pinCLOCK(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum)
-{
-    PageFrame *selectedFrame = alreadyPinned(bufferPool, pageNum);
-    if (alreadyPinned(bufferPool, pageNum))
+    QueueNode *n = &policy->nodes[node];
+    if (n->queue == QUEUE_RECENT)
     {
-        pageHandle->pageNum = pageNum;
-        pageHandle->data = selectedFrame->pageData;
-        return RC_OK;
+        queueMoveToHead(policy, node, QUEUE_RECENT_GHOST);
+        if (policy->strategy == RS_2Q && policy->queues[QUEUE_RECENT_GHOST].size > policy->ghostLimit)
+        {
+            queueDropOldest(policy, QUEUE_RECENT_GHOST);
+        }
     }
-
-    BufferManager *buffer = bufferPool->mgmtData;
-    selectedFrame = findFrameToPin(buffer);
-
-    if (selectedFrame == NULL)
+    else if (n->queue == QUEUE_FREQUENT && policy->strategy == RS_ARC)
     {
-        return RC_IM_NO_MORE_ENTRIES; // No available frame
+        queueMoveToHead(policy, node, QUEUE_FREQUENT_GHOST);
     }
-
-    RC result = pinThisPage(bufferPool, selectedFrame, pageNum);
-    if (result != RC_OK)
+    else if (n->queue == QUEUE_FREQUENT)
     {
-        return result; // Return the error from pinning
+        queueRemove(policy, node); // 2Q forgets pages that fall out of Am
     }
-
-    pageHandle->pageNum = pageNum;
-    pageHandle->data = selectedFrame->pageData;
-
-
-    return RC_OK;
-}
-
-// Function not Implemented, minimun is to have two stategies
-RC pinLRUK(BM_BufferPool *const bm, BM_PageHandle *const page,
-           const PageNumber pageNum)
-{
-    return RC_OK;
 }
 
 /*
-    //Helper Functions for Mandatory functions required for the Assignment as defined in buffer_mgr.h
+    // Helper functions for the LFU replacement policy
 */
 
-// Helper function to create a new PageFrame
-PageFrame *createPageFrame()
+// Taking a bucket from the spares or allocating one
+LFUBucket *lfuNewBucket(LFUState *state, long long frequency)
 {
-    PageFrame *newFrame = malloc(sizeof(PageFrame));
-    if (newFrame != NULL)
+    LFUBucket *bucket = state->spareBuckets;
+    if (bucket != NULL)
     {
-        newFrame->pageID = NO_PAGE;
-        newFrame->isModified = false;
-        newFrame->referenceCount = 0;
-        memset(newFrame->pageData, '\0', PAGE_SIZE);
-        newFrame->nextFrame = NULL; // Initialize nextFrame pointer
-        newFrame->prevFrame = NULL; // Initialize prevFrame pointer
+        state->spareBuckets = bucket->higher;
     }
-    return newFrame; // Return the new page frame
+    else
+    {
+        bucket = malloc(sizeof(LFUBucket));
+        if (bucket == NULL)
+        {
+            return NULL;
+        }
+    }
+    bucket->frequency = frequency;
+    bucket->newest = NULL;
+    bucket->oldest = NULL;
+    bucket->higher = NULL;
+    bucket->lower = NULL;
+    return bucket;
 }
 
-// Helper function to create a new FrameStatistics
-FrameStatistics *createFrameStatistics(PageFrame *frame)
+// Finding the bucket for a frequency right above a given bucket (NULL for the bottom), creating it if needed
+LFUBucket *lfuBucketAbove(LFUState *state, LFUBucket *below, long long frequency)
 {
-    FrameStatistics *newStat = malloc(sizeof(FrameStatistics));
-    if (newStat != NULL)
+    LFUBucket *above = (below != NULL) ? below->higher : state->lowest;
+    if (above != NULL && above->frequency == frequency)
     {
-        newStat->currentFrame = frame;
-        newStat->nextStat = NULL; // Initialize nextStat pointer
+        return above;
     }
-    return newStat; // Return the new frame statistics
-}
 
-// Helper function to link two PageFrames
-void linkFrames(PageFrame *previous, PageFrame *next)
-{
-    previous->nextFrame = next; // Link the next frame
-    next->prevFrame = previous; // Link the previous frame
+    LFUBucket *bucket = lfuNewBucket(state, frequency);
+    if (bucket == NULL)
+    {
+        return NULL;
+    }
+    bucket->lower = below;
+    bucket->higher = above;
+    if (below != NULL)
+    {
+        below->higher = bucket;
+    }
+    else
+    {
+        state->lowest = bucket;
+    }
+    if (above != NULL)
+    {
+        above->lower = bucket;
+    }
+    return bucket;
 }
 
-// Helper function to add a new FrameStatistics to the list
-void addFrameToList(FrameStatistics *head, FrameStatistics *newStat)
+// Taking a frame out of its bucket, an emptied bucket goes back to the spares
+void lfuDetach(LFUState *state, PageFrame *frame)
 {
-    while (head->nextStat != NULL)
+    LFUBucket *bucket = frame->lfuBucket;
+    if (bucket == NULL)
     {
-        head = head->nextStat; // Traverse to the end of the list
+        return;
     }
-    head->nextStat = newStat; // Add the new statistics to the end
-}
 
-void completeCircularLink(BufferManager *bufferManager)
-{
-    int firstFrameExists = (bufferManager->firstFrame != NULL) ? 1 : 0;
-    switch (firstFrameExists)
+    if (frame->lfuNewer != NULL)
     {
-    case 1:
-        bufferManager->lastFrame = bufferManager->firstFrame;
+        frame->lfuNewer->lfuOlder = frame->lfuOlder;
+    }
+    else
+    {
+        bucket->newest = frame->lfuOlder;
+    }
+    if (frame->lfuOlder != NULL)
+    {
+        frame->lfuOlder->lfuNewer = frame->lfuNewer;
+    }
+    else
+    {
+        bucket->oldest = frame->lfuNewer;
+    }
+    frame->lfuBucket = NULL;
 
-        int lastFrameExists = (bufferManager->lastFrame != NULL) ? 1 : 0;
-        switch (lastFrameExists)
+    if (bucket->newest == NULL)
+    {
+        if (bucket->lower != NULL)
         {
-        case 1:
-            bufferManager->firstFrame->prevFrame = bufferManager->lastFrame;
-            bufferManager->lastFrame->nextFrame = bufferManager->firstFrame;
-            break;
-        default:
-            break;
+            bucket->lower->higher = bucket->higher;
         }
-        break;
-    default:
-        break;
+        else
+        {
+            state->lowest = bucket->higher;
+        }
+        if (bucket->higher != NULL)
+        {
+            bucket->higher->lower = bucket->lower;
+        }
+        bucket->higher = state->spareBuckets;
+        state->spareBuckets = bucket;
     }
 }
 
-// Helper function to free all PageFrames
-void freePageFrames(PageFrame *frame)
+// Adding a frame as the most recently referenced of a bucket
+void lfuAttach(PageFrame *frame, LFUBucket *bucket)
 {
-    while (frame != NULL)
+    frame->lfuBucket = bucket;
+    frame->lfuNewer = NULL;
+    frame->lfuOlder = bucket->newest;
+    if (bucket->newest != NULL)
     {
-        PageFrame *next = frame->nextFrame; // Keep track of next frame
-        free(frame);                        // Free current frame
-        frame = next;                       // Move to next frame
+        bucket->newest->lfuNewer = frame;
     }
+    else
+    {
+        bucket->oldest = frame;
+    }
+    bucket->newest = frame;
 }
 
-// Helper function to write a page to disk
-RC writePageToDisk(PageFrame *frame, SM_FileHandle *fileHandle)
+// Giving a frame a fresh count, 1 for a pinned page and 0 for an empty frame or a read-ahead page
+void lfuReset(LFUState *state, PageFrame *frame, long long frequency)
 {
-    return writeBlock(frame->pageID, fileHandle, frame->pageData); // Write the current page's data to disk
+    lfuDetach(state, frame);
+
+    // The bottom bucket is 0 or 1, so the new count goes at the bottom or right above it
+    LFUBucket *below = (state->lowest != NULL && state->lowest->frequency < frequency) ? state->lowest : NULL;
+    LFUBucket *bucket = lfuBucketAbove(state, below, frequency);
+    if (bucket != NULL)
+    {
+        lfuAttach(frame, bucket);
+    }
 }
 
-// Helper function to free all PageFrames in the buffer manager
-void freePageFramesShutdown(BufferManager *bufferManager)
+// Counting a reference to a resident page, its frame moves up one bucket
+void lfuTouch(LFUState *state, PageFrame *frame)
 {
-    PageFrame *currentFrame = bufferManager->firstFrame;
-    if (currentFrame == NULL)
+    LFUBucket *bucket = frame->lfuBucket;
+    if (bucket == NULL)
     {
-        return; // Nothing to free
+        return;
     }
 
-    PageFrame *nextFrame;
-    do
+    // The next bucket is created before the frame leaves, so the old one is still there to link it to
+    LFUBucket *next = lfuBucketAbove(state, bucket, bucket->frequency + 1);
+    if (next == NULL)
     {
-        nextFrame = currentFrame->nextFrame; // Keep track of the next frame
-        free(currentFrame);                  // Free the current frame
-        currentFrame = nextFrame;            // Move to the next frame
-    } while (currentFrame != bufferManager->firstFrame);
+        return;
+    }
+    lfuDetach(state, frame);
+    lfuAttach(frame, next);
 }
 
-// Helper function to flush dirty pages to disk
-RC flushDirtyPagesToDisk(BufferManager *bufferManager, SM_FileHandle *fileHandle)
+// Choosing the least recently referenced unpinned frame of the lowest bucket that has one
+PageFrame *lfuChooseVictim(BufferManager *bufferManager)
 {
-    if (bufferManager == NULL || fileHandle == NULL)
+    for (LFUBucket *bucket = bufferManager->lfu->lowest; bucket != NULL; bucket = bucket->higher)
     {
-        return RC_FILE_NOT_FOUND; // Ensure valid input
+        for (PageFrame *frame = bucket->oldest; frame != NULL; frame = frame->lfuNewer)
+        {
+            if (frame->referenceCount == 0)
+            {
+                return frame;
+            }
+        }
     }
+    return NULL;
+}
 
-    PageFrame *currentFrame = bufferManager->firstFrame; // Start from the first frame
-    RC result;
+// Halving every frequency (rounding up, so pages keep a count of at least 1), buckets that meet are merged
+void lfuAge(LFUState *state)
+{
+    LFUBucket *kept = NULL;
+    LFUBucket *bucket = state->lowest;
 
-    if (currentFrame == NULL)
+    while (bucket != NULL)
     {
-        return RC_FILE_NOT_FOUND; // No frames to process
-    }
+        LFUBucket *higher = bucket->higher;
+        long long frequency = (bucket->frequency + 1) / 2;
 
-    do
-    {
-        // Check if the page is dirty
-        if (currentFrame->isModified)
+        if (kept != NULL && kept->frequency == frequency)
         {
-            result = writePageToDisk(currentFrame, fileHandle);
-            if (result != RC_OK)
+            // Pages with the higher count join as the more recently referenced ones
+            for (PageFrame *frame = bucket->oldest; frame != NULL; frame = frame->lfuNewer)
             {
-                return result; // Return error if writing a dirty page fails
+                frame->lfuBucket = kept;
             }
-            currentFrame->isModified = false; // Mark page as clean after writing
-            switch (1)
+            bucket->oldest->lfuOlder = kept->newest;
+            kept->newest->lfuNewer = bucket->oldest;
+            kept->newest = bucket->newest;
+
+            kept->higher = higher;
+            if (higher != NULL)
             {
-            case 1:
-                bufferManager->writeOperations++;
-                break;
-            default:
-                break;
+                higher->lower = kept;
             }
+            bucket->higher = state->spareBuckets;
+            state->spareBuckets = bucket;
         }
+        else
+        {
+            bucket->frequency = frequency;
+            kept = bucket;
+        }
+        bucket = higher;
+    }
+}
 
-        currentFrame = currentFrame->nextFrame; // Move to the next page frame
-
-    } while (currentFrame != bufferManager->firstFrame); // Continue until we return to the first frame
-
-    return RC_OK; // Successfully flushed all dirty pages
+// Counting a pin towards the next aging
+void lfuTick(LFUState *state)
+{
+    if (state->agingPeriod > 0 && ++state->sinceAging >= state->agingPeriod)
+    {
+        lfuAge(state);
+        state->sinceAging = 0;
+    }
 }
 
-// Helper function to find the page frame for a specific page number
-PageFrame *findPageFrame(BufferManager *bufferManager, int pageNum)
+// Allocating the LFU state, every frame starts empty in the bucket of frequency 0
+RC createLFUState(BufferManager *bufferManager, int totalFrames, void *strategyData)
 {
+    int agingPeriod = (strategyData != NULL) ? *(int *)strategyData : 0;
+    if (agingPeriod < 0)
+    {
+        return RC_WRITE_FAILED; // 0 turns aging off, anything below makes no sense
+    }
 
-    PageFrame *currentFrame = bufferManager->firstFrame;
-    if (currentFrame == NULL) {
-        return NULL;
+    LFUState *state = calloc(1, sizeof(LFUState));
+    if (state == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
     }
+    state->agingPeriod = agingPeriod;
 
+    LFUBucket *empty = lfuNewBucket(state, 0);
+    if (empty == NULL)
+    {
+        free(state);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    state->lowest = empty;
 
-    // Iterate through the circular linked list to find the page frame
-    do
+    PageFrame *frame = bufferManager->firstFrame;
+    for (int i = 0; i < totalFrames; i++, frame = frame->nextFrame)
     {
+        lfuAttach(frame, empty);
+    }
+    bufferManager->lfu = state;
+    return RC_OK;
+}
 
-        // Check if the current frame's pageID matches the requested pageNum
-        int condition = (currentFrame->pageID == pageNum) ? 1 : 0; // Convert to integer for switch
+// Freeing the buckets of a pool
+void freeLFUState(BufferManager *bufferManager)
+{
+    LFUState *state = bufferManager->lfu;
+    if (state == NULL)
+    {
+        return;
+    }
 
-        switch (condition)
+    LFUBucket *lists[] = {state->lowest, state->spareBuckets};
+    for (int i = 0; i < 2; i++)
+    {
+        LFUBucket *bucket = lists[i];
+        while (bucket != NULL)
         {
-        case 1:
-            return currentFrame; // Return the page frame if found
-        case 0:
-            currentFrame = currentFrame->nextFrame; // Move to the next page frame
-            break;
-        default:
-            // No default case is necessary in this scenario
-            break;
+            LFUBucket *higher = bucket->higher;
+            free(bucket);
+            bucket = higher;
         }
-    } while (currentFrame != bufferManager->firstFrame);
-
-    return NULL; // Return NULL if the page frame is not found
+    }
+    free(state);
+    bufferManager->lfu = NULL;
 }
 
+// Letting the replacement policy know a page left the pool
+void notePageEvicted(BufferManager *bufferManager, PageNumber pageID)
+{
+    if (bufferManager->lruK != NULL)
+    {
+        lrukRetain(bufferManager->lruK, pageID);
+    }
+    if (bufferManager->queuePolicy != NULL)
+    {
+        queueNoteEvicted(bufferManager->queuePolicy, pageID);
+    }
+}
 
-RC updateFixCount(PageFrame *currentFrame)
+// Letting the replacement policy know a page was loaded without being pinned
+void notePagePrefetched(BufferManager *bufferManager, PageNumber pageID)
 {
-    switch (currentFrame->referenceCount)
+    if (bufferManager->queuePolicy != NULL)
     {
-    case 0:
-        return RC_READ_NON_EXISTING_PAGE; // Return error if fix count is already 0
-    default:
-        currentFrame->referenceCount--;
-        switch (currentFrame->referenceCount)
-        {
-        case 0:
-            currentFrame->accessed = false; // Reset accessed flag
-            break;
-        default:
-            break; // No action needed for referenceCount > 0
-        }
-        return RC_OK; // Successfully updated the fix count
+        queueNoteLoaded(bufferManager->queuePolicy, pageID, true);
+    }
+    if (bufferManager->lfu != NULL)
+    {
+        lfuReset(bufferManager->lfu, pageTableLookup(bufferManager, pageID), 0); // Counted from its first pin on
     }
 }
 
-RC writePageData(PageNumber pageNum, SM_FileHandle *fileHandle, char *data)
+// Moving a frame's page table entry from the page it held to the page it holds now
+void remapFrame(BufferManager *bufferManager, PageFrame *frame, PageNumber oldPageID)
 {
-    return writeBlock(pageNum, fileHandle, data);
+    if (oldPageID != NO_PAGE)
+    {
+        pageTableRemove(bufferManager, oldPageID);
+        notePageEvicted(bufferManager, oldPageID);
+        bufferManager->evictions++;
+    }
+    pageTableInsert(bufferManager, frame->pageID, frame);
+    frame->generation++; // Handles of pins of the frame's earlier pages no longer refer to it
 }
 
-// Sub-function to allocate memory for frame contents
-PageNumber *allocateFrameArray(int numFrames)
+// Filling a page handle with the page a frame holds, and the reference to the frame that unpinPage and markDirty use
+void fillPageHandle(BM_PageHandle *const pageHandle, PageFrame *frame)
 {
-    PageNumber *frameArray = calloc(numFrames, sizeof(PageNumber));
-    return frameArray; // Return allocated array
+    pageHandle->pageNum = frame->pageID;
+    pageHandle->data = frame->pageData;
+    pageHandle->frame = frame->frameIndex;
+    pageHandle->generation = frame->generation;
 }
 
-// Sub-function to retrieve the page ID from the frame statistics
-void retrieveFrameContents(FrameStatistics *statHead, PageNumber *frameNumbers, int *count, int maxFrames)
+// Finding the frame a handle's pin refers to, NULL if the handle refers to no frame of the pool holding the page
+// Handles of other pools, failed pins and earlier pages of the frame fail the checks
+PageFrame *referencedFrame(BufferManager *bufferManager, BM_PageHandle *const pageHandle, PageNumber pageID)
 {
-    do
+    if (pageHandle != NULL && pageHandle->frame >= 0 && pageHandle->frame < bufferManager->directorySize)
     {
-        if (*count < maxFrames) // Check bounds
+        PageFrame *frame = bufferManager->frameDirectory[pageHandle->frame];
+        if (frame->generation == pageHandle->generation && frame->pageID == pageID)
         {
-            frameNumbers[*count] = statHead->currentFrame->pageID; // Store current page ID
-            statHead = statHead->nextStat;                         // Move to the next statistic
-            (*count)++;                                            // Increment count
+            return frame;
         }
-    } while (statHead != NULL && *count < maxFrames); // Continue until all frames are processed
+    }
+    return NULL;
 }
 
-// Sub-function to allocate memory for dirty flags
-bool *allocateDirtyFlags(int numFrames)
+// Finding the frame of a page through the handle of its pin, or the page table if the handle refers to another pin
+PageFrame *handleFrame(BufferManager *bufferManager, BM_PageHandle *const pageHandle, PageNumber pageID)
 {
-    bool *dirtyFlags = calloc(numFrames, sizeof(bool));
-    return dirtyFlags; // Return allocated array
+    PageFrame *frame = referencedFrame(bufferManager, pageHandle, pageID);
+    return (frame != NULL) ? frame : pageTableLookup(bufferManager, pageID);
 }
 
-// Sub-function to set the dirty flag for each frame
-void retrieveDirtyFlags(FrameStatistics *statHead, bool *dirtyFlags, int maxFrames)
+// Checking if a page is already pinned in the buffer
+PageFrame *alreadyPinned(BM_BufferPool *const bufferPool, const PageNumber pageID)
 {
-    int count = 0;
-    do
+    BufferManager *bufferMgr = bufferPool->mgmtData;
+    PageFrame *currentFrame = pageTableLookup(bufferMgr, pageID);
+
+    if (currentFrame != NULL)
     {
-        if (count < maxFrames) // Check bounds
+        incrementFixCount(currentFrame); // Page is already in the buffer
+    }
+    return currentFrame;
+}
+
+// Writing a dirty page back to disk
+RC handleDirtyFrame(PageFrame *framePtr, SM_FileHandle *fileHandle, BufferManager *buffer)
+{
+    if (framePtr->isModified)
+    {
+        RC result = writeBlock(framePtr->pageID, fileHandle, framePtr->pageData);
+        if (result != RC_OK)
         {
-            dirtyFlags[count] = statHead->currentFrame->isModified; // Set dirty flag
-            statHead = statHead->nextStat;                          // Move to the next statistic
-            count++;                                                // Increment count
+            return result;
         }
-    } while (statHead != NULL && count < maxFrames); // Continue until all frames are processed
+        else
+        {
+            framePtr->isModified = false; // Clearing the modified flag
+            __atomic_add_fetch(&buffer->writeOperations, 1, __ATOMIC_RELAXED); // Incrementing write operation count
+        }
+    }
+    return RC_OK;
 }
 
-// Sub-function to allocate memory for fix counts
-int *allocateFixCounts(int numFrames)
+// Loading a page from disk and pinning it in memory
+RC readAndPinPage(PageFrame *framePtr, PageNumber pageID, SM_FileHandle *fileHandle, BufferManager *buffer)
 {
-    int *fixCounts = calloc(numFrames, sizeof(int)); // Allocate memory for fix counts
-    return fixCounts;                                // Return allocated array
+    RC result = readBlock(pageID, fileHandle, framePtr->pageData);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+    else
+    {
+        __atomic_add_fetch(&buffer->readOperations, 1, __ATOMIC_RELAXED); // Incrementing read operation count
+        framePtr->pageID = pageID;  // Setting the page ID
+        framePtr->referenceCount++; // Increasing the reference count
+    }
+    return RC_OK;
 }
 
-// Sub-function to retrieve fix counts for each frame
-void retrieveFixCounts(FrameStatistics *statHead, int *fixCounts, int maxFrames)
+void printFrameDetails(BufferManager *bufferManager)
 {
-    int count = 0;
+    if (bufferManager == NULL || bufferManager->firstFrame == NULL)
+    {
+        printf("No frames available to print.\n");
+        return;
+    }
+
+    PageFrame *currentFrame = bufferManager->firstFrame;
+    PageFrame *startFrame = currentFrame; // Store the starting frame to detect a full loop
+    int frameIndex = 0;
+
+    printf("Frame Details:\n");
     do
     {
-        if (count < maxFrames) // Ensure within bounds
+        printf("Frame %d:\n", frameIndex);
+        printf("  Address: %p\n", (void *)currentFrame); // Print frame address
+        printf("  Page ID: %lld\n", currentFrame->pageID);
+        printf("  Is Modified: %s\n", currentFrame->isModified ? "true" : "false");
+        printf("  Reference Count: %d\n", currentFrame->referenceCount);
+        printf("  Accessed: %s\n", currentFrame->accessed ? "true" : "false");
+        printf("  Data: ");
+        for (int i = 0; i < bufferManager->pageSize; i++)
         {
-            fixCounts[count] = statHead->currentFrame->referenceCount; // Set fix count
-            statHead = statHead->nextStat;                             // Move to the next statistic
-            count++;                                                   // Increment count
+            printf("%c", currentFrame->pageData[i]); // Print data in the frame
         }
-    } while (statHead != NULL && count < maxFrames); // Continue until all frames are processed
-}
+        printf("\n\n");
 
-// Sub-function to get the number of I/O operations
-int getIOOperations(BufferManager *bufferManager, bool isReadOperation)
-{
-    return isReadOperation ? bufferManager->readOperations : bufferManager->writeOperations;
+        currentFrame = currentFrame->nextFrame; // Move to the next frame
+        frameIndex++;
+    } while (currentFrame != NULL && currentFrame != startFrame); // Check for full loop
 }
 
-// Function to initialize the BufferManager
-void initializeBufferManager(BufferManager *bufferManager, int totalFrames, void *strategyData)
+// Function to write back the current frame if it's dirty
+RC writeBackIfDirty(PageFrame *currentFrame, SM_FileHandle *fHandle, BufferManager *bufferManager)
 {
-    switch (1)
+    if (currentFrame->isModified)
     {
-    case 1:
-        switch (RC_OK)
+        RC result = timedWriteBlock(bufferManager, currentFrame->pageID, fHandle, currentFrame->pageData);
+        if (result != RC_OK)
         {
-        case RC_OK:
-            bufferManager->totalPageFrames = totalFrames;
-            break;
-        default:
-            break;
+            return result; // Check for errors
         }
+        currentFrame->isModified = false; // Reset the dirty flag
+        __atomic_add_fetch(&bufferManager->writeOperations, 1, __ATOMIC_RELAXED); // Increment write operations
+        __atomic_add_fetch(&bufferManager->dirtyEvictions, 1, __ATOMIC_RELAXED); // Every caller writes a victim before its frame is reused
+    }
+    return RC_OK; // Return success
+}
 
-        switch (RC_OK)
+// Function to fill a frame with a page, mapped pools borrow it from the mapping instead
+RC readFrameData(PageFrame *currentFrame, PageNumber pageNum, SM_FileHandle *fHandle, BufferManager *bufferManager)
+{
+    if (bufferManager->mappedIO)
+    {
+        long long start = currentTimeNanos();
+        RC result = getBlockPointer(pageNum, fHandle, &currentFrame->pageData);
+        __atomic_add_fetch(&bufferManager->readIOTime, currentTimeNanos() - start, __ATOMIC_RELAXED);
+        return result;
+    }
+    return timedReadBlock(bufferManager, pageNum, fHandle, currentFrame->pageData);
+}
+
+// Function to read the requested page into the current frame
+RC readPageIntoFrame(PageFrame *currentFrame, PageNumber pageNum, SM_FileHandle *fHandle, BufferManager *bufferManager)
+{
+    // Attempt to read the block from the file
+    RC result = readFrameData(currentFrame, pageNum, fHandle, bufferManager);
+    if (result == RC_READ_NON_EXISTING_PAGE)
+    {
+        return RC_READ_NON_EXISTING_PAGE; // Return specific error for non-existing page
+    }
+    else if (result != RC_OK)
+    {
+        return result; // Return any other error encountered
+    }
+
+    // If successful, increment the buffer manager's read operations
+    __atomic_add_fetch(&bufferManager->readOperations, 1, __ATOMIC_RELAXED);
+
+    // Update the current frame with the newly loaded page details
+    currentFrame->pageID = pageNum;
+    currentFrame->referenceCount++;  // Increment the reference count
+
+    return RC_OK; // Return success
+}
+
+
+RC pinThisPage(BM_BufferPool *const bm, PageFrame *currentFrame, PageNumber pageNum)
+{
+    // Accessing the buffer manager and the file handle it keeps open
+    BufferManager *bufferManager = bm->mgmtData;
+    SM_FileHandle *fHandle = &bm->fH;
+    RC result;
+
+    // Shards of a thread-safe pool only claim the frame, the caller transfers the page without the shard latch
+    if (bufferManager->deferredIO)
+    {
+        bufferManager->pendingFrame = currentFrame;
+        if (currentFrame->isModified)
         {
-        case RC_OK:
-            bufferManager->strategyInfo = strategyData;
-            break;
-        default:
-            break;
+            return RC_BM_VICTIM_DIRTY; // The old page has to reach the disk before the frame is reused
         }
+        PageNumber oldPageID = currentFrame->pageID;
+        currentFrame->pageID = pageNum;
+        currentFrame->referenceCount++;
+        currentFrame->ioPending = true;
+        remapFrame(bufferManager, currentFrame, oldPageID);
+        return RC_OK;
+    }
 
-        switch (RC_OK)
+    // Ensure the file has enough pages to accommodate the requested page
+    result = ensureCapacity(pageNum, fHandle);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+
+    // Write the current frame back to disk if it's dirty
+    result = writeBackIfDirty(currentFrame, fHandle, bufferManager);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+
+    // Read the requested page into the current frame
+    PageNumber oldPageID = currentFrame->pageID;
+    result = readPageIntoFrame(currentFrame, pageNum, fHandle, bufferManager);
+    if (result != RC_OK)
+    {
+        return result; // Return errors, including RC_READ_NON_EXISTING_PAGE
+    }
+
+    // Update the page number for the current frame and the page table
+    currentFrame->pageID = pageNum;
+    remapFrame(bufferManager, currentFrame, oldPageID);
+
+    return RC_OK; // Return success if all operations are successful
+}
+
+/*
+    // Helper functions based on Pinning Frame with different strategies like FIFO and LRU Stategies
+*/
+
+bool findAvailableFrame(BufferManager *buffer, PageFrame **framePtr)
+{
+    PageFrame *currentFrame = buffer->firstFrame;
+
+    // Loop to find an available frame
+    do
+    {
+        switch (currentFrame->referenceCount)
         {
-        case RC_OK:
-            bufferManager->readOperations = 0;
-            break;
+        case 0:
+            *framePtr = currentFrame; // Assign the found frame to framePtr
+            return true;              // Found an available frame
         default:
+            // Do nothing, will continue to the next frame
             break;
         }
 
-        switch (RC_OK)
+        currentFrame = currentFrame->nextFrame; // Move to the next frame
+
+        switch ((currentFrame == buffer->firstFrame)? 1 : 0)
         {
-        case RC_OK:
-            bufferManager->writeOperations = 0;
-            break;
+        case 1:
+            *framePtr = NULL; // No available frame found
+            return false;     // Indicate that no frame was found
+        case 0:
+            break; 
         default:
-            break;
+            break; // Continue looping if not back at the first frame
         }
 
-        // return RC_OK;
+    } while (true); // Infinite loop, will return from inside
+
+    // This line is never reached, included for clarity
+    *framePtr = NULL;
+    return false; // Indicate that no frame was found
+}
+
+void updateFrameList(BufferManager *buffer, PageFrame *currentFrame)
+{
+    if (currentFrame == buffer->firstFrame)
+    {
+        buffer->firstFrame = currentFrame->nextFrame;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->prevFrame->nextFrame = currentFrame->nextFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->nextFrame->prevFrame = currentFrame->prevFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->prevFrame = buffer->lastFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        buffer->lastFrame->nextFrame = currentFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        buffer->lastFrame = currentFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->nextFrame = buffer->firstFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        buffer->firstFrame->prevFrame = currentFrame;
+        break;
+    }
+}
+
+void moveToTail(BM_BufferPool *bufferPool, PageFrame *currentFrame)
+{
+    BufferManager *buffer = bufferPool->mgmtData;
+    if (currentFrame == buffer->lastFrame)
+    {
+        return; // Already the most recently used, relinking it to itself would drop it from the ring
+    }
+
+    if (currentFrame == buffer->firstFrame)
+    {
+        buffer->firstFrame = currentFrame->nextFrame;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->prevFrame->nextFrame = currentFrame->nextFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->nextFrame->prevFrame = currentFrame->prevFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->prevFrame = buffer->lastFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        buffer->lastFrame->nextFrame = currentFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        buffer->lastFrame = currentFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->nextFrame = buffer->firstFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        buffer->firstFrame->prevFrame = currentFrame;
+        break;
+    }
+}
+
+// Sub-function to find a frame to pin using the CLOCK algorithm, the hand resumes where the last search stopped
+// Two sweeps at most, the first one may only clear reference bits
+PageFrame *findFrameToPin(BufferManager *buffer)
+{
+    PageFrame *hand = (buffer->currentFramePtr != NULL) ? buffer->currentFramePtr : buffer->firstFrame;
+    PageFrame *currentFrame = hand;
+    int sweeps = 0;
+    do
+    {
+        // Check if the frame is unpinned and can be replaced
+        if (currentFrame->referenceCount == 0)
+        {
+            if (!currentFrame->accessed) // refbit is 0, ready to be replaced
+            {
+                buffer->currentFramePtr = currentFrame->nextFrame; // The hand moves past the victim
+                return currentFrame; // Found a frame to pin
+            }
+            currentFrame->accessed = false; // Reset reference bit
+        }
+
+        // Move to the next frame in the buffer
+        currentFrame = currentFrame->nextFrame;
+        if (currentFrame == hand)
+        {
+            sweeps++;
+        }
+    } while (sweeps < 2); // A second sweep finds the bits the first one cleared
+
+    return NULL; // No available frame found for replacement
+}
+
+void updateLinkedList(BufferManager *bufferManager, PageFrame *currentFrame)
+{
+    if (currentFrame == bufferManager->lastFrame)
+    {
+        return; // Already at the tail
+    }
+
+    if (currentFrame == bufferManager->firstFrame)
+    {
+        bufferManager->firstFrame = currentFrame->nextFrame;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->prevFrame->nextFrame = currentFrame->nextFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->nextFrame->prevFrame = currentFrame->prevFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->prevFrame = bufferManager->lastFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        bufferManager->lastFrame->nextFrame = currentFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        bufferManager->lastFrame = currentFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        currentFrame->nextFrame = bufferManager->firstFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        bufferManager->firstFrame->prevFrame = currentFrame;
+        break;
+    }
+}
+
+/*
+    // Functions based on Pinning Frame with different strategies like FIFO and LRU Stategies
+*/
+
+RC pinFIFO(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageID, bool fromLRU)
+{
+    // Check if the page is already pinned
+    PageFrame *residentFrame = fromLRU ? NULL : alreadyPinned(bufferPool, pageID);
+    if (residentFrame != NULL)
+    {
+        fillPageHandle(pageHandle, residentFrame);
+        return RC_OK;
+    }
+    else
+    {
+        BufferManager *bufferManager = bufferPool->mgmtData;
+        PageFrame *availableFrame = NULL;                                      // Pointer to hold the available frame
+        bool isAvailable = findAvailableFrame(bufferManager, &availableFrame); // Call with correct parameters
+
+        switch (!isAvailable ? 1 : 0)
+        {
+        case 1:
+            return RC_IM_NO_MORE_ENTRIES;
+            break;
+
+        default:
+            break;
+        }
+        // Pin the page to the found frame
+        RC result = pinThisPage(bufferPool, availableFrame, pageID);
+        int val = (result != RC_OK) ? 1 : 0;
+        switch (val)
+        {
+        case 1:
+            return result;
+            break; 
+
+        default:
+            break;
+        }
+        // Set page handle data
+        fillPageHandle(pageHandle, availableFrame);
+
+        // Update the linked list to move the pinned frame to the tail
+        updateLinkedList(bufferManager, availableFrame);
+
+        return RC_OK;
+    }
+}
+
+RC pinLRU(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle,
+          const PageNumber pageID)
+{
+    // Check if the page is already pinned
+    PageFrame *currentFrame = alreadyPinned(bufferPool, pageID);
+
+    if (currentFrame)
+    {
+        // If the page is already pinned, move it to the tail of the list
+        moveToTail(bufferPool, currentFrame);
+    }
+    else
+    {
+        // If the page is not pinned, use FIFO to pin the page
+        return pinFIFO(bufferPool, pageHandle, pageID, true);
+    }
+
+    // Update the page handle with the page number and data
+    fillPageHandle(pageHandle, currentFrame);
+
+    return RC_OK; // Return success
+}
+
+RC pinCLOCK(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum)
+{
+    PageFrame *selectedFrame = alreadyPinned(bufferPool, pageNum);
+    if (selectedFrame != NULL)
+    {
+        selectedFrame->accessed = true; // A hit sets the reference bit
+        fillPageHandle(pageHandle, selectedFrame);
+        return RC_OK;
+    }
+
+    BufferManager *buffer = bufferPool->mgmtData;
+    selectedFrame = findFrameToPin(buffer);
+
+    if (selectedFrame == NULL)
+    {
+        return RC_IM_NO_MORE_ENTRIES; // No available frame
+    }
+
+    RC result = pinThisPage(bufferPool, selectedFrame, pageNum);
+    if (result != RC_OK)
+    {
+        return result; // Return the error from pinning
+    }
+
+    selectedFrame->accessed = true; // So does loading the page, the hand passes it once before it can be replaced
+    fillPageHandle(pageHandle, selectedFrame);
+
+
+    return RC_OK;
+}
+
+RC pinLRUK(BM_BufferPool *const bm, BM_PageHandle *const page,
+           const PageNumber pageNum)
+{
+    BufferManager *bufferManager = bm->mgmtData;
+    PageFrame *selectedFrame = alreadyPinned(bm, pageNum);
+
+    if (selectedFrame == NULL)
+    {
+        selectedFrame = lrukChooseVictim(bufferManager);
+        if (selectedFrame == NULL)
+        {
+            return RC_IM_NO_MORE_ENTRIES; // Every frame is pinned
+        }
+
+        // Claim the page's retained history, so retaining the victim's cannot push it out
+        LRUKHistory *history = lrukLookup(bufferManager->lruK, pageNum);
+        bool wasRetained = (history != NULL && history->retainedAt != 0);
+        if (wasRetained)
+        {
+            history->retainedAt = 0;
+        }
+
+        RC result = pinThisPage(bm, selectedFrame, pageNum);
+        if (result != RC_OK)
+        {
+            if (wasRetained)
+            {
+                lrukRetain(bufferManager->lruK, pageNum); // Still not resident
+            }
+            return result;
+        }
+    }
+
+    // Hits and misses both count as references in the page's history
+    lrukReference(bufferManager->lruK, pageNum);
+
+    fillPageHandle(page, selectedFrame);
+    return RC_OK;
+}
+
+RC pinQueued(BM_BufferPool *const bm, BM_PageHandle *const page,
+             const PageNumber pageNum)
+{
+    BufferManager *bufferManager = bm->mgmtData;
+    QueuePolicy *policy = bufferManager->queuePolicy;
+    PageFrame *selectedFrame = alreadyPinned(bm, pageNum);
+
+    if (selectedFrame != NULL)
+    {
+        queueNoteHit(policy, pageNum);
+    }
+    else
+    {
+        if (!bufferManager->retryingPin)
+        {
+            queueNoteMiss(policy, pageNum); // ARC adapts once per miss, not once per victim it chooses
+        }
+        selectedFrame = queueChooseVictim(bufferManager, pageNum);
+        if (selectedFrame == NULL)
+        {
+            return RC_IM_NO_MORE_ENTRIES; // Every frame is pinned
+        }
+
+        // The victim becomes a ghost while its frame is reused
+        RC result = pinThisPage(bm, selectedFrame, pageNum);
+        if (result != RC_OK)
+        {
+            return result;
+        }
+        queueNoteLoaded(policy, pageNum, false);
+    }
+
+    fillPageHandle(page, selectedFrame);
+    return RC_OK;
+}
+
+RC pinLFU(BM_BufferPool *const bm, BM_PageHandle *const page,
+          const PageNumber pageNum)
+{
+    BufferManager *bufferManager = bm->mgmtData;
+    PageFrame *selectedFrame = alreadyPinned(bm, pageNum);
+
+    if (selectedFrame != NULL)
+    {
+        lfuTouch(bufferManager->lfu, selectedFrame);
+    }
+    else
+    {
+        selectedFrame = lfuChooseVictim(bufferManager);
+        if (selectedFrame == NULL)
+        {
+            return RC_IM_NO_MORE_ENTRIES; // Every frame is pinned
+        }
+
+        RC result = pinThisPage(bm, selectedFrame, pageNum);
+        if (result != RC_OK)
+        {
+            return result;
+        }
+        lfuReset(bufferManager->lfu, selectedFrame, 1); // The count belongs to the page, not the frame
+    }
+    lfuTick(bufferManager->lfu);
+
+    fillPageHandle(page, selectedFrame);
+    return RC_OK;
+}
+
+// Pinning a page with the pool's replacement strategy
+RC pinWithStrategy(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum)
+{
+    switch (bufferPool->strategy)
+    {
+    case RS_LRU_K:
+    {
+        return pinLRUK(bufferPool, pageHandle, pageNum);
+    }
+
+    case RS_2Q:
+    case RS_ARC:
+    {
+        return pinQueued(bufferPool, pageHandle, pageNum);
+    }
+
+    case RS_LFU:
+    {
+        return pinLFU(bufferPool, pageHandle, pageNum);
+    }
+
+    case RS_FIFO:
+    {
+        RC result;
+        bool success = false;
+
+        do
+        {
+            result = pinFIFO(bufferPool, pageHandle, pageNum, false);
+
+            switch (result)
+            {
+            case RC_OK:
+                success = true;
+                break;
+
+            default:
+                return result;
+            }
+        } while (!success);
+
+        return RC_OK;
+    }
+
+    case RS_CLOCK:
+    {
+        RC result;
+        bool success = false;
+
+        do
+        {
+            result = pinCLOCK(bufferPool, pageHandle, pageNum);
+
+            switch (result)
+            {
+            case RC_OK:
+                success = true;
+                break;
+            default:
+                return result;
+            }
+        } while (!success);
+
+        return RC_OK;
+    }
+
+    case RS_LRU:
+    {
+        RC result;
+        bool success = false;
+
+        do
+        {
+            result = pinLRU(bufferPool, pageHandle, pageNum);
+
+            switch (result)
+            {
+            case RC_OK:
+                success = true;
+                break;
+            default:
+                return result;
+            }
+        } while (!success);
+
+        return RC_OK;
+    }
+
+    default:
+    {
+        return RC_IM_KEY_NOT_FOUND;
+    }
+    }
+}
+
+/*
+    //Helper Functions for Mandatory functions required for the Assignment as defined in buffer_mgr.h
+*/
+
+// Helper function to create a new PageFrame
+PageFrame *createPageFrame()
+{
+    PageFrame *newFrame = malloc(sizeof(PageFrame));
+    if (newFrame != NULL)
+    {
+        newFrame->pageID = NO_PAGE;
+        newFrame->isModified = false;
+        newFrame->referenceCount = 0;
+        newFrame->pageData = allocatePageBuffer(PAGE_SIZE);
+        newFrame->nextFrame = NULL; // Initialize nextFrame pointer
+        newFrame->prevFrame = NULL; // Initialize prevFrame pointer
+    }
+    return newFrame; // Return the new page frame
+}
+
+// Helper function to create a new FrameStatistics
+FrameStatistics *createFrameStatistics(PageFrame *frame)
+{
+    FrameStatistics *newStat = malloc(sizeof(FrameStatistics));
+    if (newStat != NULL)
+    {
+        newStat->currentFrame = frame;
+        newStat->nextStat = NULL; // Initialize nextStat pointer
+    }
+    return newStat; // Return the new frame statistics
+}
+
+// Helper function to link two PageFrames
+void linkFrames(PageFrame *previous, PageFrame *next)
+{
+    previous->nextFrame = next; // Link the next frame
+    next->prevFrame = previous; // Link the previous frame
+}
+
+// Helper function to add a new FrameStatistics to the list
+void addFrameToList(FrameStatistics *head, FrameStatistics *newStat)
+{
+    while (head->nextStat != NULL)
+    {
+        head = head->nextStat; // Traverse to the end of the list
+    }
+    head->nextStat = newStat; // Add the new statistics to the end
+}
+
+void completeCircularLink(BufferManager *bufferManager)
+{
+    int firstFrameExists = (bufferManager->firstFrame != NULL) ? 1 : 0;
+    switch (firstFrameExists)
+    {
+    case 1:
+        bufferManager->lastFrame = bufferManager->firstFrame;
+
+        int lastFrameExists = (bufferManager->lastFrame != NULL) ? 1 : 0;
+        switch (lastFrameExists)
+        {
+        case 1:
+            bufferManager->firstFrame->prevFrame = bufferManager->lastFrame;
+            bufferManager->lastFrame->nextFrame = bufferManager->firstFrame;
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Helper function to write a page to disk
+RC writePageToDisk(BufferManager *bufferManager, PageFrame *frame, SM_FileHandle *fileHandle)
+{
+    return timedWriteBlock(bufferManager, frame->pageID, fileHandle, frame->pageData); // Write the current page's data to disk
+}
+
+// Helper function to order dirty frames by page number
+int compareFramesByPage(const void *left, const void *right)
+{
+    PageNumber leftPage = (*(PageFrame *const *)left)->pageID;
+    PageNumber rightPage = (*(PageFrame *const *)right)->pageID;
+    return (leftPage > rightPage) - (leftPage < rightPage);
+}
+
+// Helper function to write a run of dirty frames holding consecutive pages with one vectored write
+RC writeFrameRun(BufferManager *bufferManager, SM_FileHandle *fileHandle, PageFrame **frames, int count, bool *written)
+{
+    SM_PageHandle *pages = malloc(sizeof(SM_PageHandle) * count);
+    if (pages == NULL)
+    {
+        return RC_WRITE_FAILED;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        pages[i] = frames[i]->pageData;
+    }
+
+    // Consecutive keys of the process-wide pool are consecutive pages of one file
+    PageNumber firstPage;
+    SM_FileHandle *runFile = resolvePage(bufferManager, frames[0]->pageID, fileHandle, &firstPage);
+    long long start = currentTimeNanos();
+    RC result = writeBlockRange(firstPage, count, runFile, pages);
+    long long elapsed = currentTimeNanos() - start;
+    __atomic_add_fetch(&bufferManager->writeIOTime, elapsed, __ATOMIC_RELAXED);
+    noteFileIO(fileOfKey(bufferManager, frames[0]->pageID), SM_IO_WRITE, (result == RC_OK) ? count : 0, elapsed);
+    free(pages);
+
+    if (result == RC_OK)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            written[i] = true;
+            __atomic_add_fetch(&bufferManager->writeOperations, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return result;
+}
+
+// Helper function to write dirty frames in page order, written[i] tells whether frames[i] reached the disk
+// The frames are sorted in place, runs of consecutive pages become one vectored write, isolated pages one batch
+// Each page is written under the shared latch of its frame, frames held exclusively are being changed and stay dirty
+RC writeDirtyFrames(BufferManager *bufferManager, SM_FileHandle *fileHandle, PageFrame **frames, int count, bool *written)
+{
+    SM_IORequest *requests = malloc(sizeof(SM_IORequest) * (count + 1));
+    PageFrame **singles = malloc(sizeof(PageFrame *) * (count + 1));
+    int *singleIndex = malloc(sizeof(int) * (count + 1));
+    if (requests == NULL || singles == NULL || singleIndex == NULL)
+    {
+        free(requests);
+        free(singles);
+        free(singleIndex);
+        return RC_WRITE_FAILED;
+    }
+
+    // The latched frames move to the front, the skipped ones keep their place behind them
+    int latched = 0;
+    for (int i = 0; i < count; i++)
+    {
+        written[i] = false;
+        if (pthread_rwlock_tryrdlock(&frames[i]->latch) == 0)
+        {
+            PageFrame *swap = frames[latched];
+            frames[latched++] = frames[i];
+            frames[i] = swap;
+        }
+    }
+    count = latched;
+    qsort(frames, count, sizeof(PageFrame *), compareFramesByPage);
+
+    // Split the sorted pages into runs of consecutive page numbers
+    RC result = RC_OK;
+    int numSingles = 0;
+    int runStart = 0;
+    while (runStart < count)
+    {
+        int runEnd = runStart + 1;
+        while (runEnd < count && frames[runEnd]->pageID == frames[runEnd - 1]->pageID + 1)
+        {
+            runEnd++;
+        }
+
+        if (runEnd - runStart == 1)
+        {
+            singleIndex[numSingles] = runStart;
+            singles[numSingles++] = frames[runStart];
+        }
+        else
+        {
+            RC runResult = writeFrameRun(bufferManager, fileHandle, frames + runStart, runEnd - runStart, written + runStart);
+            if (runResult != RC_OK && result == RC_OK)
+            {
+                result = runResult; // Keep writing, report the first failure
+            }
+        }
+        runStart = runEnd;
+    }
+
+    for (int i = 0; i < numSingles; i++)
+    {
+        requests[i].pageNum = singles[i]->pageID;
+        requests[i].memPage = singles[i]->pageData;
+        requests[i].type = SM_IO_WRITE;
+    }
+    RC batchResult = transferBatch(bufferManager, fileHandle, requests, numSingles);
+
+    // Only pages whose write completed count as written
+    for (int i = 0; i < numSingles; i++)
+    {
+        if (requests[i].completed && requests[i].result == RC_OK)
+        {
+            written[singleIndex[i]] = true;
+            __atomic_add_fetch(&bufferManager->writeOperations, 1, __ATOMIC_RELAXED);
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        pthread_rwlock_unlock(&frames[i]->latch);
+    }
+
+    free(requests);
+    free(singles);
+    free(singleIndex);
+    return (result != RC_OK) ? result : batchResult;
+}
+
+// Sub-function to write a frame a flush passed over once its exclusive latch is released
+// A thread flushing a page it holds exclusively itself would wait forever, so that page fails to write instead
+RC writeUnlatchedFrame(BufferManager *bufferManager, SM_FileHandle *fileHandle, PageFrame *frame, bool *written)
+{
+    *written = false;
+    if (pthread_rwlock_rdlock(&frame->latch) != 0)
+    {
+        return RC_WRITE_FAILED;
+    }
+    RC result = writeDirtyFrames(bufferManager, fileHandle, &frame, 1, written); // Read latches can be taken twice
+    pthread_rwlock_unlock(&frame->latch);
+    return result;
+}
+
+// Helper function to flush dirty pages to disk in page order
+RC flushDirtyPagesToDisk(BufferManager *bufferManager, SM_FileHandle *fileHandle)
+{
+    if (bufferManager == NULL || fileHandle == NULL)
+    {
+        return RC_FILE_NOT_FOUND; // Ensure valid input
+    }
+
+    PageFrame *currentFrame = bufferManager->firstFrame; // Start from the first frame
+    if (currentFrame == NULL)
+    {
+        return RC_FILE_NOT_FOUND; // No frames to process
+    }
+
+    PageFrame **frames = malloc(sizeof(PageFrame *) * bufferManager->totalPageFrames);
+    bool *written = malloc(sizeof(bool) * bufferManager->totalPageFrames);
+    if (frames == NULL || written == NULL)
+    {
+        free(frames);
+        free(written);
+        return RC_WRITE_FAILED;
+    }
+
+    // Collect every dirty page in the pool
+    int count = 0;
+    do
+    {
+        if (currentFrame->isModified)
+        {
+            frames[count++] = currentFrame;
+        }
+        currentFrame = currentFrame->nextFrame; // Move to the next page frame
+    } while (currentFrame != bufferManager->firstFrame); // Continue until we return to the first frame
+
+    RC result = writeDirtyFrames(bufferManager, fileHandle, frames, count, written);
+
+    // Pages in change under an exclusive latch were passed over, the flush waits for them one at a time
+    for (int i = 0; i < count; i++)
+    {
+        if (!written[i])
+        {
+            RC frameResult = writeUnlatchedFrame(bufferManager, fileHandle, frames[i], &written[i]);
+            if (frameResult != RC_OK && result == RC_OK)
+            {
+                result = frameResult;
+            }
+        }
+    }
+
+    // Only pages whose write completed become clean
+    for (int i = 0; i < count; i++)
+    {
+        if (written[i])
+        {
+            frames[i]->isModified = false;
+        }
+    }
+
+    free(frames);
+    free(written);
+    return result; // First write error, or RC_OK once every dirty page is on disk
+}
+
+// Helper function to find the page frame for a specific page number
+PageFrame *findPageFrame(BufferManager *bufferManager, PageNumber pageNum)
+{
+    return pageTableLookup(bufferManager, pageNum);
+}
+
+
+RC updateFixCount(PageFrame *currentFrame)
+{
+    switch (currentFrame->referenceCount)
+    {
+    case 0:
+        return RC_READ_NON_EXISTING_PAGE; // Return error if fix count is already 0
+    default:
+        currentFrame->referenceCount--; // The reference bit stays set, only the CLOCK hand clears it
+        return RC_OK; // Successfully updated the fix count
+    }
+}
+
+// Releasing the latch a page handle holds on its frame, if any
+void releaseFrameLatch(PageFrame *currentFrame, BM_PageHandle *const pageHandle)
+{
+    if (pageHandle->latch != BM_LATCH_NONE)
+    {
+        pthread_rwlock_unlock(&currentFrame->latch);
+        pageHandle->latch = BM_LATCH_NONE;
+    }
+}
+
+RC writePageData(BufferManager *bufferManager, PageNumber pageNum, SM_FileHandle *fileHandle, char *data)
+{
+    return timedWriteBlock(bufferManager, pageNum, fileHandle, data);
+}
+
+// Sub-function to allocate memory for frame contents
+PageNumber *allocateFrameArray(int numFrames)
+{
+    PageNumber *frameArray = calloc(numFrames, sizeof(PageNumber));
+    return frameArray; // Return allocated array
+}
+
+// Sub-function to retrieve the page ID from the frame statistics
+void retrieveFrameContents(FrameStatistics *statHead, PageNumber *frameNumbers, int *count, int maxFrames)
+{
+    do
+    {
+        if (*count < maxFrames) // Check bounds
+        {
+            frameNumbers[*count] = statHead->currentFrame->pageID; // Store current page ID
+            statHead = statHead->nextStat;                         // Move to the next statistic
+            (*count)++;                                            // Increment count
+        }
+    } while (statHead != NULL && *count < maxFrames); // Continue until all frames are processed
+}
+
+// Sub-function to allocate memory for dirty flags
+bool *allocateDirtyFlags(int numFrames)
+{
+    bool *dirtyFlags = calloc(numFrames, sizeof(bool));
+    return dirtyFlags; // Return allocated array
+}
+
+// Sub-function to set the dirty flag for each frame
+void retrieveDirtyFlags(FrameStatistics *statHead, bool *dirtyFlags, int maxFrames)
+{
+    int count = 0;
+    do
+    {
+        if (count < maxFrames) // Check bounds
+        {
+            dirtyFlags[count] = statHead->currentFrame->isModified; // Set dirty flag
+            statHead = statHead->nextStat;                          // Move to the next statistic
+            count++;                                                // Increment count
+        }
+    } while (statHead != NULL && count < maxFrames); // Continue until all frames are processed
+}
+
+// Sub-function to allocate memory for fix counts
+int *allocateFixCounts(int numFrames)
+{
+    int *fixCounts = calloc(numFrames, sizeof(int)); // Allocate memory for fix counts
+    return fixCounts;                                // Return allocated array
+}
+
+// Sub-function to retrieve fix counts for each frame
+void retrieveFixCounts(FrameStatistics *statHead, int *fixCounts, int maxFrames)
+{
+    int count = 0;
+    do
+    {
+        if (count < maxFrames) // Ensure within bounds
+        {
+            fixCounts[count] = statHead->currentFrame->referenceCount; // Set fix count
+            statHead = statHead->nextStat;                             // Move to the next statistic
+            count++;                                                   // Increment count
+        }
+    } while (statHead != NULL && count < maxFrames); // Continue until all frames are processed
+}
+
+// Sub-function to get the number of I/O operations
+int getIOOperations(BufferManager *bufferManager, bool isReadOperation)
+{
+    return isReadOperation ? bufferManager->readOperations : bufferManager->writeOperations;
+}
+
+// Function to initialize the BufferManager
+void initializeBufferManager(BufferManager *bufferManager, int totalFrames, void *strategyData)
+{
+    switch (1)
+    {
+    case 1:
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferManager->totalPageFrames = totalFrames;
+            break;
+        default:
+            break;
+        }
+
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferManager->strategyInfo = strategyData;
+            break;
+        default:
+            break;
+        }
+
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferManager->readOperations = 0;
+            break;
+        default:
+            break;
+        }
+
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferManager->writeOperations = 0;
+            break;
+        default:
+            break;
+        }
+
+        bufferManager->readIOTime = 0;
+        bufferManager->writeIOTime = 0;
+        bufferManager->lruK = NULL;
+        bufferManager->queuePolicy = NULL;
+        bufferManager->lfu = NULL;
+        bufferManager->shards = NULL;
+        bufferManager->numShards = 0;
+        bufferManager->deferredIO = false;
+        bufferManager->pendingFrame = NULL;
+        bufferManager->retryingPin = false;
+        bufferManager->currentFramePtr = NULL; // The CLOCK hand starts at the first frame
+        bufferManager->cleanerActive = false;
+        bufferManager->cleanFraction = 0;
+        bufferManager->prefetching = NULL;
+        bufferManager->numPrefetching = 0;
+        bufferManager->frameChunks = NULL;
+        bufferManager->frameDirectory = NULL;
+        bufferManager->directorySize = 0;
+        bufferManager->spareFrames = NULL;
+        bufferManager->sharedFiles = NULL;
+        bufferManager->sharedFile = NULL;
+        bufferManager->pinHits = 0;
+        bufferManager->pinMisses = 0;
+        bufferManager->evictions = 0;
+        bufferManager->dirtyEvictions = 0;
+        bufferManager->pinWaits = 0;
+        bufferManager->pinWaitNanos = 0;
+        bufferManager->pinTiming = false;
+        memset(&bufferManager->pinHitLatency, 0, sizeof(BM_LatencyHistogram));
+        memset(&bufferManager->pinMissLatency, 0, sizeof(BM_LatencyHistogram));
+        memset(&bufferManager->flushLatency, 0, sizeof(BM_LatencyHistogram));
+        bufferManager->trace = NULL;
+        bufferManager->warmFile = NULL;
+        bufferManager->warmPages = NULL;
+        bufferManager->numWarmPages = 0;
+        bufferManager->warmLoading = false;
+
+        // return RC_OK;
+    }
+}
+
+/*
+    // Helper functions for the frame arena
+*/
+
+// Size of a huge page on x86-64 and arm64, arenas at least this large try to use them
+#define HUGE_PAGE_BYTES (2 * 1024 * 1024)
+
+// Sub-function to map a zeroed, page-aligned arena for page data, backed by huge pages when the kernel has them to give
+char *mapFrameArena(size_t bytes, size_t *mappedBytes)
+{
+    void *arena;
+
+#ifdef MAP_HUGETLB
+    if (bytes >= HUGE_PAGE_BYTES)
+    {
+        // Reserved huge pages are only there if the administrator set some aside, so failing here is normal
+        size_t hugeBytes = (bytes + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+        arena = mmap(NULL, hugeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (arena != MAP_FAILED)
+        {
+            *mappedBytes = hugeBytes;
+            return arena;
+        }
+    }
+#endif
+
+    arena = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED)
+    {
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (bytes >= HUGE_PAGE_BYTES)
+    {
+        madvise(arena, bytes, MADV_HUGEPAGE); // Only a hint, transparent huge pages may be disabled
+    }
+#endif
+    *mappedBytes = bytes;
+    return arena;
+}
+
+// Sub-function to free a chunk, its frames must no longer be in use
+void freeFrameChunk(FrameChunk *chunk)
+{
+    if (chunk->frames != NULL)
+    {
+        for (int i = 0; i < chunk->count; i++)
+        {
+            pthread_rwlock_destroy(&chunk->frames[i].latch);
+        }
+    }
+    if (chunk->data != NULL)
+    {
+        munmap(chunk->data, chunk->dataBytes);
+    }
+    free(chunk->frames);
+    free(chunk->stats);
+    free(chunk);
+}
+
+// Helper function to allocate count frames with their statistics and page data as one chunk, linked in array order
+RC createFrameChunk(BufferManager *bufferManager, int count, FrameChunk **result)
+{
+    FrameChunk *chunk = calloc(1, sizeof(FrameChunk));
+    if (chunk == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    chunk->count = count;
+    chunk->frames = calloc(count, sizeof(PageFrame)); // Zeroed, so frames start clean, unpinned and unreferenced
+    chunk->stats = calloc(count, sizeof(FrameStatistics));
+    if (chunk->frames == NULL || chunk->stats == NULL)
+    {
+        chunk->count = 0; // No latches were initialized yet
+        freeFrameChunk(chunk);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    // Frames of mapped pools point into the file mapping once loaded, the others slice one arena
+    if (!bufferManager->mappedIO)
+    {
+        chunk->data = mapFrameArena((size_t)count * bufferManager->pageSize, &chunk->dataBytes);
+        if (chunk->data == NULL)
+        {
+            chunk->count = 0;
+            freeFrameChunk(chunk);
+            return RC_MEMORY_ALLOCATION_ERROR;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        PageFrame *frame = &chunk->frames[i];
+        frame->pageID = NO_PAGE;
+        frame->pageData = (chunk->data != NULL) ? chunk->data + (size_t)i * bufferManager->pageSize : NULL;
+        frame->nextFrame = (i + 1 < count) ? &chunk->frames[i + 1] : NULL;
+        frame->prevFrame = (i > 0) ? &chunk->frames[i - 1] : NULL;
+        pthread_rwlock_init(&frame->latch, NULL);
+
+        chunk->stats[i].currentFrame = frame;
+        chunk->stats[i].nextStat = (i + 1 < count) ? &chunk->stats[i + 1] : NULL;
+    }
+
+    // Page handles refer to the frames by their index in the directory, which never shrinks while the pool is open
+    PageFrame **directory = realloc(bufferManager->frameDirectory,
+                                    sizeof(PageFrame *) * (bufferManager->directorySize + count));
+    if (directory == NULL)
+    {
+        freeFrameChunk(chunk);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        chunk->frames[i].frameIndex = bufferManager->directorySize + i;
+        directory[bufferManager->directorySize + i] = &chunk->frames[i];
+    }
+    bufferManager->frameDirectory = directory;
+    bufferManager->directorySize += count;
+
+    *result = chunk;
+    return RC_OK;
+}
+
+// Helper function to free every chunk of a pool
+void freeFrameChunks(BufferManager *bufferManager)
+{
+    while (bufferManager->frameChunks != NULL)
+    {
+        FrameChunk *next = bufferManager->frameChunks->next;
+        freeFrameChunk(bufferManager->frameChunks);
+        bufferManager->frameChunks = next;
+    }
+    free(bufferManager->frameDirectory);
+    bufferManager->frameDirectory = NULL;
+    bufferManager->directorySize = 0;
+}
+
+// Helper function to set up the frames, page table and replacement state of a pool whose file is open
+RC buildBufferManager(BM_BufferPool *const bufferPool, const char *const fileName, const int totalFrames,
+                      ReplacementStrategy strategy, void *strategyData, bool mappedIO)
+{
+    RC result;
+
+    // Initialize buffer manager
+    BufferManager *bufferManager = malloc(sizeof(BufferManager));
+    switch ((bufferManager == NULL) ? 1 : 0)
+    {
+    case 1:
+        return RC_WRITE_FAILED;
+        break;
+    case 0:
+        break;
+
+    default:
+        break;
+    }
+    initializeBufferManager(bufferManager, totalFrames, strategyData);
+    bufferManager->mappedIO = mappedIO;
+    bufferManager->pageSize = bufferPool->fH.pageSize; // Frames hold pages of the size the file was created with
+
+    // Create all frames, their statistics and page data in one chunk
+    result = createFrameChunk(bufferManager, totalFrames, &bufferManager->frameChunks);
+    if (result != RC_OK)
+    {
+        free(bufferManager);
+        return result;
+    }
+    bufferManager->firstFrame = bufferManager->frameChunks->frames;
+    bufferManager->statsHead = bufferManager->frameChunks->stats;
+    PageFrame *headFrame = &bufferManager->frameChunks->frames[totalFrames - 1];
+
+    // Create the page table used to locate resident pages
+    result = createPageTable(bufferManager, totalFrames);
+    if (result != RC_OK)
+    {
+        freeFrameChunks(bufferManager);
+        free(bufferManager);
+        return result;
+    }
+
+    // LRU-K keeps reference histories with K taken from stratData
+    if (strategy == RS_LRU_K)
+    {
+        result = createLRUKState(bufferManager, totalFrames, strategyData);
+        if (result != RC_OK)
+        {
+            freeFrameChunks(bufferManager);
+            free(bufferManager->pageTable);
+            free(bufferManager);
+            return result;
+        }
+    }
+
+    // 2Q and ARC keep their resident and ghost queues, LFU its frequency buckets with the aging period from stratData
+    if (strategy == RS_2Q || strategy == RS_ARC || strategy == RS_LFU)
+    {
+        result = (strategy == RS_LFU) ? createLFUState(bufferManager, totalFrames, strategyData)
+                                      : createQueuePolicy(bufferManager, totalFrames, strategy);
+        if (result != RC_OK)
+        {
+            freeFrameChunks(bufferManager);
+            free(bufferManager->pageTable);
+            free(bufferManager);
+            return result;
+        }
+    }
+
+    // Complete the circular linking for the clock algorithm
+    headFrame->nextFrame = bufferManager->firstFrame;
+
+    switch (1)
+    {
+    case 1:
+        bufferManager->firstFrame->prevFrame = headFrame;
+        break;
+    }
+
+    switch (1)
+    {
+    case 1:
+        bufferManager->lastFrame = headFrame;
+        break;
+    }
+
+    // Initialize buffer pool
+    switch (1)
+    {
+    case 1:
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferPool->numPages = totalFrames;
+            break;
+        default:
+            break;
+        }
+
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferPool->pageFile = (char *)fileName;
+            break;
+        default:
+            break;
+        }
+
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferPool->strategy = strategy;
+            break;
+        default:
+            break;
+        }
+
+        switch (RC_OK)
+        {
+        case RC_OK:
+            bufferPool->mgmtData = bufferManager;
+            break;
+        default:
+            break;
+        }
+
+        return RC_OK;
+    }
+
+    return RC_OK;
+}
+
+// Helper function to free the frames, page table and replacement state of a pool
+void freeBufferManager(BufferManager *bufferManager)
+{
+    freeFrameChunks(bufferManager);
+    free(bufferManager->pageTable);
+    freeLRUKState(bufferManager);
+    freeQueuePolicy(bufferManager);
+    freeLFUState(bufferManager);
+    free(bufferManager->prefetching);
+    free(bufferManager->warmFile);
+}
+
+/*
+    // Helper functions for batched page transfers and read-ahead
+*/
+
+// Sub-function to pick an unpinned frame for read-ahead, following the pool's replacement order
+PageFrame *chooseReadAheadFrame(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    PageFrame *victim = NULL;
+
+    if (bufferPool->strategy == RS_CLOCK)
+    {
+        victim = findFrameToPin(bufferManager);
+    }
+    else if (bufferPool->strategy == RS_LRU_K)
+    {
+        victim = lrukChooseVictim(bufferManager);
+    }
+    else if (bufferPool->strategy == RS_2Q || bufferPool->strategy == RS_ARC)
+    {
+        victim = queueChooseVictim(bufferManager, NO_PAGE);
+    }
+    else if (bufferPool->strategy == RS_LFU)
+    {
+        victim = lfuChooseVictim(bufferManager);
+    }
+    else if (findAvailableFrame(bufferManager, &victim))
+    {
+        updateLinkedList(bufferManager, victim); // Loaded pages join the tail like a pinned one
+    }
+
+    if (victim != NULL)
+    {
+        victim->referenceCount++; // Hold the frame so the batch cannot choose it twice
+    }
+    return victim;
+}
+
+// Sub-function to write back the dirty victims of a read-ahead batch, dropping frames whose write failed
+int writeBackVictims(BufferManager *bufferManager, SM_FileHandle *fileHandle, PageFrame **frames, PageNumber *pages, int count)
+{
+    SM_IORequest *requests = malloc(sizeof(SM_IORequest) * (count > 0 ? count : 1));
+    int dirty = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (frames[i]->isModified)
+        {
+            requests[dirty].pageNum = frames[i]->pageID;
+            requests[dirty].memPage = frames[i]->pageData;
+            requests[dirty].type = SM_IO_WRITE;
+            dirty++;
+        }
+    }
+    transferBatch(bufferManager, fileHandle, requests, dirty);
+
+    int kept = 0;
+    int next = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (frames[i]->isModified)
+        {
+            SM_IORequest *request = &requests[next++];
+            if (!request->completed || request->result != RC_OK)
+            {
+                frames[i]->referenceCount--; // Keep the dirty page, it is not replaced
+                continue;
+            }
+            frames[i]->isModified = false;
+            __atomic_add_fetch(&bufferManager->writeOperations, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&bufferManager->dirtyEvictions, 1, __ATOMIC_RELAXED);
+        }
+        frames[kept] = frames[i];
+        pages[kept] = pages[i];
+        kept++;
+    }
+
+    free(requests);
+    return kept;
+}
+
+// Sub-function to choose unpinned frames for the listed pages that exist and are not resident, each page once
+// The frames come back held and still mapped to their old pages, dirty ones included
+int chooseReadAheadFrames(BM_BufferPool *const bufferPool, SM_FileHandle *fileHandle, const PageNumber *pageList,
+                          const int numPages, PageFrame **frames, PageNumber *pages)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    int count = 0;
+    for (int i = 0; i < numPages; i++)
+    {
+        PageNumber pageNum = pageList[i];
+        PageNumber filePage;
+        SM_FileHandle *pageFile = (pageNum < 0) ? NULL : resolvePage(bufferManager, pageNum, fileHandle, &filePage);
+        PageNumber filePages = (pageFile == NULL) ? 0 : __atomic_load_n(&pageFile->totalNumPages, __ATOMIC_ACQUIRE); // Grows under the handle latch
+        if (filePage >= filePages || pageTableLookup(bufferManager, pageNum) != NULL)
+        {
+            continue;
+        }
+        bool listed = false;
+        for (int j = 0; j < count && !listed; j++)
+        {
+            listed = (pages[j] == pageNum);
+        }
+        if (listed)
+        {
+            continue;
+        }
+
+        PageFrame *victim = chooseReadAheadFrame(bufferPool);
+        if (victim == NULL)
+        {
+            break; // Every frame is pinned or already taken by this batch
+        }
+        frames[count] = victim;
+        pages[count] = pageNum;
+        count++;
+    }
+    return count;
+}
+
+// Sub-function to take unpinned frames for the listed pages that exist and are not resident, each page once
+// Dirty victims are written back together, the frames come back held and still mapped to their old pages
+int claimReadAheadFrames(BM_BufferPool *const bufferPool, SM_FileHandle *fileHandle, const PageNumber *pageList,
+                         const int numPages, PageFrame **frames, PageNumber *pages)
+{
+    int count = chooseReadAheadFrames(bufferPool, fileHandle, pageList, numPages, frames, pages);
+    return writeBackVictims(bufferPool->mgmtData, fileHandle, frames, pages, count);
+}
+
+// Sub-function to load the listed pages that exist and are not resident into unpinned frames, in one batch
+RC readAheadList(BM_BufferPool *const bufferPool, SM_FileHandle *fileHandle, const PageNumber *pageList, const int numPages)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    PageFrame **frames = malloc(sizeof(PageFrame *) * numPages);
+    PageNumber *pages = malloc(sizeof(PageNumber) * numPages);
+
+    // Victims are written back together, then the new pages are read together
+    int kept = claimReadAheadFrames(bufferPool, fileHandle, pageList, numPages, frames, pages);
+    SM_IORequest *requests = malloc(sizeof(SM_IORequest) * (kept > 0 ? kept : 1));
+    for (int i = 0; i < kept; i++)
+    {
+        requests[i].pageNum = pages[i];
+        requests[i].memPage = frames[i]->pageData;
+        requests[i].type = SM_IO_READ;
+    }
+    RC result = transferBatch(bufferManager, fileHandle, requests, kept);
+
+    for (int i = 0; i < kept; i++)
+    {
+        PageNumber oldPageID = frames[i]->pageID;
+        if (requests[i].completed && requests[i].result == RC_OK)
+        {
+            frames[i]->pageID = requests[i].pageNum;
+            remapFrame(bufferManager, frames[i], oldPageID);
+            notePagePrefetched(bufferManager, requests[i].pageNum);
+            __atomic_add_fetch(&bufferManager->readOperations, 1, __ATOMIC_RELAXED);
+        }
+        else if (oldPageID != NO_PAGE)
+        {
+            pageTableRemove(bufferManager, oldPageID); // The old contents were overwritten
+            notePageEvicted(bufferManager, oldPageID);
+            bufferManager->evictions++;
+            frames[i]->pageID = NO_PAGE;
+        }
+        frames[i]->referenceCount--; // Loaded pages stay resident but unpinned
+    }
+
+    free(requests);
+    free(pages);
+    free(frames);
+    return result;
+}
+
+/*
+    // Helper functions for asynchronous prefetching into single-threaded pools
+*/
+
+// Sub-function to finish the prefetch read of the frame at the given position of the in-flight list
+void completePrefetch(BufferManager *bufferManager, int index)
+{
+    PageFrame *frame = bufferManager->prefetching[index];
+    if (frame->prefetchRead->completed && frame->prefetchRead->result == RC_OK)
+    {
+        __atomic_add_fetch(&bufferManager->readOperations, 1, __ATOMIC_RELAXED);
+        notePagePrefetched(bufferManager, frame->pageID);
+    }
+    else
+    {
+        pageTableRemove(bufferManager, frame->pageID); // A pin of the page reads it again and reports the error
+        frame->pageID = NO_PAGE;
+    }
+    frame->ioPending = false;
+    frame->referenceCount--; // Prefetched pages stay resident but unpinned
+
+    if (--frame->prefetchBatch->unfinished == 0)
+    {
+        free(frame->prefetchBatch);
+    }
+    frame->prefetchBatch = NULL;
+    frame->prefetchRead = NULL;
+    bufferManager->prefetching[index] = bufferManager->prefetching[--bufferManager->numPrefetching];
+}
+
+// Sub-function to finish the prefetch reads that have completed, waiting only for the one of pageNum if it is in flight
+void finishPrefetches(BM_BufferPool *const bufferPool, PageNumber pageNum)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    if (bufferManager->numPrefetching == 0)
+    {
+        return;
+    }
+
+    reapBlockIO(&bufferPool->fH, 0);
+    for (int i = bufferManager->numPrefetching - 1; i >= 0; i--) // Backwards, finished entries are replaced by the last one
+    {
+        PageFrame *frame = bufferManager->prefetching[i];
+        if (frame->pageID == pageNum && !frame->prefetchRead->completed)
+        {
+            long long start = currentTimeNanos();
+            waitBlockIO(&bufferPool->fH, frame->prefetchRead, 1); // A read that was never submitted fails here
+            bufferManager->readIOTime += currentTimeNanos() - start;
+            notePinWait(bufferManager, start);
+        }
+        if (frame->prefetchRead->completed || frame->pageID == pageNum)
+        {
+            completePrefetch(bufferManager, i);
+        }
+    }
+}
+
+// Sub-function to wait for every prefetch read in flight, before the frames are flushed or freed
+void waitForPrefetches(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    while (bufferManager->numPrefetching > 0)
+    {
+        finishPrefetches(bufferPool, bufferManager->prefetching[0]->pageID);
+    }
+}
+
+// Sub-function to start reading the listed pages into unpinned frames without waiting for them
+// The frames are mapped to their new pages right away, a pin of one of them waits for its read only
+RC prefetchList(BM_BufferPool *const bufferPool, const PageNumber *pageList, const int numPages)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    if (bufferManager->prefetching == NULL)
+    {
+        bufferManager->prefetching = malloc(sizeof(PageFrame *) * bufferManager->totalPageFrames);
+    }
+    PageFrame **frames = malloc(sizeof(PageFrame *) * numPages);
+    PageNumber *pages = malloc(sizeof(PageNumber) * numPages);
+    if (bufferManager->prefetching == NULL || frames == NULL || pages == NULL)
+    {
+        free(frames);
+        free(pages);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    // Frames of reads that have finished can be taken again
+    finishPrefetches(bufferPool, NO_PAGE);
+    int kept = claimReadAheadFrames(bufferPool, &bufferPool->fH, pageList, numPages, frames, pages);
+    PrefetchBatch *batch = malloc(sizeof(PrefetchBatch) + sizeof(SM_IORequest) * (kept > 0 ? kept : 1));
+    if (kept == 0 || batch == NULL)
+    {
+        for (int i = 0; i < kept; i++)
+        {
+            frames[i]->referenceCount--;
+        }
+        free(batch);
+        free(frames);
+        free(pages);
+        return (kept == 0) ? RC_OK : RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    batch->unfinished = kept;
+    for (int i = 0; i < kept; i++)
+    {
+        PageNumber oldPageID = frames[i]->pageID;
+        batch->requests[i].pageNum = pages[i];
+        batch->requests[i].memPage = frames[i]->pageData;
+        batch->requests[i].type = SM_IO_READ;
+        batch->requests[i].completed = 0;
+        frames[i]->pageID = pages[i];
+        frames[i]->ioPending = true;
+        frames[i]->prefetchBatch = batch;
+        frames[i]->prefetchRead = &batch->requests[i];
+        remapFrame(bufferManager, frames[i], oldPageID); // The frame stays held until its read is finished
+        bufferManager->prefetching[bufferManager->numPrefetching++] = frames[i];
+    }
+
+    long long start = currentTimeNanos();
+    RC result = submitBlockIO(&bufferPool->fH, batch->requests, kept);
+    bufferManager->readIOTime += currentTimeNanos() - start;
+    if (result != RC_OK)
+    {
+        waitForPrefetches(bufferPool); // Settle what was submitted, the rest fails and leaves its frames empty
+    }
+
+    free(frames);
+    free(pages);
+    return result;
+}
+
+/*
+    // Helper functions for the background writer of dirty pages
+*/
+
+// Sub-function to tell whether LRU-K evicts the left frame before the right one, both unpinned and holding pages
+bool lrukEvictsBefore(LRUKState *state, PageFrame *left, PageFrame *right)
+{
+    LRUKHistory *leftHistory = lrukLookup(state, left->pageID);
+    LRUKHistory *rightHistory = lrukLookup(state, right->pageID);
+    long long leftKth = (leftHistory != NULL) ? leftHistory->times[state->k - 1] : 0;
+    long long rightKth = (rightHistory != NULL) ? rightHistory->times[state->k - 1] : 0;
+    long long leftLast = (leftHistory != NULL) ? leftHistory->last : 0;
+    long long rightLast = (rightHistory != NULL) ? rightHistory->last : 0;
+    return leftKth < rightKth || (leftKth == rightKth && leftLast < rightLast);
+}
+
+// Sub-function to tell whether the background writer may take a frame, it must be unpinned and not in transfer
+bool isCleaningCandidate(PageFrame *frame)
+{
+    return frame->referenceCount == 0 && !frame->ioPending;
+}
+
+// Sub-function to add the frames of one queue of 2Q or ARC, oldest first
+int collectQueueCandidates(BufferManager *shardManager, int queueID, PageFrame **frames, int count, int limit)
+{
+    QueuePolicy *policy = shardManager->queuePolicy;
+    for (int node = policy->queues[queueID].tail; node != -1 && count < limit; node = policy->nodes[node].prev)
+    {
+        PageFrame *frame = pageTableLookup(shardManager, policy->nodes[node].pageID);
+        if (frame != NULL && isCleaningCandidate(frame))
+        {
+            frames[count++] = frame;
+        }
+    }
+    return count;
+}
+
+// Sub-function to list up to limit frames of a shard in the order its strategy would evict them
+// FIFO and LRU keep that order in the frame list, CLOCK follows its hand, the other strategies rank their own state
+int collectCleaningCandidates(BufferManager *shardManager, ReplacementStrategy strategy, PageFrame **frames, int limit)
+{
+    bool fromHand = (strategy == RS_CLOCK && shardManager->currentFramePtr != NULL);
+    PageFrame *start = fromHand ? shardManager->currentFramePtr : shardManager->firstFrame;
+    PageFrame *currentFrame = start;
+    int count = 0;
+
+    if (strategy == RS_LFU)
+    {
+        for (LFUBucket *bucket = shardManager->lfu->lowest; bucket != NULL && count < limit; bucket = bucket->higher)
+        {
+            for (PageFrame *frame = bucket->oldest; frame != NULL && count < limit; frame = frame->lfuNewer)
+            {
+                if (isCleaningCandidate(frame))
+                {
+                    frames[count++] = frame;
+                }
+            }
+        }
+        return count;
+    }
+
+    // Empty frames are used first by 2Q, ARC and LRU-K, CLOCK takes frames whose reference bit is clear first
+    do
+    {
+        bool first = (strategy == RS_CLOCK) ? !currentFrame->accessed
+                   : (strategy == RS_FIFO || strategy == RS_LRU) ? true
+                   : currentFrame->pageID == NO_PAGE;
+        if (first && isCleaningCandidate(currentFrame))
+        {
+            frames[count++] = currentFrame;
+        }
+        currentFrame = currentFrame->nextFrame;
+    } while (currentFrame != start && count < limit);
+    if (count == limit)
+    {
+        return count;
+    }
+
+    if (strategy == RS_CLOCK)
+    {
+        do
+        {
+            if (currentFrame->accessed && isCleaningCandidate(currentFrame))
+            {
+                frames[count++] = currentFrame;
+            }
+            currentFrame = currentFrame->nextFrame;
+        } while (currentFrame != start && count < limit);
+    }
+    else if (strategy == RS_2Q || strategy == RS_ARC)
+    {
+        bool fromRecent = queueTakesRecentFirst(shardManager->queuePolicy, NO_PAGE);
+        count = collectQueueCandidates(shardManager, fromRecent ? QUEUE_RECENT : QUEUE_FREQUENT, frames, count, limit);
+        count = collectQueueCandidates(shardManager, fromRecent ? QUEUE_FREQUENT : QUEUE_RECENT, frames, count, limit);
+    }
+    else if (strategy == RS_LRU_K)
+    {
+        // Selection of the next victims one at a time, the writer runs off the pin path so the quadratic cost is fine
+        int filled = count;
+        do
+        {
+            if (currentFrame->pageID != NO_PAGE && isCleaningCandidate(currentFrame))
+            {
+                if (filled < limit)
+                {
+                    frames[filled++] = currentFrame;
+                }
+                else if (lrukEvictsBefore(shardManager->lruK, currentFrame, frames[limit - 1]))
+                {
+                    frames[limit - 1] = currentFrame;
+                }
+                else
+                {
+                    currentFrame = currentFrame->nextFrame;
+                    continue;
+                }
+
+                // Keep the ranked part sorted by sinking the new frame into place
+                for (int i = filled - 1; i > count && lrukEvictsBefore(shardManager->lruK, frames[i], frames[i - 1]); i--)
+                {
+                    PageFrame *swap = frames[i];
+                    frames[i] = frames[i - 1];
+                    frames[i - 1] = swap;
+                }
+            }
+            currentFrame = currentFrame->nextFrame;
+        } while (currentFrame != start);
+        count = filled;
+    }
+    return count;
+}
+
+// Sub-function to write dirty frames of a shard without its latch, called and returning with the latch held
+// The frames are held like a dirty victim of a pin, so pinners of their pages wait for the writes
+// They count as clean from the start, a markDirty during the write keeps the page dirty and failed pages become dirty again
+RC writeShardFrames(BM_BufferPool *const bufferPool, BM_Shard *shard, PageFrame **frames, int count, bool *written)
+{
+    if (count == 0)
+    {
+        return RC_OK;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        frames[i]->referenceCount++;
+        frames[i]->ioPending = true;
+        frames[i]->isModified = false;
+    }
+    pthread_mutex_unlock(&shard->latch);
+    RC result = writeDirtyFrames(shard->pool.mgmtData, &bufferPool->fH, frames, count, written);
+    pthread_mutex_lock(&shard->latch);
+
+    for (int i = 0; i < count; i++)
+    {
+        if (!written[i])
+        {
+            frames[i]->isModified = true;
+        }
+        frames[i]->referenceCount--;
+        frames[i]->ioPending = false;
+    }
+    pthread_cond_broadcast(&shard->ioDone);
+    return result;
+}
+
+// Sub-function to write the dirty pages among a shard's next victims, the shard latch is not held during the writes
+void cleanShard(BM_BufferPool *const bufferPool, BM_Shard *shard, PageFrame **frames, bool *written)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    BufferManager *shardManager = shard->pool.mgmtData;
+    int target = (int)(bufferManager->cleanFraction * shard->pool.numPages + 0.999999);
+    if (target < 1)
+    {
+        target = 1;
+    }
+
+    // Reserve the dirty candidates like a dirty victim of a pin, pinners of their pages wait for the write
+    pthread_mutex_lock(&shard->latch);
+    int candidates = collectCleaningCandidates(shardManager, shard->pool.strategy, frames, target);
+    int count = 0;
+    for (int i = 0; i < candidates; i++)
+    {
+        if (frames[i]->isModified)
+        {
+            frames[count++] = frames[i];
+        }
+    }
+    writeShardFrames(bufferPool, shard, frames, count, written); // Failed pages stay dirty for the pin
+    pthread_mutex_unlock(&shard->latch);
+}
+
+// Body of the background writer, one pass over all shards every interval until it is stopped
+void *runCleaner(void *arg)
+{
+    BM_BufferPool *bufferPool = arg;
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    PageFrame **frames = malloc(sizeof(PageFrame *) * bufferPool->numPages);
+    bool *written = malloc(sizeof(bool) * bufferPool->numPages);
+
+    pthread_mutex_lock(&bufferManager->cleanerLatch);
+    while (!bufferManager->stopCleaner)
+    {
+        pthread_mutex_unlock(&bufferManager->cleanerLatch);
+        for (int i = 0; i < bufferManager->numShards && frames != NULL && written != NULL; i++)
+        {
+            cleanShard(bufferPool, &bufferManager->shards[i], frames, written);
+        }
+        pthread_mutex_lock(&bufferManager->cleanerLatch);
+        if (bufferManager->stopCleaner)
+        {
+            break;
+        }
+
+        struct timespec wakeAt;
+        clock_gettime(CLOCK_REALTIME, &wakeAt);
+        long long nanos = wakeAt.tv_nsec + (long long)bufferManager->cleanIntervalMs * 1000000LL;
+        wakeAt.tv_sec += nanos / 1000000000LL;
+        wakeAt.tv_nsec = nanos % 1000000000LL;
+        pthread_cond_timedwait(&bufferManager->cleanerWake, &bufferManager->cleanerLatch, &wakeAt);
+    }
+    pthread_mutex_unlock(&bufferManager->cleanerLatch);
+
+    free(frames);
+    free(written);
+    return NULL;
+}
+
+// Sub-function to wake the background writer before its interval is over, a no-op for pools without one
+void wakeCleaner(BufferManager *bufferManager)
+{
+    if (bufferManager->cleanerActive)
+    {
+        pthread_mutex_lock(&bufferManager->cleanerLatch);
+        pthread_cond_signal(&bufferManager->cleanerWake);
+        pthread_mutex_unlock(&bufferManager->cleanerLatch);
+    }
+}
+
+// Sub-function to start the background writer of a thread-safe pool
+RC startCleaner(BM_BufferPool *const bufferPool, double cleanFraction, int cleanIntervalMs)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    bufferManager->cleanFraction = cleanFraction;
+    bufferManager->cleanIntervalMs = (cleanIntervalMs > 0) ? cleanIntervalMs : 10;
+    bufferManager->stopCleaner = false;
+    pthread_mutex_init(&bufferManager->cleanerLatch, NULL);
+    pthread_cond_init(&bufferManager->cleanerWake, NULL);
+
+    if (pthread_create(&bufferManager->cleaner, NULL, runCleaner, bufferPool) != 0)
+    {
+        pthread_cond_destroy(&bufferManager->cleanerWake);
+        pthread_mutex_destroy(&bufferManager->cleanerLatch);
+        return RC_WRITE_FAILED;
+    }
+    bufferManager->cleanerActive = true;
+    return RC_OK;
+}
+
+// Sub-function to stop the background writer and wait for its last pass, a no-op for pools without one
+void stopCleaner(BufferManager *bufferManager)
+{
+    if (!bufferManager->cleanerActive)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&bufferManager->cleanerLatch);
+    bufferManager->stopCleaner = true;
+    pthread_cond_signal(&bufferManager->cleanerWake);
+    pthread_mutex_unlock(&bufferManager->cleanerLatch);
+    pthread_join(bufferManager->cleaner, NULL);
+
+    bufferManager->cleanerActive = false;
+    pthread_cond_destroy(&bufferManager->cleanerWake);
+    pthread_mutex_destroy(&bufferManager->cleanerLatch);
+}
+
+/*
+    // Helper functions for thread-safe pools split into shards
+*/
+
+// Sub-function to find the shard a page belongs to (Fibonacci hashing, so runs of pages spread over all shards)
+BM_Shard *shardOf(BufferManager *bufferManager, PageNumber pageNum)
+{
+    unsigned long long key = (unsigned long long)pageNum * 11400714819323198485ull;
+    return &bufferManager->shards[(key >> 32) % bufferManager->numShards];
+}
+
+// Sub-function to tell whether some frame of a shard is held for a transfer made without the shard latch
+bool shardHasTransfers(BufferManager *shardManager)
+{
+    PageFrame *currentFrame = shardManager->firstFrame;
+    do
+    {
+        if (currentFrame->ioPending)
+        {
+            return true;
+        }
+        currentFrame = currentFrame->nextFrame;
+    } while (currentFrame != shardManager->firstFrame);
+    return false;
+}
+
+// Sub-function to write back the dirty victim of a deferred pin, called without the shard latch
+RC cleanVictimFrame(BM_BufferPool *const bufferPool, BufferManager *shardManager, PageFrame *victim)
+{
+    return writeBackIfDirty(victim, &bufferPool->fH, shardManager); // The storage manager latches its own bookkeeping
+}
+
+// Sub-function to read the page a deferred pin mapped to a frame, called without the shard latch
+RC loadPendingFrame(BM_BufferPool *const bufferPool, BufferManager *shardManager, PageFrame *frame)
+{
+    PageNumber filePage;
+    SM_FileHandle *fileHandle = resolvePage(shardManager, frame->pageID, &bufferPool->fH, &filePage);
+    RC result = ensureCapacity(filePage, fileHandle);
+    if (result == RC_OK)
+    {
+        result = readFrameData(frame, frame->pageID, &bufferPool->fH, shardManager);
+    }
+    if (result == RC_OK)
+    {
+        __atomic_add_fetch(&shardManager->readOperations, 1, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+// Sub-function to wait under the shard latch until a transfer has finished, counted as a wait of the pin
+void waitForTransfer(BufferManager *bufferManager, BM_Shard *shard)
+{
+    long long start = currentTimeNanos();
+    pthread_cond_wait(&shard->ioDone, &shard->latch);
+    notePinWait(bufferManager, start);
+}
+
+// Pinning a page of a thread-safe pool, the shard latch is held for the lookup and the strategy but not for I/O
+RC pinSharded(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum)
+{
+    BM_Shard *shard = shardOf(bufferPool->mgmtData, pageNum);
+    BufferManager *shardManager = shard->pool.mgmtData;
+    long long start = shardManager->pinTiming ? currentTimeNanos() : 0;
+    bool loaded = false;
+    RC result;
+
+    // The clock is only read when the latch is taken, uncontended pins pay for the try alone
+    if (pthread_mutex_trylock(&shard->latch) != 0)
+    {
+        long long waitStart = currentTimeNanos();
+        pthread_mutex_lock(&shard->latch);
+        notePinWait(bufferPool->mgmtData, waitStart);
+    }
+    while (true)
+    {
+        // A page in transfer is pinned once it has arrived, or loaded again if its read failed
+        PageFrame *resident = pageTableLookup(shardManager, pageNum);
+        if (resident != NULL && resident->ioPending)
+        {
+            waitForTransfer(bufferPool->mgmtData, shard);
+            continue;
+        }
+
+        shardManager->pendingFrame = NULL;
+        result = pinWithStrategy(&shard->pool, pageHandle, pageNum);
+        shardManager->retryingPin = true; // Choosing again is part of the same pin
+        if (result == RC_IM_NO_MORE_ENTRIES && shardHasTransfers(shardManager))
+        {
+            waitForTransfer(bufferPool->mgmtData, shard); // Frames held only for a transfer are free again soon
+            continue;
+        }
+        if (result != RC_BM_VICTIM_DIRTY)
+        {
+            break;
+        }
+
+        // Hold the dirty victim while it is written, its page stays resident so pinners of it wait, then choose again
+        // The background writer, if any, was too slow for this shard, so it is woken to catch up
+        wakeCleaner(bufferPool->mgmtData);
+        PageFrame *victim = shardManager->pendingFrame;
+        victim->referenceCount++;
+        victim->ioPending = true;
+        pthread_mutex_unlock(&shard->latch);
+        result = cleanVictimFrame(bufferPool, shardManager, victim);
+        pthread_mutex_lock(&shard->latch);
+        victim->referenceCount--;
+        victim->ioPending = false;
+        pthread_cond_broadcast(&shard->ioDone);
+        if (result != RC_OK)
+        {
+            break;
+        }
+    }
+    shardManager->retryingPin = false;
+
+    PageFrame *frame = shardManager->pendingFrame;
+    if (result == RC_OK && frame != NULL && frame->ioPending)
+    {
+        // The frame is pinned and mapped to the page already, nobody else touches its data until ioPending clears
+        pthread_mutex_unlock(&shard->latch);
+        result = loadPendingFrame(bufferPool, shardManager, frame);
+        pthread_mutex_lock(&shard->latch);
+        frame->ioPending = false;
+        loaded = true;
+        if (result != RC_OK)
+        {
+            pageTableRemove(shardManager, pageNum); // Waiting pinners find the page missing and try the read themselves
+            notePageEvicted(shardManager, pageNum);
+            frame->pageID = NO_PAGE;
+            frame->referenceCount--;
+        }
+        pageHandle->data = frame->pageData; // Frames of mapped pools only have data once loaded
+        pthread_cond_broadcast(&shard->ioDone);
+    }
+    if (result == RC_OK)
+    {
+        notePin(shardManager, !loaded, start);
+    }
+    pthread_mutex_unlock(&shard->latch);
+    return result;
+}
+
+// Sub-function to find the frame of a page the caller has pinned, through the shard latch in thread-safe pools
+// The frame reference of the handle's pin is used while its generation matches, handles without one fall back to
+// the page table and only find the frame if their data is the frame's; a NULL handle just asks for the page's frame
+PageFrame *findPinnedFrame(BM_BufferPool *const pool, BM_PageHandle *const pageHandle, PageNumber pageNum)
+{
+    BM_BufferPool *bufferPool = targetPool(pool, &pageNum); // Files of the process-wide pool find their page by its key
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    BM_Shard *shard = NULL;
+    if (bufferManager->shards != NULL)
+    {
+        shard = shardOf(bufferManager, pageNum);
+        pthread_mutex_lock(&shard->latch);
+        bufferManager = shard->pool.mgmtData;
+    }
+
+    PageFrame *frame = referencedFrame(bufferManager, pageHandle, pageNum);
+    if (frame == NULL)
+    {
+        frame = pageTableLookup(bufferManager, pageNum);
+        if (frame != NULL && pageHandle != NULL && frame->pageData != pageHandle->data)
+        {
+            frame = NULL; // The handle's data comes from outside the pool
+        }
+    }
+    if (shard != NULL)
+    {
+        pthread_mutex_unlock(&shard->latch);
+    }
+    return frame;
+}
+
+// Sub-function to take the shared latch of the frame a forced page is written from, NULL if none is taken
+// A handle holding a latch writes under it, data from outside the pool needs none
+PageFrame *latchForcedFrame(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, PageNumber pageNum)
+{
+    if (pageHandle->latch != BM_LATCH_NONE)
+    {
+        return NULL;
+    }
+    PageFrame *frame = findPinnedFrame(bufferPool, pageHandle, pageNum);
+    if (frame != NULL)
+    {
+        pthread_rwlock_rdlock(&frame->latch); // Waits for an exclusive holder to finish its change
+    }
+    return frame;
+}
+
+// Sub-function to run an operation of a single-threaded pool on the page's shard under its latch
+RC callOnShard(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum,
+               RC (*operation)(BM_BufferPool *const, BM_PageHandle *const, const PageNumber))
+{
+    BM_Shard *shard = shardOf(bufferPool->mgmtData, pageNum);
+    pthread_mutex_lock(&shard->latch);
+    RC result = operation(&shard->pool, pageHandle, pageNum);
+    pthread_mutex_unlock(&shard->latch);
+    return result;
+}
+
+// Sub-function to write a page handle's data through a thread-safe pool, counted by the page's shard
+RC forcePageSharded(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum)
+{
+    BufferManager *shardManager = shardOf(bufferPool->mgmtData, pageNum)->pool.mgmtData;
+    RC result = writePageData(shardManager, pageNum, &bufferPool->fH, pageHandle->data);
+    if (result == RC_OK)
+    {
+        __atomic_add_fetch(&shardManager->writeOperations, 1, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+// Sub-function to write a dirty frame of a shard a flush passed over, called and returning with the shard latch held
+// Only this frame is held while the flush waits for its latch, so the latch holder can pin and unpin meanwhile
+RC flushLatchedFrame(BM_BufferPool *const bufferPool, BM_Shard *shard, PageFrame *frame)
+{
+    frame->referenceCount++; // The page stays in its frame while the flush waits
+    pthread_mutex_unlock(&shard->latch);
+    int latched = pthread_rwlock_rdlock(&frame->latch);
+    pthread_mutex_lock(&shard->latch);
+
+    // A thread flushing a page it holds exclusively itself would wait forever, so that page fails to write instead
+    RC result = RC_WRITE_FAILED;
+    if (latched == 0)
+    {
+        while (frame->ioPending)
+        {
+            pthread_cond_wait(&shard->ioDone, &shard->latch);
+        }
+        bool written = true;
+        result = frame->isModified ? writeShardFrames(bufferPool, shard, &frame, 1, &written) : RC_OK;
+        pthread_rwlock_unlock(&frame->latch); // Read latches can be taken twice, the write took its own
+    }
+    frame->referenceCount--;
+    return result;
+}
+
+// Sub-function to flush one shard, its dirty pages are written without the shard latch
+// Frames another thread holds for a transfer are waited for, their page may be a dirty one that is being written
+RC flushShard(BM_BufferPool *const bufferPool, BM_Shard *shard, BM_SharedFile *file)
+{
+    BufferManager *shardManager = shard->pool.mgmtData;
+    pthread_mutex_lock(&shard->latch);
+    int capacity = shardManager->totalPageFrames;
+    PageFrame **frames = malloc(sizeof(PageFrame *) * capacity);
+    bool *written = malloc(sizeof(bool) * capacity);
+    if (frames == NULL || written == NULL)
+    {
+        pthread_mutex_unlock(&shard->latch);
+        free(frames);
+        free(written);
+        return RC_WRITE_FAILED;
+    }
+
+    // Frames to write fill the array from the front, frames in transfer from the back
+    int count = 0;
+    int busy = capacity;
+    PageFrame *currentFrame = shardManager->firstFrame;
+    do
+    {
+        bool ours = (file == NULL || holdsFilePage(shardManager, currentFrame, file)); // Other files flush their own
+        if (ours && currentFrame->ioPending)
+        {
+            frames[--busy] = currentFrame;
+        }
+        else if (ours && currentFrame->isModified)
+        {
+            frames[count++] = currentFrame;
+        }
+        currentFrame = currentFrame->nextFrame;
+    } while (currentFrame != shardManager->firstFrame);
+
+    RC result = writeShardFrames(bufferPool, shard, frames, count, written);
+    for (int i = busy; i < capacity; i++)
+    {
+        while (frames[i]->ioPending)
+        {
+            pthread_cond_wait(&shard->ioDone, &shard->latch);
+        }
+    }
+
+    // Pages in change under an exclusive latch were passed over, the flush waits for them one at a time
+    for (int i = 0; i < count; i++)
+    {
+        if (!written[i] && frames[i]->isModified)
+        {
+            RC frameResult = flushLatchedFrame(bufferPool, shard, frames[i]);
+            if (frameResult != RC_OK && result == RC_OK)
+            {
+                result = frameResult;
+            }
+        }
+    }
+    pthread_mutex_unlock(&shard->latch);
+    free(frames);
+    free(written);
+    return result;
+}
+
+// Sub-function to flush every shard, one after the other
+RC flushShards(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    RC result = RC_OK;
+
+    for (int i = 0; i < bufferManager->numShards; i++)
+    {
+        RC shardResult = flushShard(bufferPool, &bufferManager->shards[i], NULL);
+        if (shardResult != RC_OK && result == RC_OK)
+        {
+            result = shardResult; // Keep flushing, report the first failure
+        }
+    }
+    return result;
+}
+
+// Sub-function to read ahead the pages of one shard, its latch is only held to choose, map and release the frames
+// The frames are held for their transfers, pinners of their old pages wait for the write back and of the new ones for the read
+RC readAheadShard(BM_BufferPool *const bufferPool, BM_Shard *shard, const PageNumber *pageList, int numPages)
+{
+    BufferManager *shardManager = shard->pool.mgmtData;
+    PageFrame **frames = malloc(sizeof(PageFrame *) * numPages);
+    PageFrame **dirty = malloc(sizeof(PageFrame *) * numPages);
+    PageNumber *pages = malloc(sizeof(PageNumber) * numPages);
+    bool *written = malloc(sizeof(bool) * numPages);
+    SM_IORequest *requests = malloc(sizeof(SM_IORequest) * numPages);
+    if (frames == NULL || dirty == NULL || pages == NULL || written == NULL || requests == NULL)
+    {
+        free(frames);
+        free(dirty);
+        free(pages);
+        free(written);
+        free(requests);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    // Choose the frames and write back the dirty ones, they keep their old pages until then
+    pthread_mutex_lock(&shard->latch);
+    int count = chooseReadAheadFrames(&shard->pool, &bufferPool->fH, pageList, numPages, frames, pages);
+    int numDirty = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (frames[i]->isModified)
+        {
+            dirty[numDirty++] = frames[i];
+        }
+    }
+    if (numDirty > 0)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            frames[i]->ioPending = true; // Clean victims wait too, their pages could be pinned again meanwhile
+        }
+        writeShardFrames(bufferPool, shard, dirty, numDirty, written); // Victims that stay dirty keep their page
+        for (int i = 0; i < numDirty; i++)
+        {
+            if (written[i])
+            {
+                __atomic_add_fetch(&shardManager->dirtyEvictions, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    // Map the frames to their new pages, unless a write failed or another pin loaded the page meanwhile
+    int kept = 0;
+    for (int i = 0; i < count; i++)
+    {
+        PageFrame *frame = frames[i];
+        if (frame->isModified || pageTableLookup(shardManager, pages[i]) != NULL)
+        {
+            frame->ioPending = false;
+            frame->referenceCount--;
+            continue;
+        }
+        PageNumber oldPageID = frame->pageID;
+        frame->pageID = pages[i];
+        frame->ioPending = true;
+        remapFrame(shardManager, frame, oldPageID);
+        requests[kept].pageNum = pages[i];
+        requests[kept].memPage = frame->pageData;
+        requests[kept].type = SM_IO_READ;
+        frames[kept++] = frame;
+    }
+    pthread_cond_broadcast(&shard->ioDone);
+    pthread_mutex_unlock(&shard->latch);
+
+    RC result = transferBatch(shardManager, &bufferPool->fH, requests, kept);
+
+    pthread_mutex_lock(&shard->latch);
+    for (int i = 0; i < kept; i++)
+    {
+        if (requests[i].completed && requests[i].result == RC_OK)
+        {
+            notePagePrefetched(shardManager, requests[i].pageNum);
+            __atomic_add_fetch(&shardManager->readOperations, 1, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            pageTableRemove(shardManager, requests[i].pageNum); // A pin of the page reads it again and reports the error
+            frames[i]->pageID = NO_PAGE;
+        }
+        frames[i]->ioPending = false;
+        frames[i]->referenceCount--; // Loaded pages stay resident but unpinned
+    }
+    pthread_cond_broadcast(&shard->ioDone);
+    pthread_mutex_unlock(&shard->latch);
+
+    free(frames);
+    free(dirty);
+    free(pages);
+    free(written);
+    free(requests);
+    return result;
+}
+
+// Sub-function to read ahead in a thread-safe pool, every shard loads its own pages of the list
+RC readAheadSharded(BM_BufferPool *const bufferPool, const PageNumber *pageList, const int numPages)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    PageNumber *shardPages = malloc(sizeof(PageNumber) * numPages);
+    RC result = RC_OK;
+    if (shardPages == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    for (int i = 0; i < bufferManager->numShards; i++)
+    {
+        BM_Shard *shard = &bufferManager->shards[i];
+        int count = 0;
+        for (int j = 0; j < numPages; j++)
+        {
+            if (pageList[j] >= 0 && shardOf(bufferManager, pageList[j]) == shard)
+            {
+                shardPages[count++] = pageList[j];
+            }
+        }
+        if (count == 0)
+        {
+            continue;
+        }
+
+        RC shardResult = readAheadShard(bufferPool, shard, shardPages, count);
+        if (shardResult != RC_OK && result == RC_OK)
+        {
+            result = shardResult;
+        }
+    }
+
+    free(shardPages);
+    return result;
+}
+
+// Sub-function to copy the frame statistics of every shard into pool-wide arrays, shard by shard; NULL arrays are skipped
+void gatherShardFrames(BufferManager *bufferManager, PageNumber *frameNumbers, bool *dirtyFlags, int *fixCounts)
+{
+    int offset = 0;
+    for (int i = 0; i < bufferManager->numShards; i++)
+    {
+        BM_Shard *shard = &bufferManager->shards[i];
+        pthread_mutex_lock(&shard->latch);
+        FrameStatistics *statHead = ((BufferManager *)shard->pool.mgmtData)->statsHead;
+        int count = 0;
+        if (frameNumbers != NULL)
+        {
+            retrieveFrameContents(statHead, frameNumbers + offset, &count, shard->pool.numPages);
+        }
+        if (dirtyFlags != NULL)
+        {
+            retrieveDirtyFlags(statHead, dirtyFlags + offset, shard->pool.numPages);
+        }
+        if (fixCounts != NULL)
+        {
+            retrieveFixCounts(statHead, fixCounts + offset, shard->pool.numPages);
+        }
+        pthread_mutex_unlock(&shard->latch);
+        offset += shard->pool.numPages;
+    }
+}
+
+// Sub-function to add up the I/O counters of the shards into the pool's own, a no-op for single-threaded pools
+// Files of the process-wide pool take the counters of their own transfers instead
+void gatherShardIO(BufferManager *bufferManager)
+{
+    if (bufferManager->sharedFile != NULL)
+    {
+        gatherFileIO(bufferManager); // Files of the process-wide pool count their own transfers
+        return;
+    }
+    if (bufferManager->shards == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&bufferManager->fileLatch);
+    bufferManager->readOperations = 0;
+    bufferManager->writeOperations = 0;
+    bufferManager->readIOTime = 0;
+    bufferManager->writeIOTime = 0;
+    for (int i = 0; i < bufferManager->numShards; i++)
+    {
+        BufferManager *shardManager = bufferManager->shards[i].pool.mgmtData;
+        bufferManager->readOperations += __atomic_load_n(&shardManager->readOperations, __ATOMIC_RELAXED);
+        bufferManager->writeOperations += __atomic_load_n(&shardManager->writeOperations, __ATOMIC_RELAXED);
+        bufferManager->readIOTime += __atomic_load_n(&shardManager->readIOTime, __ATOMIC_RELAXED);
+        bufferManager->writeIOTime += __atomic_load_n(&shardManager->writeIOTime, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&bufferManager->fileLatch);
+}
+
+// Sub-function to free the shards of a thread-safe pool, a no-op for single-threaded pools
+void freeShards(BufferManager *bufferManager)
+{
+    if (bufferManager->shards == NULL)
+    {
+        return;
+    }
+
+    for (int i = 0; i < bufferManager->numShards; i++)
+    {
+        BM_Shard *shard = &bufferManager->shards[i];
+        freeBufferManager(shard->pool.mgmtData);
+        free(shard->pool.mgmtData);
+        pthread_cond_destroy(&shard->ioDone);
+        pthread_mutex_destroy(&shard->latch);
+    }
+    free(bufferManager->shards);
+    bufferManager->shards = NULL;
+    pthread_mutex_destroy(&bufferManager->fileLatch);
+}
+
+// Sub-function to set up a thread-safe pool, its frames are dealt out over the shards
+RC initShardedPool(BM_BufferPool *const bufferPool, const char *const fileName, const int totalFrames,
+                   ReplacementStrategy strategy, void *strategyData, bool mappedIO, int numShards)
+{
+    BufferManager *bufferManager = calloc(1, sizeof(BufferManager));
+    BM_Shard *shards = calloc(numShards, sizeof(BM_Shard));
+    if (bufferManager == NULL || shards == NULL)
+    {
+        free(bufferManager);
+        free(shards);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    initializeBufferManager(bufferManager, totalFrames, strategyData);
+    bufferManager->mappedIO = mappedIO;
+    bufferManager->pageSize = bufferPool->fH.pageSize;
+    bufferManager->shards = shards;
+    bufferManager->numShards = 0;
+    pthread_mutex_init(&bufferManager->fileLatch, NULL);
+
+    for (int i = 0; i < numShards; i++)
+    {
+        // The first shards take one frame more when the frames do not divide evenly
+        int frames = totalFrames / numShards + ((i < totalFrames % numShards) ? 1 : 0);
+        BM_Shard *shard = &shards[i];
+        shard->pool.fH = bufferPool->fH; // A copy for the page size, transfers use the pool's handle
+        RC result = buildBufferManager(&shard->pool, fileName, frames, strategy, strategyData, mappedIO);
+        if (result != RC_OK)
+        {
+            freeShards(bufferManager); // Only the shards built so far are counted
+            free(bufferManager);
+            return result;
+        }
+        ((BufferManager *)shard->pool.mgmtData)->deferredIO = true;
+        pthread_mutex_init(&shard->latch, NULL);
+        pthread_cond_init(&shard->ioDone, NULL);
+        bufferManager->numShards = i + 1;
+    }
+
+    bufferPool->numPages = totalFrames;
+    bufferPool->pageFile = (char *)fileName;
+    bufferPool->strategy = strategy;
+    bufferPool->mgmtData = bufferManager;
+    return RC_OK;
+}
+
+/*
+    // Helper functions for resizing a pool while it is in use
+*/
+
+// Sub-function to find the statistics entry of a frame in the chunk that holds it
+FrameStatistics *frameStatistics(BufferManager *bufferManager, PageFrame *frame)
+{
+    for (FrameChunk *chunk = bufferManager->frameChunks; chunk != NULL; chunk = chunk->next)
+    {
+        if (frame >= chunk->frames && frame < chunk->frames + chunk->count)
+        {
+            return &chunk->stats[frame - chunk->frames];
+        }
+    }
+    return NULL;
+}
+
+// Sub-function to count the frames a shrink may take, those no pin, transfer or prefetch holds
+int countUnpinnedFrames(BufferManager *bufferManager)
+{
+    int count = 0;
+    PageFrame *currentFrame = bufferManager->firstFrame;
+    do
+    {
+        if (currentFrame->referenceCount == 0)
+        {
+            count++;
+        }
+        currentFrame = currentFrame->nextFrame;
+    } while (currentFrame != bufferManager->firstFrame);
+    return count;
+}
+
+// Sub-function to allocate an empty page table and replacement state for a new number of frames into a scratch manager
+RC createResizedState(BufferManager *bufferManager, ReplacementStrategy strategy, int totalFrames, BufferManager *resized)
+{
+    memset(resized, 0, sizeof(BufferManager));
+    RC result = createPageTable(resized, totalFrames);
+    if (result == RC_OK && bufferManager->lruK != NULL)
+    {
+        result = createLRUKState(resized, totalFrames, &bufferManager->lruK->k);
+    }
+    if (result == RC_OK && bufferManager->queuePolicy != NULL)
+    {
+        result = createQueuePolicy(resized, totalFrames, strategy);
+    }
+    if (result != RC_OK)
+    {
+        free(resized->pageTable);
+        freeLRUKState(resized);
+        freeQueuePolicy(resized);
+    }
+    return result;
+}
+
+// Sub-function to copy the history of a page into another LRU-K state
+void lrukCopyHistory(LRUKState *to, LRUKHistory *from, int k)
+{
+    LRUKHistory *history = lrukLookupOrInsert(to, from->pageID);
+    memcpy(history->times, from->times, sizeof(long long) * k);
+    history->last = from->last;
+    history->retainedAt = from->retainedAt;
+}
+
+// Sub-function to carry the LRU-K histories over to a resized state
+// Resident pages keep theirs, of the histories retained for evicted pages the newest that fit the new ring stay
+void lrukMoveHistories(LRUKState *from, LRUKState *to)
+{
+    to->clock = from->clock;
+    to->evictions = from->evictions;
+    for (int i = 0; i < from->tableSize; i++)
+    {
+        if (from->table[i].pageID != NO_PAGE && from->table[i].retainedAt == 0)
+        {
+            lrukCopyHistory(to, &from->table[i], from->k);
+        }
+    }
+
+    int skip = (from->retainedCount > to->retainedLimit) ? from->retainedCount - to->retainedLimit : 0;
+    for (int i = skip; i < from->retainedCount; i++)
+    {
+        int slot = (from->retainedHead + i) % from->retainedLimit;
+        LRUKHistory *history = lrukLookup(from, from->retainedPages[slot]);
+        if (history == NULL || history->retainedAt != from->retainedSeq[slot])
+        {
+            continue; // Stale entry, the page was referenced or retained again since
+        }
+        lrukCopyHistory(to, history, from->k);
+        to->retainedPages[to->retainedCount] = history->pageID;
+        to->retainedSeq[to->retainedCount] = history->retainedAt;
+        to->retainedCount++;
+    }
+}
+
+// Sub-function to carry the 2Q or ARC queues over to a resized policy, oldest entries first so their order is kept
+// Resident pages all fit, ghosts are cut from their oldest end to the new limits
+void queueMoveEntries(QueuePolicy *from, QueuePolicy *to)
+{
+    PageQueue *queues = from->queues;
+    int keep[QUEUE_COUNT];
+    keep[QUEUE_RECENT] = queues[QUEUE_RECENT].size;
+    keep[QUEUE_FREQUENT] = queues[QUEUE_FREQUENT].size;
+    if (to->strategy == RS_2Q)
+    {
+        keep[QUEUE_RECENT_GHOST] = (queues[QUEUE_RECENT_GHOST].size < to->ghostLimit) ? queues[QUEUE_RECENT_GHOST].size : to->ghostLimit;
+        keep[QUEUE_FREQUENT_GHOST] = 0;
+    }
+    else
+    {
+        // ARC keeps |T1| + |B1| within c and the whole directory within 2c
+        int room = to->frames - keep[QUEUE_RECENT];
+        room = (room > 0) ? room : 0;
+        keep[QUEUE_RECENT_GHOST] = (queues[QUEUE_RECENT_GHOST].size < room) ? queues[QUEUE_RECENT_GHOST].size : room;
+        room = 2 * to->frames - keep[QUEUE_RECENT] - keep[QUEUE_FREQUENT] - keep[QUEUE_RECENT_GHOST];
+        room = (room > 0) ? room : 0;
+        keep[QUEUE_FREQUENT_GHOST] = (queues[QUEUE_FREQUENT_GHOST].size < room) ? queues[QUEUE_FREQUENT_GHOST].size : room;
+    }
+
+    for (int q = 0; q < QUEUE_COUNT; q++)
+    {
+        int skip = queues[q].size - keep[q];
+        for (int node = queues[q].tail; node != -1; node = from->nodes[node].prev)
+        {
+            if (skip > 0)
+            {
+                skip--;
+                continue;
+            }
+            int copy = queueInsert(to, from->nodes[node].pageID, q);
+            to->nodes[copy].prefetched = from->nodes[node].prefetched;
+        }
+    }
+    to->target = (from->target < to->frames) ? from->target : to->frames;
+    to->lastPage = from->lastPage;
+}
+
+// Sub-function to take an evicted frame out of the ring, its page memory goes back to the kernel until it is reused
+void retireFrame(BufferManager *bufferManager, PageFrame *frame)
+{
+    if (frame->pageID != NO_PAGE)
+    {
+        pageTableRemove(bufferManager, frame->pageID);
+        notePageEvicted(bufferManager, frame->pageID);
+        bufferManager->evictions++;
+    }
+    if (bufferManager->lfu != NULL)
+    {
+        lfuDetach(bufferManager->lfu, frame);
+    }
+
+    if (frame == bufferManager->firstFrame)
+    {
+        bufferManager->firstFrame = frame->nextFrame;
+    }
+    if (frame == bufferManager->lastFrame)
+    {
+        bufferManager->lastFrame = frame->prevFrame;
+    }
+    if (frame == bufferManager->currentFramePtr)
+    {
+        bufferManager->currentFramePtr = frame->nextFrame; // The CLOCK hand moves on to a frame that stays
+    }
+    frame->prevFrame->nextFrame = frame->nextFrame;
+    frame->nextFrame->prevFrame = frame->prevFrame;
+
+    frame->pageID = NO_PAGE;
+    frame->referenceCount = 0;
+    frame->isModified = false;
+    frame->accessed = false;
+    frame->spare = true;
+    frame->prevFrame = NULL;
+    frame->nextFrame = bufferManager->spareFrames;
+    bufferManager->spareFrames = frame;
+
+    if (bufferManager->mappedIO)
+    {
+        frame->pageData = NULL; // The page belongs to the file mapping
+    }
+#ifdef MADV_DONTNEED
+    else
+    {
+        madvise(frame->pageData, bufferManager->pageSize, MADV_DONTNEED); // Reads as zeros once touched again
+    }
+#endif
+}
+
+// Sub-function to evict count unpinned frames in the order the strategy replaces pages and take them out of the pool
+// Dirty pages are written back together first, if a write fails no frame is taken out
+RC evictFrames(BM_BufferPool *const pool, int count, SM_FileHandle *fileHandle)
+{
+    BufferManager *bufferManager = pool->mgmtData;
+    PageFrame **victims = malloc(sizeof(PageFrame *) * count);
+    PageFrame **dirty = malloc(sizeof(PageFrame *) * count);
+    bool *written = malloc(sizeof(bool) * count);
+    if (victims == NULL || dirty == NULL || written == NULL)
+    {
+        free(victims);
+        free(dirty);
+        free(written);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    RC result = RC_OK;
+    int chosen = 0;
+    int numDirty = 0;
+    while (chosen < count)
+    {
+        PageFrame *victim = chooseReadAheadFrame(pool); // Held, so the next choice is another frame
+        if (victim == NULL)
+        {
+            victim = chooseReadAheadFrame(pool); // CLOCK clears reference bits on its first pass
+        }
+        if (victim == NULL)
+        {
+            result = RC_IM_NO_MORE_ENTRIES;
+            break;
+        }
+        victims[chosen++] = victim;
+        if (victim->isModified)
+        {
+            dirty[numDirty++] = victim;
+        }
+    }
+
+    if (result == RC_OK && numDirty > 0)
+    {
+        result = writeDirtyFrames(bufferManager, fileHandle, dirty, numDirty, written);
+        for (int i = 0; i < numDirty; i++)
+        {
+            if (written[i])
+            {
+                dirty[i]->isModified = false;
+                __atomic_add_fetch(&bufferManager->dirtyEvictions, 1, __ATOMIC_RELAXED); // Counted with the writes
+            }
+        }
+    }
+
+    for (int i = 0; i < chosen; i++)
+    {
+        if (result == RC_OK)
+        {
+            retireFrame(bufferManager, victims[i]);
+        }
+        else
+        {
+            victims[i]->referenceCount--; // The pool keeps its size and the pages
+        }
+    }
+
+    free(victims);
+    free(dirty);
+    free(written);
+    return result;
+}
+
+// Sub-function to take count empty frames for a growing pool, spare frames first and a new chunk for the rest
+// The frames come back linked from first to last, the pool is left as it was if the chunk cannot be allocated
+RC takeNewFrames(BufferManager *bufferManager, int count, PageFrame **first, PageFrame **last)
+{
+    int spares = 0;
+    for (PageFrame *frame = bufferManager->spareFrames; frame != NULL && spares < count; frame = frame->nextFrame)
+    {
+        spares++;
+    }
+
+    FrameChunk *chunk = NULL;
+    if (spares < count)
+    {
+        RC result = createFrameChunk(bufferManager, count - spares, &chunk);
+        if (result != RC_OK)
+        {
+            return result;
+        }
+        chunk->next = bufferManager->frameChunks;
+        bufferManager->frameChunks = chunk;
+    }
+
+    *first = NULL;
+    *last = NULL;
+    for (int i = 0; i < spares; i++)
+    {
+        PageFrame *frame = bufferManager->spareFrames;
+        bufferManager->spareFrames = frame->nextFrame;
+        frame->spare = false;
+        frame->nextFrame = NULL;
+        frame->prevFrame = *last;
+        if (*last != NULL)
+        {
+            (*last)->nextFrame = frame;
+        }
+        else
+        {
+            *first = frame;
+        }
+        *last = frame;
+    }
+    if (chunk != NULL)
+    {
+        chunk->frames[0].prevFrame = *last;
+        if (*last != NULL)
+        {
+            (*last)->nextFrame = &chunk->frames[0];
+        }
+        else
+        {
+            *first = &chunk->frames[0];
+        }
+        *last = &chunk->frames[chunk->count - 1];
+    }
+    return RC_OK;
+}
+
+// Sub-function to link a chain of empty frames in at the front of the ring, where FIFO, LRU and CLOCK take frames first
+void linkNewFrames(BufferManager *bufferManager, PageFrame *first, PageFrame *last)
+{
+    first->prevFrame = bufferManager->lastFrame;
+    last->nextFrame = bufferManager->firstFrame;
+    bufferManager->lastFrame->nextFrame = first;
+    bufferManager->firstFrame->prevFrame = last;
+    bufferManager->firstFrame = first;
+
+    // LFU keeps empty frames in the bucket of frequency 0
+    for (PageFrame *frame = first; bufferManager->lfu != NULL; frame = frame->nextFrame)
+    {
+        lfuReset(bufferManager->lfu, frame, 0);
+        if (frame == last)
+        {
+            break;
+        }
+    }
+}
+
+// Sub-function to relink the statistics of the pool's frames, surviving frames keep their order and added ones follow
+void relinkFrameStatistics(BufferManager *bufferManager, PageFrame *first, PageFrame *last)
+{
+    FrameStatistics *head = NULL;
+    FrameStatistics **tail = &head;
+    for (FrameStatistics *stat = bufferManager->statsHead; stat != NULL; stat = stat->nextStat)
+    {
+        if (!stat->currentFrame->spare)
+        {
+            *tail = stat;
+            tail = &stat->nextStat;
+        }
+    }
+    for (PageFrame *frame = first; frame != NULL; frame = (frame == last) ? NULL : frame->nextFrame)
+    {
+        FrameStatistics *stat = frameStatistics(bufferManager, frame);
+        *tail = stat;
+        tail = &stat->nextStat;
+    }
+    *tail = NULL;
+    bufferManager->statsHead = head;
+}
+
+// Sub-function to resize a single-threaded pool or one shard, whose latch the caller holds
+// Dirty victims are written through fileHandle
+RC resizeFrames(BM_BufferPool *const pool, int totalFrames, SM_FileHandle *fileHandle)
+{
+    BufferManager *bufferManager = pool->mgmtData;
+    int removed = bufferManager->totalPageFrames - totalFrames;
+    if (removed == 0)
+    {
+        return RC_OK;
+    }
+    if (removed > 0 && countUnpinnedFrames(bufferManager) < removed)
+    {
+        return RC_IM_NO_MORE_ENTRIES; // Pinned pages cannot leave
+    }
+
+    // Everything that can fail comes before the pool changes
+    BufferManager resized;
+    RC result = createResizedState(bufferManager, pool->strategy, totalFrames, &resized);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+    PageFrame *first = NULL;
+    PageFrame *last = NULL;
+    result = (removed > 0) ? evictFrames(pool, removed, fileHandle)
+                           : takeNewFrames(bufferManager, -removed, &first, &last);
+    if (result != RC_OK)
+    {
+        free(resized.pageTable);
+        freeLRUKState(&resized);
+        freeQueuePolicy(&resized);
+        return result;
+    }
+    if (first != NULL)
+    {
+        linkNewFrames(bufferManager, first, last);
+    }
+
+    // Resident pages move to the new page table, the policies carry over what they know about pages
+    PageFrame *currentFrame = bufferManager->firstFrame;
+    do
+    {
+        if (currentFrame->pageID != NO_PAGE)
+        {
+            pageTableInsert(&resized, currentFrame->pageID, currentFrame);
+        }
+        currentFrame = currentFrame->nextFrame;
+    } while (currentFrame != bufferManager->firstFrame);
+    free(bufferManager->pageTable);
+    bufferManager->pageTable = resized.pageTable;
+    bufferManager->pageTableSize = resized.pageTableSize;
+    bufferManager->pageTableBits = resized.pageTableBits;
+
+    if (bufferManager->lruK != NULL)
+    {
+        lrukMoveHistories(bufferManager->lruK, resized.lruK);
+        freeLRUKState(bufferManager);
+        bufferManager->lruK = resized.lruK;
+    }
+    if (bufferManager->queuePolicy != NULL)
+    {
+        queueMoveEntries(bufferManager->queuePolicy, resized.queuePolicy);
+        freeQueuePolicy(bufferManager);
+        resized.queuePolicy->freeCursor = bufferManager->firstFrame;
+        bufferManager->queuePolicy = resized.queuePolicy;
+    }
+
+    relinkFrameStatistics(bufferManager, first, last);
+    free(bufferManager->prefetching); // Sized for the old number of frames, allocated again by the next prefetch
+    bufferManager->prefetching = NULL;
+    bufferManager->totalPageFrames = totalFrames;
+    pool->numPages = totalFrames;
+    return RC_OK;
+}
+
+// Sub-function to resize a thread-safe pool, its frames are dealt out over the shards as when it was created
+// Every shard latch is held throughout, so pins wait until the whole pool has its new size
+RC resizeSharded(BM_BufferPool *const bufferPool, int totalFrames)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    int numShards = bufferManager->numShards;
+    if (totalFrames < numShards)
+    {
+        return RC_WRITE_FAILED; // Every shard needs a frame
+    }
+
+    for (int i = 0; i < numShards; i++)
+    {
+        pthread_mutex_lock(&bufferManager->shards[i].latch);
+    }
+
+    // Check every shard first, so a shrink that cannot be done leaves all of them alone
+    RC result = RC_OK;
+    for (int i = 0; i < numShards && result == RC_OK; i++)
+    {
+        BufferManager *shardManager = bufferManager->shards[i].pool.mgmtData;
+        int frames = totalFrames / numShards + ((i < totalFrames % numShards) ? 1 : 0);
+        if (frames < shardManager->totalPageFrames && countUnpinnedFrames(shardManager) < shardManager->totalPageFrames - frames)
+        {
+            result = RC_IM_NO_MORE_ENTRIES;
+        }
+    }
+
+    // After a failed write the shards done so far keep their new size, numPages tells the total
+    int total = 0;
+    for (int i = 0; i < numShards; i++)
+    {
+        BM_Shard *shard = &bufferManager->shards[i];
+        int frames = totalFrames / numShards + ((i < totalFrames % numShards) ? 1 : 0);
+        if (result == RC_OK)
+        {
+            result = resizeFrames(&shard->pool, frames, &bufferPool->fH);
+        }
+        total += shard->pool.numPages;
+        pthread_cond_broadcast(&shard->ioDone); // Pins that found every frame taken may find a new one
+    }
+    bufferManager->totalPageFrames = total;
+    bufferPool->numPages = total;
+
+    for (int i = numShards - 1; i >= 0; i--)
+    {
+        pthread_mutex_unlock(&bufferManager->shards[i].latch);
+    }
+    return result;
+}
+
+/*
+    // Helper functions for the process-wide pool that the files of tables and indexes share
+*/
+
+// Sub-function to take an unpinned clean page out of its frame, which then comes first for the next miss of the pool or shard
+void emptyFrame(BufferManager *bufferManager, PageFrame *frame, ReplacementStrategy strategy)
+{
+    pageTableRemove(bufferManager, frame->pageID);
+    notePageEvicted(bufferManager, frame->pageID);
+    bufferManager->evictions++;
+    frame->pageID = NO_PAGE;
+    frame->referenceCount = 0;
+    frame->accessed = false;
+    if (bufferManager->mappedIO)
+    {
+        frame->pageData = NULL; // The page belongs to the file mapping
+    }
+
+    // CLOCK takes its victims at the hand, so the frame moves in front of it and the hand points at the frame
+    // Frames emptied in a row are taken before the hand resumes its sweep, hot pages keep their reference bits
+    if (strategy == RS_CLOCK)
+    {
+        PageFrame *hand = (bufferManager->currentFramePtr != NULL) ? bufferManager->currentFramePtr : bufferManager->firstFrame;
+        if (frame != hand)
+        {
+            if (frame == bufferManager->firstFrame)
+            {
+                bufferManager->firstFrame = frame->nextFrame;
+            }
+            if (frame == bufferManager->lastFrame)
+            {
+                bufferManager->lastFrame = frame->prevFrame;
+            }
+            frame->prevFrame->nextFrame = frame->nextFrame;
+            frame->nextFrame->prevFrame = frame->prevFrame;
+
+            frame->nextFrame = hand;
+            frame->prevFrame = hand->prevFrame;
+            hand->prevFrame->nextFrame = frame;
+            hand->prevFrame = frame;
+            if (hand == bufferManager->firstFrame)
+            {
+                bufferManager->firstFrame = frame;
+            }
+        }
+        bufferManager->currentFramePtr = frame;
+        return;
+    }
+
+    // The frame moves to the front of the ring so the next miss takes it
+    if (frame != bufferManager->firstFrame)
+    {
+        if (frame == bufferManager->lastFrame)
+        {
+            bufferManager->lastFrame = frame->prevFrame;
+        }
+        frame->prevFrame->nextFrame = frame->nextFrame;
+        frame->nextFrame->prevFrame = frame->prevFrame;
+        linkNewFrames(bufferManager, frame, frame);
+    }
+    else if (bufferManager->lfu != NULL)
+    {
+        lfuReset(bufferManager->lfu, frame, 0); // Empty frames wait in the bucket of frequency 0
+    }
+    if (bufferManager->queuePolicy != NULL)
+    {
+        bufferManager->queuePolicy->freeCursor = frame; // 2Q and ARC look for empty frames from their cursor
+    }
+}
+
+// Sub-function to write back a frame's page if it is dirty and leave the frame empty, called under the shard latch
+RC dropSharedFrame(BufferManager *shardManager, PageFrame *frame)
+{
+    RC result = writeBackIfDirty(frame, &sharedPool.fH, shardManager);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+
+    emptyFrame(shardManager, frame, sharedPool.strategy);
+    return RC_OK;
+}
+
+// Sub-function to make a file give up one of its unpinned pages, starting with the shard of the page it wants
+// Within a shard its pages leave in the order the frames are linked, the oldest first for FIFO and LRU
+RC evictFilePage(BM_SharedFile *file, PageNumber key)
+{
+    BufferManager *sharedManager = sharedPool.mgmtData;
+    int first = (int)(shardOf(sharedManager, key) - sharedManager->shards);
+
+    for (int i = 0; i < sharedManager->numShards; i++)
+    {
+        BM_Shard *shard = &sharedManager->shards[(first + i) % sharedManager->numShards];
+        BufferManager *shardManager = shard->pool.mgmtData;
+        pthread_mutex_lock(&shard->latch);
+        PageFrame *currentFrame = shardManager->firstFrame;
+        do
+        {
+            if (holdsFilePage(shardManager, currentFrame, file) && currentFrame->referenceCount == 0 &&
+                !currentFrame->ioPending)
+            {
+                RC result = dropSharedFrame(shardManager, currentFrame);
+                pthread_mutex_unlock(&shard->latch);
+                return result;
+            }
+            currentFrame = currentFrame->nextFrame;
+        } while (currentFrame != shardManager->firstFrame);
+        pthread_mutex_unlock(&shard->latch);
+    }
+    return RC_IM_NO_MORE_ENTRIES; // Every page of the file is pinned
+}
+
+// Sub-function to pin a page of a registered file, a file at its quota first gives up one of its own pages
+// Misses of the same file on several threads at once may take it past its quota by one page each
+RC pinShared(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum)
+{
+    BM_SharedFile *file = sharedFileOf(bufferPool);
+    if (pageNum > SHARED_PAGE_MASK)
+    {
+        return RC_IM_KEY_NOT_FOUND; // The page number would run into the bits of the file's slot
+    }
+
+    PageNumber key = file->keyBase + pageNum;
+    int quota = __atomic_load_n(&file->quota, __ATOMIC_RELAXED);
+    if (quota > 0 && __atomic_load_n(&file->resident, __ATOMIC_RELAXED) >= quota &&
+        findPinnedFrame(&sharedPool, NULL, key) == NULL)
+    {
+        RC result = evictFilePage(file, key);
+        if (result != RC_OK)
+        {
+            return result;
+        }
+    }
+
+    RC result = pinPage(&sharedPool, pageHandle, key);
+    pageHandle->pageNum = pageNum;
+    return result;
+}
+
+// Sub-function to read ahead pages of a registered file, only as many as its quota has room for
+RC readAheadShared(BM_BufferPool *const bufferPool, const PageNumber *pageList, const int numPages)
+{
+    BM_SharedFile *file = sharedFileOf(bufferPool);
+    int limit = numPages;
+    int quota = __atomic_load_n(&file->quota, __ATOMIC_RELAXED);
+    if (quota > 0)
+    {
+        int room = quota - __atomic_load_n(&file->resident, __ATOMIC_RELAXED);
+        limit = (room < limit) ? room : limit;
+    }
+    if (limit <= 0)
+    {
+        return RC_OK;
+    }
+
+    PageNumber *keys = malloc(sizeof(PageNumber) * limit);
+    if (keys == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    int count = 0;
+    for (int i = 0; i < numPages && count < limit; i++)
+    {
+        if (pageList[i] >= 0 && pageList[i] <= SHARED_PAGE_MASK)
+        {
+            keys[count++] = file->keyBase + pageList[i];
+        }
+    }
+    RC result = readAheadSharded(&sharedPool, keys, count);
+    free(keys);
+    return result;
+}
+
+// Sub-function to write back the dirty pages of a registered file shard by shard, then the file's header
+RC flushSharedFile(BM_BufferPool *const bufferPool)
+{
+    BM_SharedFile *file = sharedFileOf(bufferPool);
+    BufferManager *sharedManager = sharedPool.mgmtData;
+    RC result = RC_OK;
+
+    for (int i = 0; i < sharedManager->numShards; i++)
+    {
+        RC shardResult = flushShard(&sharedPool, &sharedManager->shards[i], file);
+        if (shardResult != RC_OK && result == RC_OK)
+        {
+            result = shardResult; // Keep flushing, report the first failure
+        }
+    }
+
+    if (result == RC_OK)
+    {
+        result = flushPageFileHeader(&bufferPool->fH); // The file's page count is persisted with its pages
+    }
+    return result;
+}
+
+// Sub-function to empty the frames holding a file's pages before it leaves the pool, in-flight transfers finish first
+RC dropSharedFile(BM_SharedFile *file)
+{
+    BufferManager *sharedManager = sharedPool.mgmtData;
+    RC result = RC_OK;
+
+    for (int i = 0; i < sharedManager->numShards; i++)
+    {
+        BM_Shard *shard = &sharedManager->shards[i];
+        BufferManager *shardManager = shard->pool.mgmtData;
+        PageFrame **frames = malloc(sizeof(PageFrame *) * shardManager->totalPageFrames);
+        if (frames == NULL)
+        {
+            return RC_MEMORY_ALLOCATION_ERROR;
+        }
+
+        // Emptied frames move to the front of the ring, so the file's frames are collected before any of them moves
+        pthread_mutex_lock(&shard->latch);
+        int count = 0;
+        PageFrame *currentFrame = shardManager->firstFrame;
+        do
+        {
+            if (holdsFilePage(shardManager, currentFrame, file))
+            {
+                frames[count++] = currentFrame;
+            }
+            currentFrame = currentFrame->nextFrame;
+        } while (currentFrame != shardManager->firstFrame);
+
+        for (int j = 0; j < count; j++)
+        {
+            while (holdsFilePage(shardManager, frames[j], file) && frames[j]->ioPending)
+            {
+                pthread_cond_wait(&shard->ioDone, &shard->latch); // The background writer holds it
+            }
+            if (holdsFilePage(shardManager, frames[j], file))
+            {
+                RC frameResult = dropSharedFrame(shardManager, frames[j]);
+                result = (result == RC_OK) ? frameResult : result;
+            }
+        }
+        pthread_mutex_unlock(&shard->latch);
+        free(frames);
+    }
+    return result;
+}
+
+// Sub-function to open a file and register it with the running process-wide pool, whose frames then hold its pages
+RC registerSharedFile(BM_BufferPool *const bufferPool, const char *const fileName, const BM_PoolOptions *options)
+{
+    if (options->quota < 0)
+    {
+        return RC_WRITE_FAILED;
+    }
+    BufferManager *bufferManager = calloc(1, sizeof(BufferManager));
+    if (bufferManager == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    RC result = options->directIO ? openPageFileDirect((char *)fileName, &bufferPool->fH)
+                                  : openPageFile((char *)fileName, &bufferPool->fH);
+    if (result != RC_OK)
+    {
+        free(bufferManager);
+        return result;
+    }
+
+    // Take the first free slot, its number becomes the high bits of the file's keys
+    pthread_mutex_lock(&sharedRegistryLatch);
+    BufferManager *sharedManager = sharedPool.mgmtData;
+    BM_SharedFile *file = NULL;
+    if (sharedManager == NULL)
+    {
+        result = RC_FILE_NOT_FOUND; // The pool was shut down meanwhile
+    }
+    else if (bufferPool->fH.pageSize != sharedManager->pageSize)
+    {
+        result = RC_INVALID_PAGE_SIZE; // Every frame of the pool holds a page of its size
+    }
+    else
+    {
+        for (int i = 0; i < BM_SHARED_MAX_FILES && file == NULL; i++)
+        {
+            if (!sharedManager->sharedFiles[i].inUse)
+            {
+                file = &sharedManager->sharedFiles[i];
+                memset(file, 0, sizeof(BM_SharedFile));
+                file->fileHandle = &bufferPool->fH;
+                file->keyBase = (PageNumber)i << SHARED_PAGE_BITS;
+                file->quota = options->quota;
+                file->inUse = true;
+            }
+        }
+        result = (file != NULL) ? RC_OK : RC_IM_NO_MORE_ENTRIES;
+    }
+    pthread_mutex_unlock(&sharedRegistryLatch);
+    if (result != RC_OK)
+    {
+        closePageFile(&bufferPool->fH);
+        free(bufferManager);
+        return result;
+    }
+
+    // The pool reports on all frames of the process-wide pool, frames of other files show up empty
+    initializeBufferManager(bufferManager, sharedPool.numPages, NULL);
+    bufferManager->pageSize = sharedManager->pageSize;
+    bufferManager->sharedFile = file;
+    bufferPool->numPages = sharedPool.numPages;
+    bufferPool->pageFile = (char *)fileName;
+    bufferPool->strategy = sharedPool.strategy;
+    bufferPool->mgmtData = bufferManager;
+    return RC_OK;
+}
+
+// Sub-function to take a file out of the process-wide pool, its pages are written back and their frames emptied
+RC unregisterSharedFile(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    BM_SharedFile *file = bufferManager->sharedFile;
+    RC result = flushSharedFile(bufferPool);
+    if (result == RC_OK)
+    {
+        result = dropSharedFile(file);
+    }
+    if (result != RC_OK)
+    {
+        return result; // The file stays registered, like a pool whose flush failed stays open
+    }
+
+    result = closePageFile(&bufferPool->fH);
+    pthread_mutex_lock(&sharedRegistryLatch);
+    file->inUse = false;
+    pthread_mutex_unlock(&sharedRegistryLatch);
+    free(bufferManager);
+    bufferPool->numPages = 0;
+    bufferPool->pageFile = NULL;
+    bufferPool->mgmtData = NULL;
+    return result;
+}
+
+// Sub-function to change the quota of a registered file, its pages beyond the new quota are evicted right away
+// If too many of them are pinned the quota stays as it was, the pages evicted so far stay out
+RC setFileQuota(BM_BufferPool *const bufferPool, const int quota)
+{
+    BM_SharedFile *file = sharedFileOf(bufferPool);
+    while (__atomic_load_n(&file->resident, __ATOMIC_RELAXED) > quota)
+    {
+        RC result = evictFilePage(file, file->keyBase);
+        if (result != RC_OK)
+        {
+            return result;
+        }
+    }
+    __atomic_store_n(&file->quota, quota, __ATOMIC_RELAXED);
+    return RC_OK;
+}
+
+// Sub-function to fill the statistics arrays of a registered file, frames holding pages of other files show up empty
+void gatherFileFrames(BM_BufferPool *const bufferPool, PageNumber *frameNumbers, bool *dirtyFlags, int *fixCounts)
+{
+    BM_SharedFile *file = sharedFileOf(bufferPool);
+    BufferManager *sharedManager = sharedPool.mgmtData;
+    int numFrames = bufferPool->numPages;
+    PageNumber *keys = malloc(sizeof(PageNumber) * numFrames);
+    bool *dirty = malloc(sizeof(bool) * numFrames);
+    int *fixed = malloc(sizeof(int) * numFrames);
+    if (keys != NULL && dirty != NULL && fixed != NULL)
+    {
+        gatherShardFrames(sharedManager, keys, dirty, fixed);
+    }
+
+    for (int i = 0; i < numFrames; i++)
+    {
+        bool own = keys != NULL && dirty != NULL && fixed != NULL && keys[i] != NO_PAGE &&
+                   fileOfKey(sharedManager, keys[i]) == file;
+        if (frameNumbers != NULL)
+        {
+            frameNumbers[i] = own ? keys[i] - file->keyBase : NO_PAGE;
+        }
+        if (dirtyFlags != NULL)
+        {
+            dirtyFlags[i] = own && dirty[i];
+        }
+        if (fixCounts != NULL)
+        {
+            fixCounts[i] = own ? fixed[i] : 0;
+        }
+    }
+    free(keys);
+    free(dirty);
+    free(fixed);
+}
+
+// Sub-function to tell whether the process-wide pool is running, files asking for it get private frames otherwise
+bool sharedPoolRunning()
+{
+    pthread_mutex_lock(&sharedRegistryLatch);
+    bool running = (sharedPool.mgmtData != NULL);
+    pthread_mutex_unlock(&sharedRegistryLatch);
+    return running;
+}
+
+/*
+    // Helper functions for warm restarts
+*/
+
+// Saved page lists start with the magic, then hold page numbers hottest first in the byte order of the machine
+#define WARM_MAGIC "BMWARM01"
+#define WARM_SUFFIX ".warm"
+#define WARM_BATCH 64 // Pages the warm loader reads between two looks at whether the pool is shutting down
+
+// Rank of a page of an LRU-K pool, pages with later references are hotter
+typedef struct WarmRank
+{
+    long long kth;
+    long long last;
+    PageNumber pageID;
+} WarmRank;
+
+// Sub-function to name the page list kept next to a page file, the caller frees the name
+char *warmFileName(const char *pageFileName)
+{
+    char *name = malloc(strlen(pageFileName) + sizeof(WARM_SUFFIX));
+    if (name != NULL)
+    {
+        strcpy(name, pageFileName);
+        strcat(name, WARM_SUFFIX);
+    }
+    return name;
+}
+
+// Helper function to sort page numbers in increasing order
+int comparePageNumbers(const void *left, const void *right)
+{
+    PageNumber leftPage = *(const PageNumber *)left;
+    PageNumber rightPage = *(const PageNumber *)right;
+    return (leftPage > rightPage) - (leftPage < rightPage);
+}
+
+// Helper function to sort LRU-K ranks hottest first, the same order lrukEvictsBefore evicts in reversed
+int compareWarmRanks(const void *left, const void *right)
+{
+    const WarmRank *leftRank = left;
+    const WarmRank *rightRank = right;
+    if (leftRank->kth != rightRank->kth)
+    {
+        return (leftRank->kth < rightRank->kth) ? 1 : -1;
+    }
+    return (leftRank->last < rightRank->last) - (leftRank->last > rightRank->last);
+}
+
+// Sub-function to list the pages of a single-threaded pool or shard hottest first, pinned pages before the others
+// LRU-K pages are sorted by their histories, ranking them the way the background writer does would be quadratic
+int collectWarmPages(BufferManager *bufferManager, ReplacementStrategy strategy, PageFrame **frames, PageNumber *pages)
+{
+    int count = 0;
+    PageFrame *start = bufferManager->firstFrame;
+    PageFrame *frame = start;
+    do
+    {
+        if (frame->pageID != NO_PAGE && !isCleaningCandidate(frame))
+        {
+            pages[count++] = frame->pageID;
+        }
+        frame = frame->nextFrame;
+    } while (frame != start);
+
+    if (strategy == RS_LRU_K)
+    {
+        WarmRank *ranks = malloc(sizeof(WarmRank) * bufferManager->totalPageFrames);
+        int numRanks = 0;
+        if (ranks == NULL)
+        {
+            return count;
+        }
+        do
+        {
+            if (frame->pageID != NO_PAGE && isCleaningCandidate(frame))
+            {
+                LRUKHistory *history = lrukLookup(bufferManager->lruK, frame->pageID);
+                ranks[numRanks].kth = (history != NULL) ? history->times[bufferManager->lruK->k - 1] : 0;
+                ranks[numRanks].last = (history != NULL) ? history->last : 0;
+                ranks[numRanks++].pageID = frame->pageID;
+            }
+            frame = frame->nextFrame;
+        } while (frame != start);
+        qsort(ranks, numRanks, sizeof(WarmRank), compareWarmRanks);
+        for (int i = 0; i < numRanks; i++)
+        {
+            pages[count++] = ranks[i].pageID;
+        }
+        free(ranks);
+        return count;
+    }
+
+    // The other strategies list their next victims first, so the hottest pages come last
+    int candidates = collectCleaningCandidates(bufferManager, strategy, frames, bufferManager->totalPageFrames);
+    for (int i = candidates - 1; i >= 0; i--)
+    {
+        if (frames[i]->pageID != NO_PAGE)
+        {
+            pages[count++] = frames[i]->pageID;
+        }
+    }
+    return count;
+}
+
+// Sub-function to save the pages of a pool that is shutting down, thread-safe pools take turns between their shards
+// starting from the hottest page of each; the list is only a hint, so a pool that cannot write it still shuts down
+void saveWarmPages(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    int numLists = (bufferManager->shards != NULL) ? bufferManager->numShards : 1;
+    PageNumber **lists = calloc(numLists, sizeof(PageNumber *));
+    int *counts = calloc(numLists, sizeof(int));
+    int total = 0;
+    bool collected = (lists != NULL && counts != NULL);
+
+    // No other thread uses a pool that is shutting down, so the shards are read without their latches
+    for (int i = 0; collected && i < numLists; i++)
+    {
+        BM_BufferPool *pool = (bufferManager->shards != NULL) ? &bufferManager->shards[i].pool : bufferPool;
+        BufferManager *manager = pool->mgmtData;
+        PageFrame **frames = malloc(sizeof(PageFrame *) * manager->totalPageFrames);
+        lists[i] = malloc(sizeof(PageNumber) * manager->totalPageFrames);
+        collected = (frames != NULL && lists[i] != NULL);
+        if (collected)
+        {
+            counts[i] = collectWarmPages(manager, pool->strategy, frames, lists[i]);
+            total += counts[i];
+        }
+        free(frames);
+    }
+
+    FILE *file = collected ? fopen(bufferManager->warmFile, "wb") : NULL;
+    if (file != NULL)
+    {
+        fwrite(WARM_MAGIC, 1, 8, file);
+        for (int rank = 0, written = 0; written < total; rank++)
+        {
+            for (int i = 0; i < numLists; i++)
+            {
+                if (rank < counts[i])
+                {
+                    fwrite(&lists[i][rank], sizeof(PageNumber), 1, file);
+                    written++;
+                }
+            }
+        }
+        fclose(file);
+    }
+
+    for (int i = 0; lists != NULL && i < numLists; i++)
+    {
+        free(lists[i]);
+    }
+    free(lists);
+    free(counts);
+}
+
+// Sub-function to read back the saved list of a pool just opened, the hottest pages that fit in page number order
+// Pages the file no longer has are left out, the list may be older than the file
+int loadWarmPages(BM_BufferPool *const bufferPool, PageNumber **pages)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    FILE *file = fopen(bufferManager->warmFile, "rb");
+    char magic[8];
+    if (file == NULL)
+    {
+        return 0;
+    }
+    *pages = malloc(sizeof(PageNumber) * bufferPool->numPages);
+    if (*pages == NULL || fread(magic, 1, 8, file) != 8 || memcmp(magic, WARM_MAGIC, 8) != 0)
+    {
+        free(*pages);
+        fclose(file);
+        return 0;
+    }
+    int saved = (int)fread(*pages, sizeof(PageNumber), bufferPool->numPages, file);
+    fclose(file);
+
+    int count = 0;
+    for (int i = 0; i < saved; i++)
+    {
+        if ((*pages)[i] >= 0 && (*pages)[i] < bufferPool->fH.totalNumPages)
+        {
+            (*pages)[count++] = (*pages)[i];
+        }
+    }
+    qsort(*pages, count, sizeof(PageNumber), comparePageNumbers);
+    if (count == 0)
+    {
+        free(*pages);
+    }
+    return count;
+}
+
+// Reading the saved pages of a thread-safe pool in batches, every shard loads its own pages of a batch
+void *runWarmLoader(void *arg)
+{
+    BM_BufferPool *bufferPool = arg;
+    BufferManager *bufferManager = bufferPool->mgmtData;
+
+    for (int first = 0; first < bufferManager->numWarmPages; first += WARM_BATCH)
+    {
+        if (__atomic_load_n(&bufferManager->stopWarmLoad, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+        int count = bufferManager->numWarmPages - first;
+        readAheadSharded(bufferPool, &bufferManager->warmPages[first], (count < WARM_BATCH) ? count : WARM_BATCH);
+    }
+    return NULL;
+}
+
+// Sub-function to start the warm restart BM_PoolOptions asks for on a pool just opened
+// Single-threaded pools leave the reads of the saved pages in flight, thread-safe ones hand them to a loader thread
+void startWarmRestart(BM_BufferPool *const bufferPool, const char *const fileName)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    bufferManager->warmFile = warmFileName(fileName);
+    if (bufferManager->warmFile == NULL || bufferManager->mappedIO)
+    {
+        return; // Mapped pools find their pages in the page cache
+    }
+
+    PageNumber *pages;
+    int count = loadWarmPages(bufferPool, &pages);
+    if (count == 0)
+    {
+        return;
+    }
+    if (bufferManager->shards == NULL)
+    {
+        prefetchList(bufferPool, pages, count); // Only a hint, a pin of a page whose read failed reads it again
+        free(pages);
+        return;
+    }
+
+    bufferManager->warmPages = pages;
+    bufferManager->numWarmPages = count;
+    bufferManager->stopWarmLoad = false;
+    if (pthread_create(&bufferManager->warmLoader, NULL, runWarmLoader, bufferPool) == 0)
+    {
+        bufferManager->warmLoading = true;
+        return;
+    }
+    free(pages);
+    bufferManager->warmPages = NULL;
+    bufferManager->numWarmPages = 0;
+}
+
+// Sub-function to stop the warm loader after its current batch, a no-op for pools without one
+void stopWarmLoader(BufferManager *bufferManager)
+{
+    if (!bufferManager->warmLoading)
+    {
+        return;
+    }
+    __atomic_store_n(&bufferManager->stopWarmLoad, true, __ATOMIC_RELAXED);
+    pthread_join(bufferManager->warmLoader, NULL);
+    bufferManager->warmLoading = false;
+    free(bufferManager->warmPages);
+    bufferManager->warmPages = NULL;
+    bufferManager->numWarmPages = 0;
+}
+
+/*
+    // Helper functions for the frame rings of sequential scans
+*/
+
+// Sub-function to tell whether a page is resident, under the latch of its shard in thread-safe pools
+bool poolHoldsPage(BM_BufferPool *const bufferPool, PageNumber pageNum)
+{
+    BufferManager *bufferManager = targetPool(bufferPool, &pageNum)->mgmtData;
+    if (bufferManager->shards == NULL)
+    {
+        return pageTableLookup(bufferManager, pageNum) != NULL;
+    }
+    BM_Shard *shard = shardOf(bufferManager, pageNum);
+    pthread_mutex_lock(&shard->latch);
+    bool held = pageTableLookup(shard->pool.mgmtData, pageNum) != NULL;
+    pthread_mutex_unlock(&shard->latch);
+    return held;
+}
+
+// Sub-function to drop a page a scan is through with, pages pinned, dirty or in transfer meanwhile are left alone
+void dropScanPage(BM_BufferPool *const bufferPool, PageNumber pageNum)
+{
+    BM_BufferPool *pool = targetPool(bufferPool, &pageNum);
+    BufferManager *bufferManager = pool->mgmtData;
+    BM_Shard *shard = (bufferManager->shards != NULL) ? shardOf(bufferManager, pageNum) : NULL;
+    if (shard != NULL)
+    {
+        pthread_mutex_lock(&shard->latch);
+        bufferManager = shard->pool.mgmtData;
+    }
+    PageFrame *frame = pageTableLookup(bufferManager, pageNum);
+    if (frame != NULL && frame->referenceCount == 0 && !frame->isModified && !frame->ioPending)
+    {
+        emptyFrame(bufferManager, frame, pool->strategy);
+    }
+    if (shard != NULL)
+    {
+        pthread_mutex_unlock(&shard->latch);
+    }
+}
+
+// Sub-function to tell whether the ring's prefetch brought a page in, pages the scan went past are forgotten on the way
+bool takePrefetchedPage(BM_ScanRing *ring, PageNumber pageNum)
+{
+    bool found = false;
+    int kept = 0;
+    for (int i = 0; i < ring->numPrefetched; i++)
+    {
+        if (ring->prefetched[i] == pageNum)
+        {
+            found = true;
+        }
+        else if (ring->prefetched[i] > pageNum)
+        {
+            ring->prefetched[kept++] = ring->prefetched[i];
+        }
     }
+    ring->numPrefetched = kept;
+    return found;
 }
 
-// Helper function to allocate and initialize a PageFrame
-PageFrame *initializePageFrame()
+// Sub-function to add the page the scan leaves to the ring if it brought the page in, dropping the oldest one beyond the ring
+void leaveRingPage(BM_ScanRing *ring)
 {
-    PageFrame *frame = malloc(sizeof(PageFrame));
-    switch ((frame != NULL) ? 1 : 0)
+    if (ring->current == NO_PAGE || !ring->currentLoaded)
     {
-    case 1:
-        break;
-    case 0:
-        return NULL; // Memory allocation failed
-    default:
-        return NULL;
+        return;
     }
-    frame->pageID = NO_PAGE;
-    frame->referenceCount = 0;
-    frame->isModified = false;
-    memset(frame->pageData, '\0', PAGE_SIZE);
-    return frame;
+    if (ring->count == ring->numFrames)
+    {
+        dropScanPage(ring->pool, ring->loaded[ring->head]);
+        ring->head = (ring->head + 1) % ring->numFrames;
+        ring->count--;
+    }
+    ring->loaded[(ring->head + ring->count) % ring->numFrames] = ring->current;
+    ring->count++;
 }
 
-// Helper function to allocate and initialize FrameStatistics
-FrameStatistics *initializeFrameStatistics(PageFrame *frame)
+/*
+    // Helper functions for the counters of getBufferPoolStats
+*/
+
+// Sub-function to write back the dirty pages of an open pool and persist its file's page count
+RC flushPool(BM_BufferPool *const bufferPool)
 {
-    FrameStatistics *stat = malloc(sizeof(FrameStatistics));
-    switch ((stat != NULL) ? 1 : 0)
+    if (sharedFileOf(bufferPool) != NULL)
     {
-    case 1:
-        // Successfully allocated memory for stat
-        break;
-    case 0:
-        return NULL; // Memory allocation failed
-    default:
-        return NULL;
+        return flushSharedFile(bufferPool); // Only the file's own pages, other files flush theirs
+    }
+
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    RC result = (bufferManager->shards != NULL) ? flushShards(bufferPool)
+                                                : flushDirtyPagesToDisk(bufferManager, &bufferPool->fH);
+    if (result != RC_OK)
+    {
+        return result;
     }
-    stat->nextStat = NULL;
-    stat->currentFrame = frame;
-    return stat;
+    return flushPageFileHeader(&bufferPool->fH); // The file's page count is persisted with its pages
 }
 
-RC createFirstPageFrame(BufferManager *bufferManager, PageFrame **headFrame, FrameStatistics **headStat)
+// Sub-function to add a forceFlushPool call that began at start to the histogram of the pool holding the pages
+void noteFlush(BM_BufferPool *const bufferPool, long long start)
 {
-    // Allocate memory for the first page frame
-    *headFrame = initializePageFrame();
-    if (*headFrame == NULL)
+    PageNumber key = 0;
+    BufferManager *bufferManager = targetPool(bufferPool, &key)->mgmtData;
+    if (bufferManager->shards != NULL)
     {
-        free(bufferManager);    // Free buffer manager if allocation fails
-        return RC_WRITE_FAILED; // Return error if page frame creation fails
+        pthread_mutex_lock(&bufferManager->fileLatch);
     }
-
-    // Allocate memory for the first frame statistics
-    *headStat = initializeFrameStatistics(*headFrame);
-    if (*headStat == NULL)
+    recordLatency(&bufferManager->flushLatency, currentTimeNanos() - start);
+    if (bufferManager->shards != NULL)
     {
-        free(*headFrame); // Free the allocated page frame if statistics creation fails
-        free(bufferManager);
-        return RC_WRITE_FAILED;
+        pthread_mutex_unlock(&bufferManager->fileLatch);
     }
+}
 
-    // Assign headFrame and headStat to the bufferManager
-    bufferManager->firstFrame = *headFrame;
-    bufferManager->statsHead = *headStat;
+// Sub-function to turn pin timing on for a pool and all of its shards
+void setPinTiming(BufferManager *bufferManager, bool pinTiming)
+{
+    bufferManager->pinTiming = pinTiming;
+    for (int i = 0; i < bufferManager->numShards; i++)
+    {
+        ((BufferManager *)bufferManager->shards[i].pool.mgmtData)->pinTiming = pinTiming;
+    }
+}
 
-    return RC_OK;
+// Sub-function to add the buckets of one histogram to another
+void mergeLatency(BM_LatencyHistogram *into, const BM_LatencyHistogram *from)
+{
+    for (int i = 0; i < BM_LATENCY_BUCKETS; i++)
+    {
+        into->buckets[i] += from->buckets[i];
+    }
+    into->count += from->count;
+    into->totalNanos += from->totalNanos;
+    if (from->maxNanos > into->maxNanos)
+    {
+        into->maxNanos = from->maxNanos;
+    }
 }
 
-RC createAdditionalFrames(BufferManager *bufferManager, PageFrame **headFrame, FrameStatistics **headStat, int totalFrames)
+// Sub-function to add the pin and eviction counters of a pool or one shard, under the latch that guards them
+void addPinCounters(BM_PoolStats *stats, BufferManager *bufferManager, long long *evictions)
 {
+    stats->hits += bufferManager->pinHits;
+    stats->misses += bufferManager->pinMisses;
+    *evictions += bufferManager->evictions;
+    mergeLatency(&stats->pinHit, &bufferManager->pinHitLatency);
+    mergeLatency(&stats->pinMiss, &bufferManager->pinMissLatency);
+}
 
-    // Loop to create the additional frames and statistics
-    PageFrame *newFrame;
-    for (int i = 1; i < totalFrames; i++)
+// Sub-function to gather the counters of a pool, thread-safe pools take each shard's latch in turn
+void gatherPoolStats(BufferManager *bufferManager, BM_PoolStats *stats)
+{
+    long long evictions = 0;
+    if (bufferManager->shards == NULL)
+    {
+        addPinCounters(stats, bufferManager, &evictions);
+        stats->dirtyEvictions = bufferManager->dirtyEvictions;
+        stats->flush = bufferManager->flushLatency;
+    }
+    else
     {
-        newFrame = malloc(sizeof(PageFrame));
-        switch ((newFrame == NULL) ? 1 : 0)
+        for (int i = 0; i < bufferManager->numShards; i++)
         {
-        case 1:
-            freePageFrames(bufferManager->firstFrame); // Free existing frames on failure
-            free(*headStat);                           // Free the statistics head
-            free(bufferManager);                       // Free the buffer manager
-            return RC_WRITE_FAILED;
-            break;
-        case 0:
-            break;
-
-        default:
-            break;
+            BM_Shard *shard = &bufferManager->shards[i];
+            pthread_mutex_lock(&shard->latch);
+            addPinCounters(stats, shard->pool.mgmtData, &evictions);
+            pthread_mutex_unlock(&shard->latch);
         }
 
-        // Initialize the new page frame
-        newFrame->pageID = NO_PAGE;
-        newFrame->isModified = false;
-        newFrame->referenceCount = 0;
-        memset(newFrame->pageData, '\0', PAGE_SIZE);
-
-        // Allocate memory for a new frame statistics
-        FrameStatistics *newStat;
-        do
+        // Dirty evictions are counted atomically with the writes, the file latch guards the flush histogram
+        pthread_mutex_lock(&bufferManager->fileLatch);
+        for (int i = 0; i < bufferManager->numShards; i++)
         {
-            newStat = malloc(sizeof(FrameStatistics));
-            if (newStat != NULL)
-            {
-                break;
-            }
-            break;
-        } while (true);
+            BufferManager *shardManager = bufferManager->shards[i].pool.mgmtData;
+            stats->dirtyEvictions += __atomic_load_n(&shardManager->dirtyEvictions, __ATOMIC_RELAXED);
+        }
+        stats->flush = bufferManager->flushLatency;
+        pthread_mutex_unlock(&bufferManager->fileLatch);
+    }
 
-        switch (1)
-        {
-        case 1:
-            if (newStat == NULL)
-            {
-                switch (1)
-                {
-                case 1:
-                    free(newFrame);
-                    break;
-                default:
-                    break;
-                }
+    // A victim written back and then passed over for another frame is not evicted, so the clean ones can run short
+    stats->cleanEvictions = (evictions > stats->dirtyEvictions) ? evictions - stats->dirtyEvictions : 0;
+    stats->pinWaits = __atomic_load_n(&bufferManager->pinWaits, __ATOMIC_RELAXED);
+    stats->pinWaitNanos = __atomic_load_n(&bufferManager->pinWaitNanos, __ATOMIC_RELAXED);
+}
 
-                freePageFrames(bufferManager->firstFrame);
-                free(*headStat);
-                free(bufferManager);
-                return RC_WRITE_FAILED;
-            }
-            break;
-        default:
-            break;
-        }
+/*
+    // Helper functions for page-access traces
+*/
 
-        // Link the new statistics to the current frame
-        newStat->currentFrame = newFrame;
+// Sub-function to write the buffered records of a trace, under its latch
+void writeTraceRecords(BM_Trace *trace)
+{
+    if (trace->numRecords > 0 &&
+        fwrite(trace->records, sizeof(unsigned long long), trace->numRecords, trace->file) != (size_t)trace->numRecords)
+    {
+        trace->failed = true;
+    }
+    trace->numRecords = 0;
+}
 
-        // Link the current frame and statistics with the new ones
-        (*headStat)->nextStat = newStat;
-        *headStat = newStat; // Move to the new statistics
+// Adding a call to the pool's trace if it succeeded and one is taken, passing its result on
+RC traceCall(BM_BufferPool *const bufferPool, BM_TraceOp op, PageNumber pageNum, RC result)
+{
+    BM_Trace *trace = ((BufferManager *)bufferPool->mgmtData)->trace;
+    if (trace == NULL || result != RC_OK)
+    {
+        return result;
+    }
 
-        (*headFrame)->nextFrame = newFrame;
-        newFrame->prevFrame = *headFrame;
-        *headFrame = newFrame; // Move to the new frame
+    pthread_mutex_lock(&trace->latch);
+    trace->records[trace->numRecords++] = BM_TRACE_RECORD(op, pageNum);
+    if (trace->numRecords == BM_TRACE_BUFFERED)
+    {
+        writeTraceRecords(trace);
     }
+    pthread_mutex_unlock(&trace->latch);
+    return result;
+}
 
-    return RC_OK; // Return success
+// Sub-function to start the trace BM_PoolOptions asks for on a pool just opened, which is shut down again if it fails
+RC startOptionalTrace(BM_BufferPool *const bufferPool, const BM_PoolOptions *options)
+{
+    if (options == NULL || options->traceFile == NULL)
+    {
+        return RC_OK;
+    }
+    RC result = startPoolTrace(bufferPool, options->traceFile);
+    if (result != RC_OK)
+    {
+        shutdownBufferPool(bufferPool);
+    }
+    return result;
 }
 
 /*
@@ -1071,133 +5426,304 @@ RC forceFlushPool(BM_BufferPool *const bufferPool)
         return RC_FILE_NOT_FOUND; // Return error if not open
     }
 
-    SM_FileHandle fileHandle;
+    long long start = currentTimeNanos();
+    RC result = flushPool(bufferPool);
+    noteFlush(bufferPool, start);
+    return result;
+}
+
+RC readAheadPages(BM_BufferPool *const bufferPool, const PageNumber firstPage, const int numPages)
+{
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
+    {
+        return RC_FILE_NOT_FOUND; // Return error if not open
+    }
+
+    // Mapped pools never copy pages, there is nothing to read ahead
     BufferManager *bufferManager = bufferPool->mgmtData;
-    RC result = openPageFile(bufferPool->pageFile, &fileHandle);
+    if (bufferManager->mappedIO || numPages <= 0)
+    {
+        return RC_OK;
+    }
 
-    switch (result)
+    PageNumber *pageList = malloc(sizeof(PageNumber) * numPages);
+    if (pageList == NULL)
     {
-    case RC_OK:
-        result = flushDirtyPagesToDisk(bufferManager, &fileHandle);
-        closePageFile(&fileHandle); // Ensure file is closed
-        return result;
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    for (int i = 0; i < numPages; i++)
+    {
+        pageList[i] = firstPage + i;
+    }
 
-    default:
-        return result; // Return error from openPageFile
+    // Thread-safe pools load each shard's share of the pages under its latch, files of the process-wide pool too
+    RC result;
+    if (bufferManager->sharedFile != NULL)
+    {
+        result = readAheadShared(bufferPool, pageList, numPages);
+    }
+    else
+    {
+        result = (bufferManager->shards != NULL) ? readAheadSharded(bufferPool, pageList, numPages)
+                                                 : readAheadList(bufferPool, &bufferPool->fH, pageList, numPages);
     }
+    free(pageList);
+    return result;
 }
 
-RC initBufferPool(BM_BufferPool *const bufferPool, const char *const fileName,
-                  const int totalFrames, ReplacementStrategy strategy,
-                  void *strategyData)
+RC prefetchPageList(BM_BufferPool *const bufferPool, const PageNumber *pageList, const int numPages)
 {
-    // Check if the page file exists
-    FILE *file = fopen(fileName, "r");
-    if (file == NULL)
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
     {
-        return RC_FILE_NOT_FOUND; // Return error if the file does not exist
+        return RC_FILE_NOT_FOUND; // Return error if not open
     }
-    fclose(file); // Close the file after checking
 
-    // Error check for total number of frames
-    if (totalFrames <= 0)
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    if (bufferManager->mappedIO || numPages <= 0)
     {
-        return RC_WRITE_FAILED; // Return error if number of frames is invalid
+        return RC_OK;
     }
 
-    // Initialize buffer manager
-    BufferManager *bufferManager = malloc(sizeof(BufferManager));
-    switch ((bufferManager == NULL) ? 1 : 0)
+    // Reads of thread-safe pools are not left in flight, each shard loads its pages in one batch
+    if (bufferManager->sharedFile != NULL)
     {
-    case 1:
-        return RC_WRITE_FAILED;
-        break;
-    case 0:
-        break;
+        return readAheadShared(bufferPool, pageList, numPages);
+    }
+    if (bufferManager->shards != NULL)
+    {
+        return readAheadSharded(bufferPool, pageList, numPages);
+    }
+    return prefetchList(bufferPool, pageList, numPages);
+}
 
-    default:
-        break;
+RC prefetchPages(BM_BufferPool *const bufferPool, const PageNumber firstPage, const int numPages)
+{
+    if (numPages <= 0)
+    {
+        return (bufferPool == NULL || bufferPool->mgmtData == NULL) ? RC_FILE_NOT_FOUND : RC_OK;
     }
-    initializeBufferManager(bufferManager, totalFrames, strategyData);
 
-    PageFrame *headFrame = NULL;
-    FrameStatistics *headStat = NULL;
+    PageNumber *pageList = malloc(sizeof(PageNumber) * numPages);
+    if (pageList == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    for (int i = 0; i < numPages; i++)
+    {
+        pageList[i] = firstPage + i;
+    }
+    RC result = prefetchPageList(bufferPool, pageList, numPages);
+    free(pageList);
+    return result;
+}
 
-    // Create the first page frame and statistics
-    RC result = createFirstPageFrame(bufferManager, &headFrame, &headStat);
-    if (result != RC_OK)
+RC resizeBufferPool(BM_BufferPool *const bufferPool, const int numPages)
+{
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
     {
-        return result;
+        return RC_FILE_NOT_FOUND;
+    }
+    if (numPages <= 0)
+    {
+        return RC_WRITE_FAILED; // Same rule as initBufferPool
     }
 
-    // Create the additional frames and statistics
-    result = createAdditionalFrames(bufferManager, &headFrame, &headStat, totalFrames);
-    if (result != RC_OK)
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    if (bufferManager->sharedFile != NULL)
     {
-        return result;
+        return setFileQuota(bufferPool, numPages); // The process-wide pool is sized once, the file's share is not
+    }
+    if (bufferManager->shards == NULL)
+    {
+        waitForPrefetches(bufferPool); // Frames with a read in flight are held and the in-flight list is sized by the pool
+        return resizeFrames(bufferPool, numPages, &bufferPool->fH);
     }
 
-    // Complete the circular linking for the clock algorithm
-    headFrame->nextFrame = bufferManager->firstFrame;
+    // The background writer sizes its buffers by the pool, so it is restarted around the resize
+    // Saved pages still being read back are not worth holding the resize up for
+    stopWarmLoader(bufferManager);
+    bool cleanerActive = bufferManager->cleanerActive;
+    double cleanFraction = bufferManager->cleanFraction;
+    int cleanIntervalMs = bufferManager->cleanIntervalMs;
+    stopCleaner(bufferManager);
+    RC result = resizeSharded(bufferPool, numPages);
+    if (cleanerActive)
+    {
+        RC started = startCleaner(bufferPool, cleanFraction, cleanIntervalMs);
+        result = (result == RC_OK) ? started : result;
+    }
+    return result;
+}
 
-    switch (1)
+RC discardWarmPages(const char *pageFileName)
+{
+    if (pageFileName == NULL)
     {
-    case 1:
-        bufferManager->firstFrame->prevFrame = headFrame;
-        break;
+        return RC_FILE_NOT_FOUND;
     }
+    char *name = warmFileName(pageFileName);
+    if (name == NULL)
+    {
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    remove(name); // Files of pools that never saved a list have none
+    free(name);
+    return RC_OK;
+}
 
-    switch (1)
+RC startPoolTrace(BM_BufferPool *const bufferPool, const char *fileName)
+{
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
     {
-    case 1:
-        bufferManager->lastFrame = headFrame;
-        break;
+        return RC_FILE_NOT_FOUND; // Buffer pool not open
+    }
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    if (bufferManager->trace != NULL || fileName == NULL)
+    {
+        return RC_WRITE_FAILED; // One trace at a time
     }
 
-    // Initialize buffer pool
-    switch (1)
+    BM_Trace *trace = malloc(sizeof(BM_Trace));
+    if (trace == NULL)
     {
-    case 1:
-        switch (RC_OK)
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    trace->file = fopen(fileName, "wb");
+    if (trace->file == NULL || fwrite(BM_TRACE_MAGIC, 1, 8, trace->file) != 8)
+    {
+        if (trace->file != NULL)
         {
-        case RC_OK:
-            bufferPool->numPages = totalFrames;
-            break;
-        default:
-            break;
+            fclose(trace->file);
         }
+        free(trace);
+        return RC_WRITE_FAILED;
+    }
+    pthread_mutex_init(&trace->latch, NULL);
+    trace->numRecords = 0;
+    trace->failed = false;
+    bufferManager->trace = trace;
+    return RC_OK;
+}
 
-        switch (RC_OK)
-        {
-        case RC_OK:
-            bufferPool->pageFile = (char *)fileName;
-            break;
-        default:
-            break;
-        }
+RC stopPoolTrace(BM_BufferPool *const bufferPool)
+{
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
+    {
+        return RC_FILE_NOT_FOUND; // Buffer pool not open
+    }
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    BM_Trace *trace = bufferManager->trace;
+    if (trace == NULL)
+    {
+        return RC_WRITE_FAILED; // No trace taken
+    }
+
+    bufferManager->trace = NULL;
+    writeTraceRecords(trace);
+    bool failed = trace->failed;
+    if (fclose(trace->file) != 0)
+    {
+        failed = true;
+    }
+    pthread_mutex_destroy(&trace->latch);
+    free(trace);
+    return failed ? RC_WRITE_FAILED : RC_OK;
+}
+
+RC initBufferPool(BM_BufferPool *const bufferPool, const char *const fileName,
+                  const int totalFrames, ReplacementStrategy strategy,
+                  void *strategyData)
+{
+    return initBufferPoolWithOptions(bufferPool, fileName, totalFrames, strategy, strategyData, NULL);
+}
+
+RC initBufferPoolWithOptions(BM_BufferPool *const bufferPool, const char *const fileName,
+                             const int totalFrames, ReplacementStrategy strategy,
+                             void *strategyData, const BM_PoolOptions *options)
+{
+    // Files of the process-wide pool keep their pages in its frames, without one running they get frames of their own
+    if (options != NULL && options->shared && sharedPoolRunning())
+    {
+        RC result = registerSharedFile(bufferPool, fileName, options);
+        return (result == RC_OK) ? startOptionalTrace(bufferPool, options) : result;
+    }
+
+    // Error check for total number of frames
+    if (totalFrames <= 0)
+    {
+        return RC_WRITE_FAILED; // Return error if number of frames is invalid
+    }
+    int shards = (options != NULL) ? options->shards : 0;
+    if (shards < 0 || shards > totalFrames)
+    {
+        return RC_WRITE_FAILED; // Every shard needs a frame
+    }
+    double cleanFraction = (options != NULL) ? options->cleanFraction : 0;
+    int cleanIntervalMs = (options != NULL) ? options->cleanIntervalMs : 0;
+    if (cleanFraction < 0 || cleanFraction > 1 || cleanIntervalMs < 0)
+    {
+        return RC_WRITE_FAILED;
+    }
+    if (cleanFraction > 0 && shards == 0)
+    {
+        shards = 1; // The background writer needs the latches of a thread-safe pool
+    }
+
+    // Open the page file once, the pool keeps the handle for its lifetime
+    // Mapped files are served from the page cache, so they take precedence over direct I/O
+    bool mappedIO = (options != NULL && options->mappedIO);
+    bool directIO = (options != NULL && options->directIO && !mappedIO);
+    RC result;
+    if (mappedIO)
+    {
+        result = openPageFileMapped((char *)fileName, &bufferPool->fH);
+    }
+    else if (directIO)
+    {
+        result = openPageFileDirect((char *)fileName, &bufferPool->fH);
+    }
+    else
+    {
+        result = openPageFile((char *)fileName, &bufferPool->fH);
+    }
+    if (result != RC_OK)
+    {
+        return result; // Return error if the file does not exist
+    }
 
-        switch (RC_OK)
-        {
-        case RC_OK:
-            bufferPool->strategy = strategy;
-            break;
-        default:
-            break;
-        }
+    // Fall back to copying pages when the platform could not map the file
+    SM_PageHandle probe;
+    mappedIO = mappedIO && getBlockPointer(0, &bufferPool->fH, &probe) == RC_OK;
 
-        switch (RC_OK)
+    // Thread-safe pools build one buffer manager per shard around the same file handle
+    result = (shards > 0) ? initShardedPool(bufferPool, fileName, totalFrames, strategy, strategyData, mappedIO, shards)
+                          : buildBufferManager(bufferPool, fileName, totalFrames, strategy, strategyData, mappedIO);
+    if (result == RC_OK)
+    {
+        setPinTiming(bufferPool->mgmtData, options != NULL && options->pinTiming);
+    }
+    if (result == RC_OK && cleanFraction > 0)
+    {
+        result = startCleaner(bufferPool, cleanFraction, cleanIntervalMs);
+        if (result != RC_OK)
         {
-        case RC_OK:
-            bufferPool->mgmtData = bufferManager;
-            break;
-        default:
-            break;
+            freeShards(bufferPool->mgmtData);
+            freeBufferManager(bufferPool->mgmtData);
+            free(bufferPool->mgmtData);
+            bufferPool->mgmtData = NULL;
         }
-
-        return RC_OK;
     }
-
-    return RC_OK;
+    if (result != RC_OK)
+    {
+        closePageFile(&bufferPool->fH);
+        return result;
+    }
+    result = startOptionalTrace(bufferPool, options);
+    if (result == RC_OK && options != NULL && options->warmRestart)
+    {
+        startWarmRestart(bufferPool, fileName);
+    }
+    return result;
 }
 
 RC shutdownBufferPool(BM_BufferPool *const bufferPool)
@@ -1206,6 +5732,19 @@ RC shutdownBufferPool(BM_BufferPool *const bufferPool)
     {
         return RC_FILE_NOT_FOUND; // Check if buffer pool is open
     }
+    if (((BufferManager *)bufferPool->mgmtData)->trace != NULL)
+    {
+        stopPoolTrace(bufferPool); // A failed trace write does not keep the pool open
+    }
+    if (sharedFileOf(bufferPool) != NULL)
+    {
+        return unregisterSharedFile(bufferPool); // The frames belong to the process-wide pool and stay
+    }
+    // The warm loader, background writer and prefetch reads must not touch the frames once they are flushed and freed
+    stopWarmLoader(bufferPool->mgmtData);
+    stopCleaner(bufferPool->mgmtData);
+    waitForPrefetches(bufferPool);
+
     // Write dirty pages to disk
     RC result = forceFlushPool(bufferPool);
     if (result != RC_OK)
@@ -1219,9 +5758,21 @@ RC shutdownBufferPool(BM_BufferPool *const bufferPool)
     {
         return RC_OK; // Return if no buffer manager to free
     }
+    if (bufferManager->warmFile != NULL)
+    {
+        saveWarmPages(bufferPool); // The pages are clean and unchanged until the frames are freed
+    }
+
+    // Free all page frames and the page table, thread-safe pools keep theirs in the shards
+    freeShards(bufferManager);
+    freeBufferManager(bufferManager);
 
-    // Free all page frames
-    freePageFramesShutdown(bufferManager);
+    // Release the page file handle opened by initBufferPool
+    result = closePageFile(&bufferPool->fH);
+    if (result != RC_OK)
+    {
+        return result;
+    }
 
     do
     {
@@ -1273,9 +5824,106 @@ RC shutdownBufferPool(BM_BufferPool *const bufferPool)
     } while (true);
 }
 
+RC initSharedBufferPool(const int numPages, ReplacementStrategy strategy, void *stratData, const BM_PoolOptions *options)
+{
+    // The pool is always thread-safe, tables and indexes may be used from several threads
+    int shards = (options != NULL && options->shards > 0) ? options->shards : 1;
+    double cleanFraction = (options != NULL) ? options->cleanFraction : 0;
+    int cleanIntervalMs = (options != NULL) ? options->cleanIntervalMs : 0;
+    if (numPages <= 0 || shards > numPages || cleanFraction < 0 || cleanFraction > 1 || cleanIntervalMs < 0)
+    {
+        return RC_WRITE_FAILED; // Same rules as initBufferPoolWithOptions
+    }
+
+    pthread_mutex_lock(&sharedRegistryLatch);
+    if (sharedPool.mgmtData != NULL)
+    {
+        pthread_mutex_unlock(&sharedRegistryLatch);
+        return RC_WRITE_FAILED; // There is one pool per process
+    }
+    BM_SharedFile *files = calloc(BM_SHARED_MAX_FILES, sizeof(BM_SharedFile));
+    if (files == NULL)
+    {
+        pthread_mutex_unlock(&sharedRegistryLatch);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+
+    // No file of its own, transfers go through the handles of the registered files
+    memset(&sharedPool, 0, sizeof(BM_BufferPool));
+    sharedPool.fH.pageSize = PAGE_SIZE;
+    RC result = initShardedPool(&sharedPool, NULL, numPages, strategy, stratData, false, shards);
+    if (result == RC_OK)
+    {
+        BufferManager *sharedManager = sharedPool.mgmtData;
+        sharedManager->sharedFiles = files;
+        setPinTiming(sharedManager, options != NULL && options->pinTiming);
+        for (int i = 0; i < sharedManager->numShards; i++)
+        {
+            ((BufferManager *)sharedManager->shards[i].pool.mgmtData)->sharedFiles = files;
+        }
+        if (cleanFraction > 0)
+        {
+            result = startCleaner(&sharedPool, cleanFraction, cleanIntervalMs);
+            if (result != RC_OK)
+            {
+                freeShards(sharedManager);
+                freeBufferManager(sharedManager);
+                free(sharedManager);
+                sharedPool.mgmtData = NULL;
+            }
+        }
+    }
+    if (result != RC_OK)
+    {
+        free(files);
+    }
+    pthread_mutex_unlock(&sharedRegistryLatch);
+    return result;
+}
+
+RC shutdownSharedBufferPool(void)
+{
+    pthread_mutex_lock(&sharedRegistryLatch);
+    BufferManager *sharedManager = sharedPool.mgmtData;
+    if (sharedManager == NULL)
+    {
+        pthread_mutex_unlock(&sharedRegistryLatch);
+        return RC_FILE_NOT_FOUND;
+    }
+    for (int i = 0; i < BM_SHARED_MAX_FILES; i++)
+    {
+        if (sharedManager->sharedFiles[i].inUse)
+        {
+            pthread_mutex_unlock(&sharedRegistryLatch);
+            return RC_WRITE_FAILED; // Files still keep pages in it, shutdownBufferPool takes them out
+        }
+    }
+
+    // Files write back and drop their pages when they leave, so nothing is left to flush
+    stopCleaner(sharedManager);
+    freeShards(sharedManager);
+    freeBufferManager(sharedManager);
+    free(sharedManager->sharedFiles);
+    free(sharedManager);
+    memset(&sharedPool, 0, sizeof(BM_BufferPool));
+    pthread_mutex_unlock(&sharedRegistryLatch);
+    return RC_OK;
+}
+
 RC markDirty(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle ,const PageNumber pageNum)
 {
+    PageNumber key = pageNum;
+    BM_BufferPool *pool = targetPool(bufferPool, &key);
+    if (pool != bufferPool)
+    {
+        // Pages of a registered file live in the process-wide pool under their key
+        return traceCall(bufferPool, BM_TRACE_DIRTY, pageNum, markDirty(pool, pageHandle, key));
+    }
     BufferManager *bufferManager = bufferPool->mgmtData;
+    if (bufferManager != NULL && bufferManager->shards != NULL)
+    {
+        return traceCall(bufferPool, BM_TRACE_DIRTY, pageNum, callOnShard(bufferPool, pageHandle, pageNum, markDirty));
+    }
     PageFrame *currentFrame = bufferManager->firstFrame;
 
     do
@@ -1289,7 +5937,7 @@ RC markDirty(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle ,c
             break;
         }
 
-        currentFrame = findPageFrame(bufferManager, pageNum);
+        currentFrame = handleFrame(bufferManager, pageHandle, pageNum);
         switch ((currentFrame == NULL)? 1 : 0)
         {
         case 1:
@@ -1299,7 +5947,7 @@ RC markDirty(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle ,c
             break;
         }
 
-        return RC_OK; // Successfully marked the page as dirty
+        return traceCall(bufferPool, BM_TRACE_DIRTY, pageNum, RC_OK); // Successfully marked the page as dirty
     } while (true);
 }
 
@@ -1316,169 +5964,254 @@ RC unpinPage(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, c
     {
         return RC_FILE_NOT_FOUND; // Invalid page handle
     }
-    // Get the buffer manager from the buffer pool
+    PageNumber key = pageNum;
+    BM_BufferPool *pool = targetPool(bufferPool, &key);
+    if (pool != bufferPool)
+    {
+        // Pages of a registered file live in the process-wide pool under their key
+        return traceCall(bufferPool, BM_TRACE_UNPIN, pageNum, unpinPage(pool, pageHandle, key));
+    }
+    // Get the buffer manager from the buffer pool, thread-safe pools unpin under the shard latch
     BufferManager *bufferManager = bufferPool->mgmtData;
+    if (bufferManager->shards != NULL)
+    {
+        return traceCall(bufferPool, BM_TRACE_UNPIN, pageNum, callOnShard(bufferPool, pageHandle, pageNum, unpinPage));
+    }
 
-    // Find the corresponding page frame for the given page number
-    PageFrame *currentFrame = findPageFrame(bufferManager, pageNum);
+    // Find the frame of the page through the handle of its pin, or by its page number
+    PageFrame *currentFrame = handleFrame(bufferManager, pageHandle, pageNum);
 
     if (currentFrame == NULL)
     {
         return RC_READ_NON_EXISTING_PAGE; // Return error if page does not exist
     }
 
-    // Decrement the fix count and update the reference bit if needed
-    return updateFixCount(currentFrame);
+    // Drop the pin's latch, then decrement the fix count and update the reference bit if needed
+    releaseFrameLatch(currentFrame, pageHandle);
+    return traceCall(bufferPool, BM_TRACE_UNPIN, pageNum, updateFixCount(currentFrame));
 }
 
 // Helper function to check if a page is in the buffer pool
 bool isPageInBuffer(BufferManager *bufferManager, PageNumber pageID)
 {
-    PageFrame *currentFrame = bufferManager->firstFrame;
-
-    // Iterate through frames to check for the page
-    do
-    {
-        if (currentFrame->pageID == pageID && currentFrame->referenceCount > 0)
-        {
-            return true; // Page is found and pinned
-        }
-        currentFrame = currentFrame->nextFrame;
-    } while (currentFrame != bufferManager->firstFrame);
-
-    return false; // Page not found in the buffer
+    PageFrame *currentFrame = pageTableLookup(bufferManager, pageID);
+    return currentFrame != NULL && currentFrame->referenceCount > 0; // Page is found and pinned
 }
 
 RC forcePage(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle,const PageNumber pageNum)
 {
-    do
+    // Check if buffer pool is open
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
     {
-        // Check if buffer pool is open
-        if (bufferPool == NULL || bufferPool->mgmtData == NULL)
-        {
-            return RC_FILE_NOT_FOUND; // Return error if buffer pool is not open
-        }
-
-        BufferManager *bufferManager = bufferPool->mgmtData;
-        SM_FileHandle fileHandle;
-        RC result = openPageFile(bufferPool->pageFile, &fileHandle); // Open the page file
+        return RC_FILE_NOT_FOUND; // Return error if buffer pool is not open
+    }
+    PageNumber key = pageNum;
+    BM_BufferPool *pool = targetPool(bufferPool, &key);
+    if (pool != bufferPool)
+    {
+        return forcePage(pool, pageHandle, key); // Pages of a registered file live in the process-wide pool under their key
+    }
 
-        switch (result)
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    PageFrame *frame = latchForcedFrame(bufferPool, pageHandle, pageNum);
+    if (bufferManager->shards != NULL)
+    {
+        RC result = forcePageSharded(bufferPool, pageHandle, pageNum);
+        if (frame != NULL)
         {
-        case RC_OK:
-            break; // File opened successfully
-        default:
-            return result; // Return error if opening the file fails
+            pthread_rwlock_unlock(&frame->latch);
         }
+        return result;
+    }
 
-        // Write the page data to disk
-        result = writePageData(pageNum, &fileHandle, pageHandle->data);
-
-        switch (result)
-        {
-        case RC_OK:
-            bufferManager->writeOperations++; // Increment write operations count
-            closePageFile(&fileHandle);
-            return RC_OK; // Return success
-        default:
-            closePageFile(&fileHandle);
-            return result; // Return error if writing fails
-        }
+    // Write the page data to disk through the pool's file handle
+    RC result = writePageData(bufferManager, pageNum, &bufferPool->fH, pageHandle->data);
+    if (frame != NULL)
+    {
+        pthread_rwlock_unlock(&frame->latch);
+    }
 
-    } while (true);
+    switch (result)
+    {
+    case RC_OK:
+        bufferManager->writeOperations++; // Increment write operations count
+        return RC_OK;                     // Return success
+    default:
+        return result; // Return error if writing fails
+    }
 }
 
 RC pinPage(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum)
 {
+    // A failed pin leaves the handle referring to no frame and holding no latch
+    if (pageHandle != NULL)
+    {
+        pageHandle->frame = -1;
+        pageHandle->generation = 0;
+        pageHandle->latch = BM_LATCH_NONE;
+    }
     if (bufferPool == NULL || bufferPool->mgmtData == NULL)
     {
         return RC_FILE_NOT_FOUND; // Buffer pool not open
     }
-
     if (pageNum < 0)
     {
         return RC_IM_KEY_NOT_FOUND;
     }
 
-    switch (bufferPool->strategy)
+    if (sharedFileOf(bufferPool) != NULL)
     {
-    case RS_LRU_K:
+        // The page lives in the process-wide pool under its key
+        return traceCall(bufferPool, BM_TRACE_PIN, pageNum, pinShared(bufferPool, pageHandle, pageNum));
+    }
+    if (((BufferManager *)bufferPool->mgmtData)->shards != NULL)
     {
-        return pinLRUK(bufferPool, pageHandle, pageNum);
+        // Thread-safe pools latch the page's shard
+        return traceCall(bufferPool, BM_TRACE_PIN, pageNum, pinSharded(bufferPool, pageHandle, pageNum));
     }
-
-    case RS_FIFO:
+    // A prefetched page is only pinned once its read is finished, pins that read their page are the misses
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    long long start = bufferManager->pinTiming ? currentTimeNanos() : 0;
+    finishPrefetches(bufferPool, pageNum);
+    int reads = bufferManager->readOperations;
+    RC result = pinWithStrategy(bufferPool, pageHandle, pageNum);
+    if (result == RC_OK)
     {
-        RC result;
-        bool success = false;
-
-        do
-        {
-            result = pinFIFO(bufferPool, pageHandle, pageNum, false);
+        notePin(bufferManager, bufferManager->readOperations == reads, start);
+    }
+    return traceCall(bufferPool, BM_TRACE_PIN, pageNum, result);
+}
 
-            switch (result)
-            {
-            case RC_OK:
-                success = true;
-                break;
+RC pinPageLatched(BM_BufferPool *const bufferPool, BM_PageHandle *const pageHandle, const PageNumber pageNum, BM_LatchMode mode)
+{
+    if (mode != BM_LATCH_NONE && mode != BM_LATCH_SHARED && mode != BM_LATCH_EXCLUSIVE)
+    {
+        return RC_IM_KEY_NOT_FOUND;
+    }
 
-            default:
-                return result;
-            }
-        } while (!success);
+    RC result = pinPage(bufferPool, pageHandle, pageNum);
+    if (result != RC_OK || mode == BM_LATCH_NONE)
+    {
+        return result;
+    }
 
-        return RC_OK;
+    // The pin keeps the frame from being reused, so its latch is waited for without holding any pool latch
+    // The handle the pin just filled refers to the frame, no page table lookup is needed to find it
+    PageFrame *frame = findPinnedFrame(bufferPool, pageHandle, pageNum);
+    int busy = (mode == BM_LATCH_SHARED) ? pthread_rwlock_tryrdlock(&frame->latch)
+                                         : pthread_rwlock_trywrlock(&frame->latch);
+    if (busy != 0)
+    {
+        long long start = currentTimeNanos();
+        if (mode == BM_LATCH_SHARED)
+        {
+            pthread_rwlock_rdlock(&frame->latch);
+        }
+        else
+        {
+            pthread_rwlock_wrlock(&frame->latch);
+        }
+        PageNumber key = pageNum;
+        notePinWait(targetPool(bufferPool, &key)->mgmtData, start); // Files of the process-wide pool count in it
     }
+    pageHandle->latch = mode;
+    return RC_OK;
+}
 
-    case RS_CLOCK:
+RC initScanRing(BM_BufferPool *const bufferPool, BM_ScanRing *ring, const int numFrames)
+{
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
     {
-        RC result;
-        bool success = false;
+        return RC_FILE_NOT_FOUND; // Buffer pool not open
+    }
+    if (ring == NULL || numFrames <= 0)
+    {
+        return RC_WRITE_FAILED;
+    }
 
-        do
-        {
-            result = pinCLOCK(bufferPool, pageHandle, pageNum);
+    ring->loaded = malloc(sizeof(PageNumber) * numFrames);
+    ring->prefetched = malloc(sizeof(PageNumber) * numFrames);
+    if (ring->loaded == NULL || ring->prefetched == NULL)
+    {
+        free(ring->loaded);
+        free(ring->prefetched);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    ring->pool = bufferPool;
+    ring->numFrames = numFrames;
+    ring->head = 0;
+    ring->count = 0;
+    ring->numPrefetched = 0;
+    ring->current = NO_PAGE;
+    ring->currentLoaded = false;
+    return RC_OK;
+}
 
-            switch (result)
-            {
-            case RC_OK:
-                success = true;
-                break;
-            default:
-                return result;
-            }
-        } while (!success);
+RC pinPageInRing(BM_ScanRing *ring, BM_PageHandle *const pageHandle, const PageNumber pageNum, BM_LatchMode mode)
+{
+    if (ring == NULL || ring->pool == NULL)
+    {
+        return RC_FILE_NOT_FOUND;
+    }
 
-        return RC_OK;
+    // Pages are counted once, when the scan moves on to them, however often it pins them while it is there
+    if (pageNum != ring->current)
+    {
+        leaveRingPage(ring);
+        ring->current = pageNum;
+        ring->currentLoaded = takePrefetchedPage(ring, pageNum) || !poolHoldsPage(ring->pool, pageNum);
     }
+    return pinPageLatched(ring->pool, pageHandle, pageNum, mode);
+}
 
-    case RS_LRU:
+RC prefetchRingPages(BM_ScanRing *ring, const PageNumber firstPage, const int numPages)
+{
+    if (ring == NULL || ring->pool == NULL)
     {
-        RC result;
-        bool success = false;
+        return RC_FILE_NOT_FOUND;
+    }
 
-        do
+    // The pages that are not resident yet are the ones the prefetch brings in, it stops where the ring could not
+    // list them, or they would stay behind the scan
+    PageNumber pageNum = firstPage;
+    for (; pageNum < firstPage + numPages; pageNum++)
+    {
+        bool listed = (pageNum == ring->current);
+        for (int i = 0; i < ring->numPrefetched && !listed; i++)
         {
-            result = pinLRU(bufferPool, pageHandle, pageNum);
-
-            switch (result)
+            listed = (ring->prefetched[i] == pageNum);
+        }
+        if (!listed && !poolHoldsPage(ring->pool, pageNum))
+        {
+            if (ring->numPrefetched == ring->numFrames)
             {
-            case RC_OK:
-                success = true;
                 break;
-            default:
-                return result;
             }
-        } while (!success);
-
+            ring->prefetched[ring->numPrefetched++] = pageNum;
+        }
+    }
+    if (pageNum == firstPage)
+    {
         return RC_OK;
     }
+    return prefetchPages(ring->pool, firstPage, pageNum - firstPage);
+}
 
-    default:
+RC closeScanRing(BM_ScanRing *ring)
+{
+    if (ring == NULL || ring->pool == NULL)
     {
-        return RC_IM_KEY_NOT_FOUND;
-    }
+        return RC_FILE_NOT_FOUND;
     }
+
+    // The last pages of the scan stay resident, like those of a scan without a ring
+    leaveRingPage(ring);
+    free(ring->loaded);
+    free(ring->prefetched);
+    ring->loaded = NULL;
+    ring->prefetched = NULL;
+    ring->pool = NULL;
+    return RC_OK;
 }
 
 // Main function to get frame contents
@@ -1489,6 +6222,16 @@ PageNumber *getFrameContents(BM_BufferPool *const bufferPool)
         return NULL;
 
     BufferManager *bufferManager = bufferPool->mgmtData;  // Access buffer manager
+    if (bufferManager->sharedFile != NULL)
+    {
+        gatherFileFrames(bufferPool, frameNumbers, NULL, NULL);
+        return frameNumbers;
+    }
+    if (bufferManager->shards != NULL)
+    {
+        gatherShardFrames(bufferManager, frameNumbers, NULL, NULL);
+        return frameNumbers;
+    }
     FrameStatistics *statHead = bufferManager->statsHead; // Start from the head of the statistics list
     int count = 0;
 
@@ -1511,6 +6254,16 @@ bool *getDirtyFlags(BM_BufferPool *const bm)
         switch ((dirtyFlags != NULL)? 1 : 0)
         {
         case 1:
+            if (bufferManager->sharedFile != NULL)
+            {
+                gatherFileFrames(bm, NULL, dirtyFlags, NULL);
+                return dirtyFlags;
+            }
+            if (bufferManager->shards != NULL)
+            {
+                gatherShardFrames(bufferManager, NULL, dirtyFlags, NULL);
+                return dirtyFlags;
+            }
             retrieveDirtyFlags(statHead, dirtyFlags, bm->numPages); // Retrieve dirty flags
             return dirtyFlags;                                      // Return the array of dirty flags
         case 0:
@@ -1530,6 +6283,16 @@ int *getFixCounts(BM_BufferPool *const bufferPool)
         return NULL;
 
     BufferManager *bufferManager = bufferPool->mgmtData;  // Access buffer manager
+    if (bufferManager->sharedFile != NULL)
+    {
+        gatherFileFrames(bufferPool, NULL, NULL, fixCounts);
+        return fixCounts;
+    }
+    if (bufferManager->shards != NULL)
+    {
+        gatherShardFrames(bufferManager, NULL, NULL, fixCounts);
+        return fixCounts;
+    }
     FrameStatistics *statHead = bufferManager->statsHead; // Start from the head of the statistics list
 
     retrieveFixCounts(statHead, fixCounts, bufferPool->numPages); // Retrieve fix counts
@@ -1540,6 +6303,7 @@ int *getFixCounts(BM_BufferPool *const bufferPool)
 int getNumReadIO(BM_BufferPool *const bufferPool)
 {
     BufferManager *bufferManager = bufferPool->mgmtData;
+    gatherShardIO(bufferManager); // Thread-safe pools count I/O per shard
     switch (1)
     {
     case 1:
@@ -1553,6 +6317,7 @@ int getNumWriteIO(BM_BufferPool *const bufferPool)
 {
     BufferManager *bufferManager = bufferPool->mgmtData; // Access buffer manager
     int writeIOCount;                                    // Variable to hold write I/O count
+    gatherShardIO(bufferManager);
 
     do
     {
@@ -1570,3 +6335,44 @@ int getNumWriteIO(BM_BufferPool *const bufferPool)
     // This line is unreachable but added to satisfy all code paths
     return 0;
 }
+
+long long getReadIOTime(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    gatherShardIO(bufferManager);
+    return bufferManager->readIOTime; // Nanoseconds spent reading pages
+}
+
+long long getWriteIOTime(BM_BufferPool *const bufferPool)
+{
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    gatherShardIO(bufferManager);
+    return bufferManager->writeIOTime; // Nanoseconds spent writing pages
+}
+
+RC getBufferPoolStats(BM_BufferPool *const bufferPool, BM_PoolStats *stats)
+{
+    if (bufferPool == NULL || bufferPool->mgmtData == NULL)
+    {
+        return RC_FILE_NOT_FOUND; // Buffer pool not open
+    }
+    if (stats == NULL)
+    {
+        return RC_WRITE_FAILED;
+    }
+
+    // Files of the process-wide pool report the pool's pins and evictions next to their own I/O
+    memset(stats, 0, sizeof(BM_PoolStats));
+    PageNumber key = 0;
+    gatherPoolStats(targetPool(bufferPool, &key)->mgmtData, stats);
+    long long pins = stats->hits + stats->misses;
+    stats->hitRatio = (pins > 0) ? (double)stats->hits / pins : 0;
+
+    BufferManager *bufferManager = bufferPool->mgmtData;
+    gatherShardIO(bufferManager);
+    stats->readIO = bufferManager->readOperations;
+    stats->writeIO = bufferManager->writeOperations;
+    stats->readIOTime = bufferManager->readIOTime;
+    stats->writeIOTime = bufferManager->writeIOTime;
+    return RC_OK;
+}
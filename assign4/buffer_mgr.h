@@ -8,17 +8,22 @@
 // Include bool DT
 #include "dt.h"
 
+// Latches of thread-safe pools
+#include <pthread.h>
+#include <stdio.h>
+
 // Replacement Strategies
 typedef enum ReplacementStrategy {
 	RS_FIFO = 0,
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_2Q = 5,
+	RS_ARC = 6
 } ReplacementStrategy;
 
 // Data Types and Structures
-typedef int PageNumber;
 #define NO_PAGE -1
 
 
@@ -29,15 +34,51 @@ typedef int PageNumber;
 // Struct representing a page in the buffer
 typedef struct PageFrame
 {
-    int pageID;
-    bool isModified;
+    // Fields read by page lookups and victim scans come first and fit in 64 bytes, apart from the latch and prefetch state
+    PageNumber pageID;
     int referenceCount;
-    char pageData[PAGE_SIZE];
+    bool isModified;
     bool accessed;
+    bool ioPending; // Page is being read or written without the shard latch, pinners of it wait
+    char *pageData; // One page of the pool's page size sliced from the frame arena, or lent by a mapped page file
     struct PageFrame *nextFrame;
     struct PageFrame *prevFrame;
+    struct LFUBucket *lfuBucket; // Frequency bucket of the frame, LFU only
+    struct PageFrame *lfuNewer;  // Neighbours within the bucket, most recently referenced towards lfuNewer
+    struct PageFrame *lfuOlder;
+    pthread_rwlock_t latch; // Held shared or exclusive by pins made with pinPageLatched
+    struct PrefetchBatch *prefetchBatch; // Batch of the frame's prefetch read while it is in flight, NULL otherwise
+    SM_IORequest *prefetchRead;
+    bool spare; // Taken out of the pool by resizeBufferPool, kept with its chunk until the pool grows again
+    int frameIndex; // Position in the pool's frame directory, page handles refer to the frame by it
+    unsigned int generation; // Advanced whenever the frame takes another page, so handles of earlier pins are ignored
 } PageFrame;
 
+// Reads submitted together by one prefetch call, kept until every one of them is finished
+typedef struct PrefetchBatch
+{
+    int unfinished;            // Reads of the batch whose frames still wait for them
+    SM_IORequest requests[];   // Owned by the storage manager while in flight, so they must not move
+} PrefetchBatch;
+
+// Frames whose pages were referenced the same number of times, buckets are kept in increasing order for O(1) LFU
+typedef struct LFUBucket
+{
+    long long frequency;       // 0 for empty frames and pages loaded by read-ahead but not pinned yet
+    PageFrame *newest;
+    PageFrame *oldest;
+    struct LFUBucket *higher;  // Bucket with the next larger frequency, NULL for the largest
+    struct LFUBucket *lower;
+} LFUBucket;
+
+typedef struct LFUState
+{
+    LFUBucket *lowest;         // Bucket with the smallest frequency, every frame is in some bucket
+    LFUBucket *spareBuckets;   // Emptied buckets kept for reuse, linked through higher
+    int agingPeriod;           // Pins between two agings that halve every frequency, 0 turns aging off
+    int sinceAging;
+} LFUState;
+
 // Struct for tracking statistics in the buffer pool
 typedef struct FrameStatistics
 {
@@ -45,6 +86,113 @@ typedef struct FrameStatistics
     struct FrameStatistics *nextStat;
 } FrameStatistics;
 
+// Frames allocated together, a pool keeps them in one array and their pages in one arena instead of a block each
+typedef struct FrameChunk
+{
+    PageFrame *frames;         // Linked in array order when the chunk is created
+    FrameStatistics *stats;
+    char *data;                // Page-aligned mapping, frame i holds the page at i * pageSize, NULL for mapped pools
+    size_t dataBytes;          // Length of the mapping, rounded up to whole huge pages when they back it
+    int count;
+    struct FrameChunk *next;
+} FrameChunk;
+
+// Slot of the page table, an open-addressing hash from page number to frame
+typedef struct PageTableEntry
+{
+    PageNumber pageID; // NO_PAGE marks an empty slot
+    PageFrame *frame;
+} PageTableEntry;
+
+// Reference history of a page for LRU-K, kept while the page is resident and for a while after it is evicted
+typedef struct LRUKHistory
+{
+    PageNumber pageID;     // NO_PAGE marks an empty slot
+    long long *times;      // Starts of the last K uncorrelated references, most recent first, 0 if missing
+    long long last;        // Time of the most recent reference, correlated or not
+    long long retainedAt;  // Eviction sequence number while the page is not resident, 0 while it is
+} LRUKHistory;
+
+// State of the LRU-K policy, times are a logical clock advanced on every pin
+typedef struct LRUKState
+{
+    int k;                      // Number of references the policy looks back over, from stratData
+    long long clock;
+    LRUKHistory *table;         // Open-addressing hash from page number to history
+    long long *timeSlab;        // K times for every slot, slots hand their arrays along when entries move
+    int tableSize;              // Number of slots, always a power of two
+    int tableBits;              // log2(tableSize), used by the hash
+    PageNumber *retainedPages;  // Ring of evicted pages whose history is kept, oldest first
+    long long *retainedSeq;     // Eviction sequence number of each ring entry
+    int retainedLimit;          // Most histories kept for pages that are not resident
+    int retainedHead;
+    int retainedCount;
+    long long evictions;        // Source of eviction sequence numbers
+} LRUKState;
+
+// Queues of the 2Q and ARC policies, resident pages and ghosts (evicted pages remembered by number) alike
+#define QUEUE_RECENT 0          // 2Q A1in, ARC T1: resident pages referenced once
+#define QUEUE_FREQUENT 1        // 2Q Am, ARC T2: resident pages referenced again
+#define QUEUE_RECENT_GHOST 2    // 2Q A1out, ARC B1: pages evicted from the recent queue
+#define QUEUE_FREQUENT_GHOST 3  // ARC B2: pages evicted from the frequent queue
+#define QUEUE_COUNT 4
+
+// Node of a page on one of the queues, linked by index so the hash can move freely
+typedef struct QueueNode
+{
+    PageNumber pageID;
+    int queue;
+    int prev;          // Towards the newest end, -1 at the head
+    int next;          // Towards the oldest end, -1 at the tail, also links the free nodes
+    bool prefetched;   // Loaded by read-ahead and not pinned yet
+} QueueNode;
+
+typedef struct PageQueue
+{
+    int head;          // Newest (MRU) node, -1 when empty
+    int tail;          // Oldest (LRU) node, -1 when empty
+    int size;
+} PageQueue;
+
+typedef struct QueuePolicy
+{
+    ReplacementStrategy strategy;  // RS_2Q or RS_ARC
+    int frames;                    // c, the number of frames of the pool
+    QueueNode *nodes;
+    int capacity;                  // Nodes for every resident page and the most ghosts kept
+    int freeNode;                  // First unused node, -1 when all are in use
+    int *index;                    // Open-addressing hash from page number to node, -1 marks an empty slot
+    int indexSize;                 // Number of slots, always a power of two
+    int indexBits;                 // log2(indexSize), used by the hash
+    PageQueue queues[QUEUE_COUNT];
+    int recentLimit;               // 2Q Kin, the recent queue gives up a page once it is larger
+    int ghostLimit;                // 2Q Kout, the most ghosts kept
+    int target;                    // ARC p, the adaptive target size of T1
+    PageNumber lastPage;           // Most recently pinned page, pinning it again is a correlated reference
+    PageFrame *freeCursor;         // Where the search for an empty frame continues
+} QueuePolicy;
+
+// Latencies of one kind of operation, bucket i counts those from 2^i up to 2^(i+1) nanoseconds
+#define BM_LATENCY_BUCKETS 32
+typedef struct BM_LatencyHistogram
+{
+    long long count;
+    long long totalNanos;
+    long long maxNanos;
+    long long buckets[BM_LATENCY_BUCKETS]; // The last bucket also holds everything longer
+} BM_LatencyHistogram;
+
+// Page-access trace of a pool, records are collected in memory and written out whenever the buffer is full
+#define BM_TRACE_BUFFERED 4096
+typedef struct BM_Trace
+{
+    FILE *file;
+    pthread_mutex_t latch;     // Pins of every shard append to the same buffer
+    unsigned long long records[BM_TRACE_BUFFERED];
+    int numRecords;
+    bool failed;               // A write of the buffer failed, stopPoolTrace reports it
+} BM_Trace;
+
 // Buffer manager structure that holds buffer pool information
 typedef struct BufferManager
 {
@@ -56,22 +204,164 @@ typedef struct BufferManager
     PageFrame *lastFrame;
     PageFrame *currentFramePtr;
     FrameStatistics *statsHead;
+    PageTableEntry *pageTable; // Resident pages, kept in sync on load and evict
+    int pageTableSize;         // Number of slots, always a power of two
+    int pageTableBits;         // log2(pageTableSize), used by the hash
+    long long readIOTime;      // Nanoseconds spent in page reads
+    long long writeIOTime;     // Nanoseconds spent in page writes
+    bool mappedIO;             // Frames point into a mapping of the page file instead of owning data
+    int pageSize;              // Bytes per frame, the page size of the pool's file
+    LRUKState *lruK;           // Reference histories, NULL unless the pool uses RS_LRU_K
+    QueuePolicy *queuePolicy;  // 2Q and ARC queues, NULL unless the pool uses one of them
+    LFUState *lfu;             // Frequency buckets, NULL unless the pool uses RS_LFU
+    struct BM_Shard *shards;   // Shards of a thread-safe pool, NULL for a single-threaded one
+    int numShards;
+    pthread_mutex_t fileLatch; // Serializes the flush histogram and the copies of the shards' I/O counters, not transfers
+    bool deferredIO;           // Shard of a thread-safe pool, pins leave the page transfer to the caller
+    PageFrame *pendingFrame;   // Frame the last deferred pin has to transfer
+    bool retryingPin;          // A deferred pin chooses again after a write or a wait, its miss was noted already
+    pthread_t cleaner;         // Background writer of the dirty pages next in line for eviction
+    bool cleanerActive;        // The background writer runs, set before the pool is handed out
+    bool stopCleaner;          // Set under cleanerLatch to end the background writer
+    pthread_mutex_t cleanerLatch;
+    pthread_cond_t cleanerWake; // Signaled to stop the background writer, or early when a pin met a dirty victim
+    double cleanFraction;      // Share of each shard's frames, in eviction order, the background writer keeps clean
+    int cleanIntervalMs;       // Pause of the background writer between two passes over the shards
+    PageFrame **prefetching;   // Frames with a prefetch read in flight, they stay fixed until it is finished
+    int numPrefetching;
+    FrameChunk *frameChunks;   // Allocations holding the frames, their statistics and page data
+    PageFrame **frameDirectory; // Every frame of the chunks by its frameIndex, grown with them
+    int directorySize;
+    PageFrame *spareFrames;    // Frames a shrink took out, linked through nextFrame, reused first when the pool grows
+    struct BM_SharedFile *sharedFiles; // Files of the process-wide pool, its keys carry the file, NULL in pools of one file
+    struct BM_SharedFile *sharedFile;  // Registration of the pool's file, whose pages the process-wide pool holds
+    long long pinHits;         // Pins that found their page resident, counted under the latch of the pool or shard
+    long long pinMisses;       // Pins that read their page
+    long long evictions;       // Pages that left their frame for another page or a shrink
+    long long dirtyEvictions;  // Of those, pages written back first, counted with the write operations
+    long long pinWaits;        // Pins that waited for a latch, a transfer or a prefetch, added up atomically in the pool
+    long long pinWaitNanos;
+    bool pinTiming;            // Pins are timed into the hit and miss histograms, set in the pool and every shard
+    BM_LatencyHistogram pinHitLatency;
+    BM_LatencyHistogram pinMissLatency;
+    BM_LatencyHistogram flushLatency; // forceFlushPool calls, kept by the pool and not its shards
+    BM_Trace *trace;           // Trace started by startPoolTrace, NULL while none is taken
+    char *warmFile;            // Where shutdown saves the resident pages for the next open, NULL without warmRestart
+    PageNumber *warmPages;     // Saved pages the warm loader of a thread-safe pool reads, in page number order
+    int numWarmPages;
+    pthread_t warmLoader;
+    bool warmLoading;          // The warm loader runs
+    bool stopWarmLoad;         // Set atomically to end the warm loader after its current batch
 } BufferManager;
 
 typedef struct BM_BufferPool {
 	char *pageFile;
 	int numPages;
 	ReplacementStrategy strategy;
-	SM_FileHandle fH;
+	SM_FileHandle fH; // open for the lifetime of the pool
 	void *mgmtData; // use this one to store the bookkeeping info your buffer
 	// manager needs for a buffer pool
 } BM_BufferPool;
 
+// Optional pool settings for initBufferPoolWithOptions, NULL means defaults
+typedef struct BM_PoolOptions {
+	bool mappedIO; // zero-copy pins straight from a memory mapping of the page file
+	bool directIO; // O_DIRECT transfers into aligned frames, pages are not cached twice
+	int shards; // above 0 the pool is thread-safe, its frames are split over this many independently latched shards
+	double cleanFraction; // above 0 a background thread writes dirty pages before they are evicted, so this share of
+	                      // the next victims stays clean; the pool is made thread-safe with one shard if shards is 0
+	int cleanIntervalMs; // pause of the background writer between passes, 0 means 10 ms
+	bool shared; // register the file with the process-wide pool of initSharedBufferPool, if one is running, instead of
+	             // building frames of its own; numPages and the other options are then ignored
+	int quota; // with shared, the most frames the file's pages may take at once, 0 for no limit
+	bool pinTiming; // time every pin into the latency histograms of getBufferPoolStats, two clock reads per pin
+	const char *traceFile; // start a trace into this file right away, as startPoolTrace
+	bool warmRestart; // shutdown saves the resident pages, hottest first, next to the file; the next open with it
+	                  // reads back as many as fit in the background, in page number order
+} BM_PoolOptions;
+
+// Traces of startPoolTrace start with the magic, then hold one 64-bit word per call in the byte order of the machine,
+// the page number shifted above the two bits of the operation
+#define BM_TRACE_MAGIC "BMTRACE1"
+typedef enum BM_TraceOp {
+	BM_TRACE_PIN = 0,
+	BM_TRACE_UNPIN = 1,
+	BM_TRACE_DIRTY = 2
+} BM_TraceOp;
+#define BM_TRACE_RECORD(op, pageNum) (((unsigned long long)(pageNum) << 2) | (unsigned long long)(op))
+#define BM_TRACE_OP(record) ((BM_TraceOp)((record) & 3))
+#define BM_TRACE_PAGE(record) ((PageNumber)((record) >> 2))
+
+// Counters of a pool since it was opened, filled in by getBufferPoolStats
+// Files of the process-wide pool report the whole pool, apart from the I/O of their own pages
+typedef struct BM_PoolStats {
+	long long hits; // pins that found their page resident
+	long long misses; // pins that had to read their page
+	double hitRatio; // hits over all pins, 0 before the first one
+	long long cleanEvictions; // pages replaced or dropped without a write
+	long long dirtyEvictions; // pages written back so their frame could be reused
+	long long pinWaits; // pins that waited for a latch, a transfer or a prefetch of their page
+	long long pinWaitNanos;
+	int readIO; // as getNumReadIO and the others
+	int writeIO;
+	long long readIOTime;
+	long long writeIOTime;
+	BM_LatencyHistogram pinHit; // empty unless the pool was opened with pinTiming
+	BM_LatencyHistogram pinMiss;
+	BM_LatencyHistogram flush; // forceFlushPool calls, shutdownBufferPool's included
+} BM_PoolStats;
+
+// Most files registered with the process-wide pool at once
+#define BM_SHARED_MAX_FILES 1024
+
+// A page file registered with the process-wide pool, which keys its pages by the file's slot and the page number
+typedef struct BM_SharedFile {
+	SM_FileHandle *fileHandle; // handle of the registered pool, every transfer of the file's pages goes through it
+	PageNumber keyBase; // slot of the file shifted above the bits of the page number
+	int quota; // most frames the file's pages may take at once, 0 for no limit
+	int resident; // frames holding the file's pages, counted by the page tables of all shards
+	int readOperations; // transfers of the file's pages, counted atomically
+	int writeOperations;
+	long long readIOTime;
+	long long writeIOTime;
+	bool inUse;
+} BM_SharedFile;
+
+// One part of a thread-safe pool, pages belong to a shard by a hash of their page number
+typedef struct BM_Shard {
+	pthread_mutex_t latch; // Guards the shard's frames, page table and replacement state
+	pthread_cond_t ioDone; // Broadcast whenever a transfer made without the latch has finished
+	BM_BufferPool pool; // The shard's frames under the pool's strategy, page transfers go through the pool's own handle
+} BM_Shard;
+
+// Latch a pin holds on the page's data until it is unpinned
+typedef enum BM_LatchMode {
+	BM_LATCH_NONE = 0, // pinPage, callers coordinate access to the data themselves
+	BM_LATCH_SHARED = 1, // readers, any number of them at once
+	BM_LATCH_EXCLUSIVE = 2 // a single writer, no readers
+} BM_LatchMode;
+
 typedef struct BM_PageHandle {
 	PageNumber pageNum;
 	char *data;
+	BM_LatchMode latch; // set by the pin, unpinPage releases the latch
+	int frame; // opaque reference to the frame of the last successful pin, unpinPage and markDirty use it
+	unsigned int generation; // instead of looking the page up while the frame still holds the pinned page
 } BM_PageHandle;
 
+// Frames a large sequential scan recycles, so the pages it brings in replace each other instead of the pool's
+typedef struct BM_ScanRing {
+	BM_BufferPool *pool;
+	int numFrames; // pages the scan brought in that stay resident behind it, older ones are dropped
+	PageNumber *loaded; // those pages, oldest at head, the list wraps around
+	int head;
+	int count;
+	PageNumber *prefetched; // pages prefetchRingPages brought in that the scan has not reached yet
+	int numPrefetched;
+	PageNumber current; // page the scan is on, NO_PAGE before its first pin
+	bool currentLoaded; // the current page was not resident before the scan asked for it
+} BM_ScanRing;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -83,8 +373,28 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC initBufferPoolWithOptions(BM_BufferPool *const bm, const char *const pageFileName,
+		const int numPages, ReplacementStrategy strategy,
+		void *stratData, const BM_PoolOptions *options);
 RC shutdownBufferPool(BM_BufferPool *const bm);
+// Process-wide pool that tables and indexes share, sized once; it only shuts down after every file left it
+RC initSharedBufferPool(const int numPages, ReplacementStrategy strategy, void *stratData,
+		const BM_PoolOptions *options);
+RC shutdownSharedBufferPool(void);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC readAheadPages(BM_BufferPool *const bm, const PageNumber firstPage, const int numPages);
+// Reads started by a prefetch are left in flight, a pin waits only for its own page and frames count as fixed until then
+RC prefetchPages(BM_BufferPool *const bm, const PageNumber firstPage, const int numPages);
+RC prefetchPageList(BM_BufferPool *const bm, const PageNumber *pageList, const int numPages);
+// Grows or shrinks an open pool, a shrink writes back and evicts unpinned pages and fails if too few frames are unpinned
+// For a file of the process-wide pool it sets the file's quota instead
+RC resizeBufferPool(BM_BufferPool *const bm, const int numPages);
+// Records every pinPage, unpinPage and markDirty that succeeds to a file, which sim_buffer_mgr replays against every
+// strategy; start and stop it while no other thread uses the pool, shutdownBufferPool stops it too
+RC startPoolTrace(BM_BufferPool *const bm, const char *fileName);
+RC stopPoolTrace(BM_BufferPool *const bm);
+// Removes the page list pools opened with warmRestart keep next to the file, for files that are destroyed
+RC discardWarmPages(const char *pageFileName);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page,const PageNumber pageNum);
@@ -92,6 +402,15 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page,const PageNumbe
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page,const PageNumber pageNum);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC pinPageLatched (BM_BufferPool *const bm, BM_PageHandle *const page,
+		const PageNumber pageNum, BM_LatchMode mode);
+
+// Sequential scans pin through a ring, pages that were resident before stay where the pool's strategy has them;
+// pages the scan brought in are dropped numFrames pages behind it unless they are pinned or dirty by then
+RC initScanRing (BM_BufferPool *const bm, BM_ScanRing *ring, const int numFrames);
+RC pinPageInRing (BM_ScanRing *ring, BM_PageHandle *const page, const PageNumber pageNum, BM_LatchMode mode);
+RC prefetchRingPages (BM_ScanRing *ring, const PageNumber firstPage, const int numPages);
+RC closeScanRing (BM_ScanRing *ring);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -99,5 +418,8 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+long long getReadIOTime (BM_BufferPool *const bm);
+long long getWriteIOTime (BM_BufferPool *const bm);
+RC getBufferPoolStats (BM_BufferPool *const bm, BM_PoolStats *stats);
 
 #endif
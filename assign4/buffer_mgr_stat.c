@@ -2,6 +2,7 @@
 #include "buffer_mgr.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 
 // Internal helper function to display the replacement strategy
 static void showReplacementStrategy(BM_BufferPool *const bufferPool);
@@ -16,6 +17,8 @@ static void showReplacementStrategy(BM_BufferPool *const bufferPool);
 #define RS_CLOCK 2
 #define RS_LFU 3
 #define RS_LRU_K 4
+#define RS_2Q 5
+#define RS_ARC 6
 
 void printPageStatus(PageNumber *framePages, bool *dirtyStatus, int *pinCounts, int numPages)
 {
@@ -28,10 +31,10 @@ void printPageStatus(PageNumber *framePages, bool *dirtyStatus, int *pinCounts,
         {
             const char *separator = (i == 0) ? "" : ", ";
             const char *dirtyChar = (dirtyStatus[i]) ? "x" : " ";
-            int currentPageFrame = framePages[i];
+            PageNumber currentPageFrame = framePages[i];
             int currentPinCount = pinCounts[i];
 
-            printf("%s[%i%s%i]", separator, currentPageFrame, dirtyChar, currentPinCount);
+            printf("%s[%lld%s%i]", separator, currentPageFrame, dirtyChar, currentPinCount);
             i++;
         } while (i < numPages);
     }
@@ -51,13 +54,13 @@ void constructPageStatus(char *bufferDetails, size_t bufferSize, PageNumber *fra
     do
     {
         const char *separator = (i == 0) ? "" : ",";
-        const int pageFrame = framePages[i];
+        const PageNumber pageFrame = framePages[i];
         const char *dirtyChar = (dirtyStatus[i]) ? "x" : " ";
         const int pinCount = pinCounts[i];
 
         offset += snprintf(bufferDetails + offset,
                            bufferSize - offset,
-                           "%s[%i%s%i]",
+                           "%s[%lld%s%i]",
                            separator,
                            pageFrame,
                            dirtyChar,
@@ -114,6 +117,137 @@ size_t formatPageData(char *buffer, size_t remainingSize, BM_PageHandle *const p
     }
 }
 
+long long latencyPercentile(const BM_LatencyHistogram *histogram, double percentile)
+{
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+
+    // The operation at the given rank, counted from the fastest bucket up
+    long long rank = (long long)(percentile * histogram->count + 0.999999);
+    rank = (rank < 1) ? 1 : rank;
+    long long seen = 0;
+    for (int i = 0; i < BM_LATENCY_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+        {
+            long long upper = (i < 62) ? (2LL << i) - 1 : histogram->maxNanos;
+            return (upper < histogram->maxNanos) ? upper : histogram->maxNanos;
+        }
+    }
+    return histogram->maxNanos;
+}
+
+// Appending to a string built by the stats formatters, they size their buffers generously up front
+void appendStats(char *buffer, size_t bufferSize, size_t *offset, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + *offset, bufferSize - *offset, format, args);
+    va_end(args);
+    if (written > 0)
+    {
+        *offset += ((size_t)written < bufferSize - *offset) ? (size_t)written : bufferSize - *offset - 1;
+    }
+}
+
+void formatLatencyText(char *buffer, size_t bufferSize, size_t *offset, const char *name, const BM_LatencyHistogram *histogram)
+{
+    long long mean = (histogram->count > 0) ? histogram->totalNanos / histogram->count : 0;
+    appendStats(buffer, bufferSize, offset, "%-10s %lld ops, mean %lld ns, p50 %lld ns, p99 %lld ns, max %lld ns\n",
+                name, histogram->count, mean, latencyPercentile(histogram, 0.5), latencyPercentile(histogram, 0.99),
+                histogram->maxNanos);
+}
+
+void formatLatencyJSON(char *buffer, size_t bufferSize, size_t *offset, const char *name, const BM_LatencyHistogram *histogram)
+{
+    appendStats(buffer, bufferSize, offset, ",\"%s\":{\"count\":%lld,\"total_ns\":%lld,\"max_ns\":%lld,\"p50_ns\":%lld,"
+                "\"p99_ns\":%lld,\"buckets\":[", name, histogram->count, histogram->totalNanos, histogram->maxNanos,
+                latencyPercentile(histogram, 0.5), latencyPercentile(histogram, 0.99));
+    for (int i = 0; i < BM_LATENCY_BUCKETS; i++)
+    {
+        appendStats(buffer, bufferSize, offset, "%s%lld", (i == 0) ? "" : ",", histogram->buckets[i]);
+    }
+    appendStats(buffer, bufferSize, offset, "]}");
+}
+
+void formatLatencyCSV(char *buffer, size_t bufferSize, size_t *offset, const char *name, const BM_LatencyHistogram *histogram,
+                      bool header)
+{
+    if (header)
+    {
+        appendStats(buffer, bufferSize, offset, ",%s_count,%s_mean_ns,%s_p50_ns,%s_p99_ns,%s_max_ns",
+                    name, name, name, name, name);
+        return;
+    }
+    long long mean = (histogram->count > 0) ? histogram->totalNanos / histogram->count : 0;
+    appendStats(buffer, bufferSize, offset, ",%lld,%lld,%lld,%lld,%lld", histogram->count, mean,
+                latencyPercentile(histogram, 0.5), latencyPercentile(histogram, 0.99), histogram->maxNanos);
+}
+
+// Formatting the counters in one of the layouts, CSV with or without its header line
+char *formatPoolStats(const BM_PoolStats *stats, BM_StatsFormat format, bool csvHeader)
+{
+    size_t bufferSize = 8192; // Three histograms of 32 buckets in JSON fit with room to spare
+    char *buffer = (char *)malloc(bufferSize);
+    if (!buffer)
+    {
+        return NULL; // Handle memory allocation failure
+    }
+    size_t offset = 0;
+    buffer[0] = '\0';
+
+    if (format == BM_STATS_JSON)
+    {
+        appendStats(buffer, bufferSize, &offset, "{\"hits\":%lld,\"misses\":%lld,\"hit_ratio\":%.6f,"
+                    "\"clean_evictions\":%lld,\"dirty_evictions\":%lld,\"pin_waits\":%lld,\"pin_wait_ns\":%lld,"
+                    "\"read_io\":%d,\"write_io\":%d,\"read_io_ns\":%lld,\"write_io_ns\":%lld",
+                    stats->hits, stats->misses, stats->hitRatio, stats->cleanEvictions, stats->dirtyEvictions,
+                    stats->pinWaits, stats->pinWaitNanos, stats->readIO, stats->writeIO, stats->readIOTime,
+                    stats->writeIOTime);
+        formatLatencyJSON(buffer, bufferSize, &offset, "pin_hit", &stats->pinHit);
+        formatLatencyJSON(buffer, bufferSize, &offset, "pin_miss", &stats->pinMiss);
+        formatLatencyJSON(buffer, bufferSize, &offset, "flush", &stats->flush);
+        appendStats(buffer, bufferSize, &offset, "}\n");
+    }
+    else if (format == BM_STATS_CSV)
+    {
+        if (csvHeader)
+        {
+            appendStats(buffer, bufferSize, &offset, "hits,misses,hit_ratio,clean_evictions,dirty_evictions,pin_waits,"
+                        "pin_wait_ns,read_io,write_io,read_io_ns,write_io_ns");
+            formatLatencyCSV(buffer, bufferSize, &offset, "pin_hit", &stats->pinHit, true);
+            formatLatencyCSV(buffer, bufferSize, &offset, "pin_miss", &stats->pinMiss, true);
+            formatLatencyCSV(buffer, bufferSize, &offset, "flush", &stats->flush, true);
+            appendStats(buffer, bufferSize, &offset, "\n");
+        }
+        appendStats(buffer, bufferSize, &offset, "%lld,%lld,%.6f,%lld,%lld,%lld,%lld,%d,%d,%lld,%lld",
+                    stats->hits, stats->misses, stats->hitRatio, stats->cleanEvictions, stats->dirtyEvictions,
+                    stats->pinWaits, stats->pinWaitNanos, stats->readIO, stats->writeIO, stats->readIOTime,
+                    stats->writeIOTime);
+        formatLatencyCSV(buffer, bufferSize, &offset, "pin_hit", &stats->pinHit, false);
+        formatLatencyCSV(buffer, bufferSize, &offset, "pin_miss", &stats->pinMiss, false);
+        formatLatencyCSV(buffer, bufferSize, &offset, "flush", &stats->flush, false);
+        appendStats(buffer, bufferSize, &offset, "\n");
+    }
+    else
+    {
+        appendStats(buffer, bufferSize, &offset, "pins       %lld hits, %lld misses, hit ratio %.2f%%\n",
+                    stats->hits, stats->misses, stats->hitRatio * 100);
+        appendStats(buffer, bufferSize, &offset, "evictions  %lld clean, %lld dirty\n",
+                    stats->cleanEvictions, stats->dirtyEvictions);
+        appendStats(buffer, bufferSize, &offset, "pin waits  %lld, %lld ns in total\n", stats->pinWaits, stats->pinWaitNanos);
+        appendStats(buffer, bufferSize, &offset, "I/O        %d reads in %lld ns, %d writes in %lld ns\n",
+                    stats->readIO, stats->readIOTime, stats->writeIO, stats->writeIOTime);
+        formatLatencyText(buffer, bufferSize, &offset, "pin hit", &stats->pinHit);
+        formatLatencyText(buffer, bufferSize, &offset, "pin miss", &stats->pinMiss);
+        formatLatencyText(buffer, bufferSize, &offset, "flush", &stats->flush);
+    }
+    return buffer;
+}
+
 /*
     // Main buffer manager stat functions
 */
@@ -163,7 +297,7 @@ char *sprintPoolContent(BM_BufferPool *const bufferPool)
 
 void printPageContent(BM_PageHandle *const pageHandle)
 {
-    printf("[Page Number: %i]\n", pageHandle->pageNum);
+    printf("[Page Number: %lld]\n", pageHandle->pageNum);
 
     // Check if page data is available
     if (PAGE_SIZE > 0)
@@ -188,7 +322,7 @@ char *sprintPageContent(BM_PageHandle *const pageHandle)
     }
 
     size_t offset = 0;
-    offset += snprintf(pageDetails + offset, bufferSize - offset, "[Page Number: %i]\n", pageHandle->pageNum);
+    offset += snprintf(pageDetails + offset, bufferSize - offset, "[Page Number: %lld]\n", pageHandle->pageNum);
 
     // Check if the page data is available
     if (PAGE_SIZE > 0)
@@ -203,6 +337,56 @@ char *sprintPageContent(BM_PageHandle *const pageHandle)
     return pageDetails; // Caller must free the memory
 }
 
+void printPoolStats(BM_BufferPool *const bufferPool)
+{
+    char *details = sprintPoolStats(bufferPool, BM_STATS_TEXT);
+    if (details != NULL)
+    {
+        printf("%s", details);
+        free(details);
+    }
+}
+
+char *sprintPoolStats(BM_BufferPool *const bufferPool, BM_StatsFormat format)
+{
+    BM_PoolStats stats;
+    if (getBufferPoolStats(bufferPool, &stats) != RC_OK)
+    {
+        return NULL; // Pool not open
+    }
+    return formatPoolStats(&stats, format, true); // Caller must free the memory
+}
+
+RC dumpPoolStats(BM_BufferPool *const bufferPool, const char *fileName, BM_StatsFormat format)
+{
+    BM_PoolStats stats;
+    RC result = getBufferPoolStats(bufferPool, &stats);
+    if (result != RC_OK)
+    {
+        return result;
+    }
+
+    FILE *file = fopen(fileName, "a");
+    if (file == NULL)
+    {
+        return RC_FILE_NOT_FOUND;
+    }
+    fseek(file, 0, SEEK_END);
+    char *details = formatPoolStats(&stats, format, ftell(file) == 0);
+    if (details == NULL)
+    {
+        fclose(file);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    result = (fputs(details, file) == EOF) ? RC_WRITE_FAILED : RC_OK;
+    free(details);
+    if (fclose(file) != 0)
+    {
+        result = RC_WRITE_FAILED;
+    }
+    return result;
+}
+
 void showReplacementStrategy(BM_BufferPool *const bufferPool)
 {
     // Array of strategy names
@@ -212,6 +396,8 @@ void showReplacementStrategy(BM_BufferPool *const bufferPool)
         "CLOCK Strategy",
         "LFU Strategy",
         "LRU-K Strategy",
+        "2Q Strategy",
+        "ARC Strategy",
         "Unknown Strategy"};
 
     // Get the strategy index
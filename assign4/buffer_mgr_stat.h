@@ -9,4 +9,18 @@ void printPageContent (BM_PageHandle *const page);
 char *sprintPoolContent (BM_BufferPool *const bm);
 char *sprintPageContent (BM_PageHandle *const page);
 
+// Layouts of the counters of getBufferPoolStats
+typedef enum BM_StatsFormat {
+	BM_STATS_TEXT = 0,
+	BM_STATS_JSON = 1, // one object, histograms with all their buckets
+	BM_STATS_CSV = 2 // a header line and one row, histograms as count, mean, p50, p99 and max
+} BM_StatsFormat;
+
+void printPoolStats (BM_BufferPool *const bm);
+char *sprintPoolStats (BM_BufferPool *const bm, BM_StatsFormat format);
+// Appends one JSON line or CSV row to the file, with the CSV header if the file is empty, for sampling a pool over time
+RC dumpPoolStats (BM_BufferPool *const bm, const char *fileName, BM_StatsFormat format);
+// Upper bound of the bucket the given share (0 to 1) of the operations falls into, at most the largest one seen
+long long latencyPercentile (const BM_LatencyHistogram *histogram, double percentile);
+
 #endif
@@ -6,6 +6,13 @@
 /* module wide constants */
 #define PAGE_SIZE 4096
 
+/* page sizes a page file can be created with, powers of two in between */
+#define MIN_PAGE_SIZE 4096
+#define MAX_PAGE_SIZE 65536
+
+/* page numbers are 64-bit so page files can grow past 2 GB */
+typedef long long PageNumber;
+
 /* return code definitions */
 typedef int RC;
 
@@ -14,6 +21,7 @@ typedef int RC;
 #define RC_FILE_HANDLE_NOT_INIT 2
 #define RC_WRITE_FAILED 3
 #define RC_READ_NON_EXISTING_PAGE 4
+#define RC_INVALID_PAGE_SIZE 5
 
 #define RC_READ_FAILED 100
 #define RC_SEEK_FAILED 101
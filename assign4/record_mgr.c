@@ -9,18 +9,24 @@
 
 RM_TableData *tableData = NULL;
 
+// Number of pages a sequential scan keeps in flight, starting with the page it reads
+#define SCAN_PREFETCH_PAGES 16
+
+// Pages a scan of a larger table keeps resident behind it, the pages it brings in beyond them replace each other
+#define SCAN_RING_FRAMES 32
+
 #include <stdio.h> // For printf
 
 #include <stdio.h> // For printf
 
 // Subfunction to print buffer pool information
-void printBufferPoolInfo(BM_BufferPool *bm, int pageNum)
+void printBufferPoolInfo(BM_BufferPool *bm, PageNumber pageNum)
 {
     printf("Buffer Pool (bm) info:\n");
     printf("  Page File: %s\n", bm->pageFile);            // Print the name of the page file
     printf("  Number of Pages: %d\n", bm->numPages);      // Print the number of pages
     printf("  Replacement Strategy: %d\n", bm->strategy); // Print the replacement strategy
-    printf("  pageNum: %d\n", pageNum);
+    printf("  pageNum: %lld\n", pageNum);
 }
 
 // Subfunction to update page data
@@ -51,10 +57,10 @@ void updatePageData(BM_PageHandle *page, Record *record, int slot, int offslot)
     }
 }
 
-// Subfunction to pin a page
-RC pinPageHelper(BM_BufferPool *bm, BM_PageHandle *page, int pageNum)
+// Subfunction to pin a page, latched shared for readers and exclusive for writers
+RC pinPageHelper(BM_BufferPool *bm, BM_PageHandle *page, PageNumber pageNum, BM_LatchMode mode)
 {
-    RC rc = pinPage(bm, page, pageNum);
+    RC rc = pinPageLatched(bm, page, pageNum, mode);
 
     switch (rc)
     {
@@ -67,24 +73,24 @@ RC pinPageHelper(BM_BufferPool *bm, BM_PageHandle *page, int pageNum)
     return RC_OK;
 }
 
-// Subfunction to unpin and force the page to disk
-RC unpinAndForcePage(BM_BufferPool *bm, BM_PageHandle *page, int pageNum)
+// Subfunction to force the page to disk and then unpin it
+RC unpinAndForcePage(BM_BufferPool *bm, BM_PageHandle *page, PageNumber pageNum)
 {
     RC rc;
 
-    // Unpin the page after modifications
-    rc = unpinPage(bm, page, pageNum);
-
+    // Force the page to disk while the exclusive latch still keeps other writers out
+    rc = forcePage(bm, page, pageNum);
     switch (rc)
     {
     case RC_OK:
         break;
     default:
+        unpinPage(bm, page, pageNum);
         return rc;
     }
 
-    // Force the page to disk
-    rc = forcePage(bm, page, pageNum);
+    // Unpin the page after modifications, which also releases its latch
+    rc = unpinPage(bm, page, pageNum);
     switch (rc)
     {
     case RC_OK:
@@ -145,9 +151,9 @@ RM_tableData_mgmtData *initializeTableMgm()
 }
 
 // Subfunction to create the page file and handle errors
-RC createPageFileAndCheck(char *name)
+RC createPageFileAndCheck(char *name, int pageSize)
 {
-    RC rc = createPageFile(name);
+    RC rc = createPageFileWithPageSize(name, pageSize);
     switch (rc)
     {
     case RC_OK:
@@ -170,7 +176,7 @@ RC doRecord(Record *record)
     }
 
     RC rc;
-    int pageNum;
+    PageNumber pageNum;
     int slot;
     BM_BufferPool *bm;
     BM_PageHandle *page;
@@ -225,8 +231,8 @@ RC doRecord(Record *record)
     }
     page->data = (char *)malloc(PAGE_SIZE);
 
-    // Pin the page
-    rc = pinPageHelper(bm, page, pageNum);
+    // Pin the page, exclusively latched while the slot is rewritten
+    rc = pinPageHelper(bm, page, pageNum, BM_LATCH_EXCLUSIVE);
     switch (rc)
     {
     case RC_OK:
@@ -245,6 +251,7 @@ RC doRecord(Record *record)
     case RC_OK:
         break;
     default:
+        unpinPage(bm, page, pageNum); // Do not leave the latch held
         return rc;
     }
 
@@ -345,7 +352,7 @@ RC writeFirstPageToDisk(BM_BufferPool *bm, RM_tableData_mgmtData *tableMgm, Sche
     {
     // Allocate memory for the first page
     case 1:
-        firstPage = (char *)malloc(PAGE_SIZE);
+        firstPage = (char *)malloc(bm->fH.pageSize);
         break;
     }
 
@@ -426,6 +433,12 @@ RC writeFirstPageToDisk(BM_BufferPool *bm, RM_tableData_mgmtData *tableMgm, Sche
 
 // Main createTable function
 RC createTable(char *name, Schema *schema)
+{
+    return createTableWithPageSize(name, schema, PAGE_SIZE);
+}
+
+// Main createTableWithPageSize function, large pages suit tables that are mostly scanned
+RC createTableWithPageSize(char *name, Schema *schema, int pageSize)
 {
     // Check for null parameters
     switch ((name == NULL) ? 1 : 0)
@@ -448,7 +461,7 @@ RC createTable(char *name, Schema *schema)
     RM_tableData_mgmtData *tableMgm = initializeTableMgm();
 
     // Create page file
-    RC rc = createPageFileAndCheck(name);
+    RC rc = createPageFileAndCheck(name, pageSize);
     switch (rc)
     {
     case RC_OK:
@@ -478,6 +491,16 @@ RC createTable(char *name, Schema *schema)
         return rc;
     }
 
+    // The buffer pool opens its own handle in openTable
+    rc = closePageFile(&bm->fH);
+    switch (rc)
+    {
+    case RC_OK:
+        break;
+    default:
+        return rc;
+    }
+
     // Finalize table management data
     tableMgm->bm = bm;
     tableData->name = name;
@@ -490,7 +513,10 @@ RC createTable(char *name, Schema *schema)
 // Subfunction to initialize the buffer pool for a table
 RC initializeBufferPool(RM_TableData *tableData, char *name)
 {
-    RC rc = initBufferPool(((RM_tableData_mgmtData *)tableData->mgmtData)->bm, name, 10000, RS_CLOCK, NULL);
+    // Tables keep their pages in the process-wide pool when one is running, pools of their own start warm
+    BM_PoolOptions options = { .shared = true, .warmRestart = true };
+    RC rc = initBufferPoolWithOptions(((RM_tableData_mgmtData *)tableData->mgmtData)->bm, name, 10000, RS_CLOCK, NULL,
+                                      &options);
     switch (rc)
     {
     case RC_OK:
@@ -599,7 +625,8 @@ RC deleteTable(char *name)
         return rc;
     }
 
-    return RC_OK;
+    // The pages its pool saved at closeTable are gone with it
+    return discardWarmPages(name);
 }
 
 // Main getNumTuples function
@@ -608,10 +635,25 @@ int getNumTuples(RM_TableData *rel)
     return ((RM_tableData_mgmtData *)tableData->mgmtData)->numRecords;
 }
 
-// Subfunction to calculate the number of records per page
+// Main resizeTableBuffer function, the table's pool grows or shrinks while the table stays open
+// A table of the process-wide pool gets numPages as its quota instead
+RC resizeTableBuffer(RM_TableData *rel, int numPages)
+{
+    switch ((rel == NULL || rel->mgmtData == NULL) ? 1 : 0)
+    {
+    case 1:
+        return RC_FILE_NOT_FOUND;
+    case 0:
+        break;
+    }
+
+    return resizeBufferPool(((RM_tableData_mgmtData *)rel->mgmtData)->bm, numPages);
+}
+
+// Subfunction to calculate the number of records per page, pages are as large as the table file was created with
 void calculateRecordsPerPage(RM_tableData_mgmtData *tableMgm, int offslot)
 {
-    tableMgm->numRecordsPerPage = PAGE_SIZE / offslot;
+    tableMgm->numRecordsPerPage = tableMgm->bm->fH.pageSize / offslot;
 }
 
 // Subfunction to update record management data
@@ -718,7 +760,7 @@ RC insertRecord(RM_TableData *rel, Record *record)
 }
 
 // Subfunction to mark the page as dirty
-RC markPageDirty(BM_BufferPool *bm, BM_PageHandle *page, int pageNum)
+RC markPageDirty(BM_BufferPool *bm, BM_PageHandle *page, PageNumber pageNum)
 {
     RC rc = markDirty(bm, page, pageNum);
     switch (rc)
@@ -751,7 +793,7 @@ RC deleteRecord(RM_TableData *rel, RID id)
         break;
     }
 
-    int pageNum;
+    PageNumber pageNum;
     int slot;
     RC rc;
     int offslot;
@@ -823,8 +865,8 @@ RC deleteRecord(RM_TableData *rel, RID id)
         break;
     }
 
-    // Pin the page using buffer manager
-    rc = pinPageHelper(bm, page, pageNum);
+    // Pin the page using buffer manager, exclusively latched while the slot is cleared
+    rc = pinPageHelper(bm, page, pageNum, BM_LATCH_EXCLUSIVE);
     switch (rc)
     {
     case RC_OK:
@@ -840,6 +882,7 @@ RC deleteRecord(RM_TableData *rel, RID id)
     case RC_OK:
         break;
     default:
+        unpinPage(bm, page, pageNum); // Do not leave the latch held
         return rc;
     }
 
@@ -853,6 +896,7 @@ RC deleteRecord(RM_TableData *rel, RID id)
     case RC_OK:
         break;
     default:
+        unpinPage(bm, page, pageNum); // Do not leave the latch held
         return rc;
     }
 
@@ -969,7 +1013,7 @@ RC validateGetRecordInput(RM_TableData *rel, Record *record)
 }
 
 // Subfunction to unpin the page
-RC unpinPageHelper(BM_BufferPool *bm, BM_PageHandle *page, int pageNum)
+RC unpinPageHelper(BM_BufferPool *bm, BM_PageHandle *page, PageNumber pageNum)
 {
     RC rc = unpinPage(bm, page, pageNum);
     switch (rc)
@@ -1010,8 +1054,8 @@ void copyDataToRecord(Record *record, BM_PageHandle *page, int slot, int offslot
     }
 }
 
-// Main getRecord function
-RC getRecord(RM_TableData *rel, RID id, Record *record)
+// Subfunction to read a record, through the frame ring of a scan if it has one
+RC readRecord(RM_TableData *rel, RID id, Record *record, BM_ScanRing *ring)
 {
     // Validate input parameters
     RC rc = validateGetRecordInput(rel, record);
@@ -1023,7 +1067,7 @@ RC getRecord(RM_TableData *rel, RID id, Record *record)
         return rc;
     }
 
-    int pageNum;
+    PageNumber pageNum;
     int slot;
     int offslot;
     RM_tableData_mgmtData *temp;
@@ -1086,8 +1130,9 @@ RC getRecord(RM_TableData *rel, RID id, Record *record)
         break;
     }
 
-    // Pin the page
-    rc = pinPageHelper(bm, page, pageNum);
+    // Pin the page, shared latched so writers wait until the record is copied
+    rc = (ring != NULL) ? pinPageInRing(ring, page, pageNum, BM_LATCH_SHARED)
+                        : pinPageHelper(bm, page, pageNum, BM_LATCH_SHARED);
     switch (rc)
     {
     case RC_OK:
@@ -1112,6 +1157,12 @@ RC getRecord(RM_TableData *rel, RID id, Record *record)
     return RC_OK;
 }
 
+// Main getRecord function
+RC getRecord(RM_TableData *rel, RID id, Record *record)
+{
+    return readRecord(rel, id, record, NULL);
+}
+
 // Subfunction to validate input parameters
 RC validateScanInput(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
 {
@@ -1162,6 +1213,28 @@ void initializeScanData(RM_ScanData_mgmtData *ScanMgm, Expr *cond)
 }
 
 
+// Subfunction to top up the pages a scan has in flight, at its start and each time it is through half of them
+// Pages already resident or in flight are skipped, so every call submits the next half window as one batch
+void prefetchForScan(RM_ScanData_mgmtData *ScanMgm, RM_tableData_mgmtData *tableMgm)
+{
+    int firstPage = ScanMgm->currentRID.page;
+    if (firstPage + SCAN_PREFETCH_PAGES / 2 < ScanMgm->prefetchEnd)
+    {
+        return; // More than half the window is still ahead of the scan
+    }
+
+    // Only a hint, errors show up on the pin
+    if (ScanMgm->ring != NULL)
+    {
+        prefetchRingPages(ScanMgm->ring, firstPage, SCAN_PREFETCH_PAGES);
+    }
+    else
+    {
+        prefetchPages(tableMgm->bm, firstPage, SCAN_PREFETCH_PAGES);
+    }
+    ScanMgm->prefetchEnd = firstPage + SCAN_PREFETCH_PAGES;
+}
+
 // Main startScan function
 RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
 {
@@ -1179,6 +1252,23 @@ RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond)
     RM_ScanData_mgmtData *ScanMgm = (RM_ScanData_mgmtData *)malloc(sizeof(RM_ScanData_mgmtData));
     initializeScanData(ScanMgm, cond);
 
+    // Tables larger than the ring are scanned through it, so the scan does not push everything else out of the pool
+    RM_tableData_mgmtData *tableMgm = (RM_tableData_mgmtData *)rel->mgmtData;
+    ScanMgm->ring = NULL;
+    if (tableMgm->numPages > SCAN_RING_FRAMES)
+    {
+        ScanMgm->ring = (BM_ScanRing *)malloc(sizeof(BM_ScanRing));
+        if (initScanRing(tableMgm->bm, ScanMgm->ring, SCAN_RING_FRAMES) != RC_OK)
+        {
+            free(ScanMgm->ring);
+            ScanMgm->ring = NULL; // Scans work without a ring, only less kindly to the pool
+        }
+    }
+
+    // The first pages are read while the caller gets ready for next(), however few the table has
+    ScanMgm->prefetchEnd = ScanMgm->currentRID.page;
+    prefetchForScan(ScanMgm, tableMgm);
+
     // Assign scan management data and relation to the scan handle
     scan->mgmtData = ScanMgm;
     scan->rel = rel;
@@ -1215,7 +1305,7 @@ RC checkIfNoMoreTuples(RM_ScanData_mgmtData *ScanMgm, RM_tableData_mgmtData *tab
 // Subfunction to fetch the current record
 RC fetchCurrentRecord(RM_TableData *tableData, RM_ScanData_mgmtData *ScanMgm, Record *record)
 {
-    RC rc = getRecord(tableData, ScanMgm->currentRID, record);
+    RC rc = readRecord(tableData, ScanMgm->currentRID, record, ScanMgm->ring);
     switch (rc)
     {
     case RC_OK:
@@ -1287,7 +1377,8 @@ RC next(RM_ScanHandle *scan, Record *record)
             return rc;
         }
 
-        // Fetch the current record
+        // Fetch the current record while the upcoming pages are read in the background
+        prefetchForScan(ScanMgm, tableMgm);
         rc = fetchCurrentRecord(tableData, ScanMgm, record);
         switch (rc)
         {
@@ -1337,6 +1428,12 @@ RC validateScanHandle(RM_ScanHandle *scan)
 // Subfunction to free scan management data
 void freeScanMgmtData(RM_ScanHandle *scan)
 {
+    RM_ScanData_mgmtData *ScanMgm = (RM_ScanData_mgmtData *)scan->mgmtData;
+    if (ScanMgm != NULL && ScanMgm->ring != NULL)
+    {
+        closeScanRing(ScanMgm->ring);
+        free(ScanMgm->ring);
+    }
     free(scan->mgmtData);
     scan->mgmtData = NULL;
 }
@@ -24,16 +24,20 @@ typedef struct RM_ScanData_mgmtData{
     int totalScan;//number of tuple be scanned
     RID currentRID;//the RID of the tuple that scanned now
     Expr *cond;    //select condition of the record
+    BM_ScanRing *ring;//frames the scan recycles, NULL for tables small enough to stay resident
+    int prefetchEnd;//first page after the ones the scan has asked to prefetch
 }RM_ScanData_mgmtData;
 
 // table and manager
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithPageSize (char *name, Schema *schema, int pageSize);
 extern RC openTable (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
 extern int getNumTuples (RM_TableData *rel);
+extern RC resizeTableBuffer (RM_TableData *rel, int numPages);
 
 // handling records in a table
 extern RC insertRecord (RM_TableData *rel, Record *record);
@@ -0,0 +1,255 @@
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_FILE "simbuffer.bin"
+
+// replacement strategies a trace is replayed against
+typedef struct SimStrategy {
+  const char *name;
+  ReplacementStrategy strategy;
+  void *stratData;
+} SimStrategy;
+
+// outcome of one replay
+typedef struct SimResult {
+  double hitRatio;
+  long long writeBacks;
+  long long failedPins;
+} SimResult;
+
+// simulator methods
+static RC loadTrace (const char *fileName, unsigned long long **records, long long *numRecords);
+static RC createSimFile (PageNumber maxPage);
+static RC replayTrace (const unsigned long long *records, long long numRecords, PageNumber maxPage,
+                       SimStrategy *strategy, int numFrames, SimResult *result);
+static int defaultPoolSizes (long long distinctPages, int *sizes, int maxSizes);
+
+#define MAX_POOL_SIZES 32
+
+// main method, replays the trace of startPoolTrace given as the first argument against every strategy, for the pool
+// sizes given after it or powers of two up to the number of distinct pages in the trace
+int
+main (int argc, char **argv)
+{
+  int k = 2;
+  SimStrategy strategies[] = {
+    { "FIFO", RS_FIFO, NULL },
+    { "LRU", RS_LRU, NULL },
+    { "CLOCK", RS_CLOCK, NULL },
+    { "LFU", RS_LFU, NULL },
+    { "LRU-2", RS_LRU_K, &k },
+    { "2Q", RS_2Q, NULL },
+    { "ARC", RS_ARC, NULL },
+  };
+  int numStrategies = sizeof(strategies) / sizeof(strategies[0]);
+  unsigned long long *records;
+  long long numRecords, counts[3] = { 0, 0, 0 }, distinctPages = 0, i;
+  PageNumber maxPage = 0;
+  int sizes[MAX_POOL_SIZES], numSizes = 0;
+  SimResult *results;
+  char *seen;
+  int s, f;
+
+  if (argc < 2)
+    {
+      fprintf(stderr, "usage: %s trace [frames ...]\n", argv[0]);
+      return 1;
+    }
+  initStorageManager();
+  if (loadTrace(argv[1], &records, &numRecords) != RC_OK)
+    {
+      fprintf(stderr, "%s is not a buffer pool trace\n", argv[1]);
+      return 1;
+    }
+
+  // what the trace holds
+  for (i = 0; i < numRecords; i++)
+    {
+      counts[BM_TRACE_OP(records[i])]++;
+      if (BM_TRACE_PAGE(records[i]) > maxPage)
+        maxPage = BM_TRACE_PAGE(records[i]);
+    }
+  seen = calloc(maxPage + 1, 1);
+  for (i = 0; i < numRecords; i++)
+    if (!seen[BM_TRACE_PAGE(records[i])])
+      {
+        seen[BM_TRACE_PAGE(records[i])] = 1;
+        distinctPages++;
+      }
+  free(seen);
+  printf("%lld pins, %lld unpins, %lld markDirty calls over %lld distinct pages\n",
+         counts[BM_TRACE_PIN], counts[BM_TRACE_UNPIN], counts[BM_TRACE_DIRTY], distinctPages);
+
+  for (s = 2; s < argc && numSizes < MAX_POOL_SIZES; s++)
+    if (atoi(argv[s]) > 0)
+      sizes[numSizes++] = atoi(argv[s]);
+  if (numSizes == 0)
+    numSizes = defaultPoolSizes(distinctPages, sizes, MAX_POOL_SIZES);
+
+  // every strategy at every size against the same scratch file
+  if (createSimFile(maxPage) != RC_OK)
+    {
+      fprintf(stderr, "cannot create %s\n", SIM_FILE);
+      return 1;
+    }
+  results = malloc(sizeof(SimResult) * numSizes * numStrategies);
+  for (f = 0; f < numStrategies; f++)
+    for (s = 0; s < numSizes; s++)
+      if (replayTrace(records, numRecords, maxPage, &strategies[f], sizes[s], &results[s * numStrategies + f]) != RC_OK)
+        {
+          fprintf(stderr, "replay with %s and %d frames failed\n", strategies[f].name, sizes[s]);
+          return 1;
+        }
+  destroyPageFile(SIM_FILE);
+
+  // sizes where every frame was pinned at some point are marked, their pins that failed are left out
+  printf("\nhit ratio\n%8s", "frames");
+  for (f = 0; f < numStrategies; f++)
+    printf(" %9s", strategies[f].name);
+  for (s = 0; s < numSizes; s++)
+    {
+      printf("\n%8d", sizes[s]);
+      for (f = 0; f < numStrategies; f++)
+        {
+          SimResult *result = &results[s * numStrategies + f];
+          printf(" %8.2f%%%s", 100 * result->hitRatio, (result->failedPins > 0) ? "*" : " ");
+        }
+    }
+
+  printf("\n\ndirty pages written back to make room\n%8s", "frames");
+  for (f = 0; f < numStrategies; f++)
+    printf(" %9s", strategies[f].name);
+  for (s = 0; s < numSizes; s++)
+    {
+      printf("\n%8d", sizes[s]);
+      for (f = 0; f < numStrategies; f++)
+        printf(" %9lld", results[s * numStrategies + f].writeBacks);
+    }
+  printf("\n");
+  for (i = 0; i < (long long) numSizes * numStrategies; i++)
+    if (results[i].failedPins > 0)
+      {
+        printf("* some pins found every frame pinned\n");
+        break;
+      }
+
+  free(results);
+  free(records);
+  return 0;
+}
+
+// reading every record of a trace into memory
+RC
+loadTrace (const char *fileName, unsigned long long **records, long long *numRecords)
+{
+  FILE *file = fopen(fileName, "rb");
+  char magic[8];
+  long bytes;
+
+  if (file == NULL)
+    return RC_FILE_NOT_FOUND;
+  if (fread(magic, 1, 8, file) != 8 || memcmp(magic, BM_TRACE_MAGIC, 8) != 0)
+    {
+      fclose(file);
+      return RC_FILE_HANDLE_NOT_INIT;
+    }
+  fseek(file, 0, SEEK_END);
+  bytes = ftell(file) - 8;
+  fseek(file, 8, SEEK_SET);
+
+  *numRecords = bytes / sizeof(unsigned long long);
+  *records = malloc(sizeof(unsigned long long) * (*numRecords > 0 ? *numRecords : 1));
+  if ((long long) fread(*records, sizeof(unsigned long long), *numRecords, file) != *numRecords)
+    {
+      free(*records);
+      fclose(file);
+      return RC_READ_NON_EXISTING_PAGE;
+    }
+  fclose(file);
+  return RC_OK;
+}
+
+// a page file holding every page of the trace, so no replay spends time growing it
+RC
+createSimFile (PageNumber maxPage)
+{
+  SM_FileHandle fh;
+  RC result = createPageFile(SIM_FILE);
+
+  if (result == RC_OK)
+    result = openPageFile(SIM_FILE, &fh);
+  if (result == RC_OK)
+    {
+      result = ensureCapacity(maxPage + 1, &fh);
+      closePageFile(&fh);
+    }
+  return result;
+}
+
+// replaying the calls of a trace on a pool of the strategy and size, pins that fail are skipped with their unpins
+RC
+replayTrace (const unsigned long long *records, long long numRecords, PageNumber maxPage,
+             SimStrategy *strategy, int numFrames, SimResult *result)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle h;
+  BM_PoolStats stats;
+  int *failed = calloc(maxPage + 1, sizeof(int));
+  long long i;
+  RC rc = initBufferPool(bm, SIM_FILE, numFrames, strategy->strategy, strategy->stratData);
+
+  result->failedPins = 0;
+  for (i = 0; rc == RC_OK && i < numRecords; i++)
+    {
+      PageNumber pageNum = BM_TRACE_PAGE(records[i]);
+      switch (BM_TRACE_OP(records[i]))
+        {
+        case BM_TRACE_PIN:
+          if (pinPage(bm, &h, pageNum) != RC_OK)
+            {
+              failed[pageNum]++;
+              result->failedPins++;
+            }
+          break;
+        case BM_TRACE_UNPIN:
+          if (failed[pageNum] > 0)
+            failed[pageNum]--;
+          else
+            unpinPage(bm, &h, pageNum); // a trace started on an open pool may unpin pages pinned before it
+          break;
+        default:
+          markDirty(bm, &h, pageNum);
+          break;
+        }
+    }
+
+  if (rc == RC_OK)
+    {
+      // write-backs of the final flush are the same for every strategy, so they are counted before it
+      getBufferPoolStats(bm, &stats);
+      result->hitRatio = stats.hitRatio;
+      result->writeBacks = stats.dirtyEvictions;
+      rc = shutdownBufferPool(bm);
+    }
+  free(failed);
+  free(bm);
+  return rc;
+}
+
+// powers of two from 4 frames up, and the number of distinct pages, where only the first pin of a page misses
+int
+defaultPoolSizes (long long distinctPages, int *sizes, int maxSizes)
+{
+  int numSizes = 0;
+  long long size;
+
+  for (size = 4; size < distinctPages && numSizes < maxSizes - 1; size *= 2)
+    sizes[numSizes++] = (int) size;
+  sizes[numSizes++] = (distinctPages > 0) ? (int) distinctPages : 1;
+  return numSizes;
+}
@@ -1,28 +1,165 @@
+// O_DIRECT is a GNU extension on Linux
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "storage_mgr.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/types.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+
+// Windows has no positional I/O, emulate it with a seek on the descriptor
+static long long pread(int fd, void *buf, size_t count, long long offset)
+{
+    if (_lseeki64(fd, offset, SEEK_SET) < 0)
+    {
+        return -1;
+    }
+    return _read(fd, buf, (unsigned int)count);
+}
+
+static long long pwrite(int fd, const void *buf, size_t count, long long offset)
+{
+    if (_lseeki64(fd, offset, SEEK_SET) < 0)
+    {
+        return -1;
+    }
+    return _write(fd, buf, (unsigned int)count);
+}
+#define OPEN_FLAGS (O_RDWR | O_BINARY)
+#include <malloc.h>
+#define alignedAlloc(size) _aligned_malloc(size, DIRECT_IO_ALIGN)
+#define alignedFree(ptr) _aligned_free(ptr)
+#include <sys/stat.h>
+#define CREATE_MODE (_S_IREAD | _S_IWRITE)
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#define OPEN_FLAGS O_RDWR
+#define CREATE_MODE 0644
+#define alignedFree(ptr) free(ptr)
+#endif
+
+// Alignment of buffers, offsets and lengths for direct I/O, and the size of the header page
+#define DIRECT_IO_ALIGN 4096
+#define HEADER_PAGE_SIZE 4096
+
+// First bytes of a page file with a header page, legacy files start with the page count as text
+#define PAGE_FILE_MAGIC "SMPGFILE"
+#define PAGE_FILE_VERSION 1
+
+// Layout of the header page, the rest of the page is zero
+typedef struct SM_FileHeader
+{
+    char magic[8];
+    int version;
+    int pageSize;
+    long long totalNumPages;
+    long long segmentPages; // pages per segment file, 0 when the whole file is one segment
+} SM_FileHeader;
+
+// Address space reserved for a mapped page file and the step its mapping grows by
+#define MAP_RESERVE_BYTES (1LL << 36)
+#define MAP_GROW_BYTES (1LL << 20)
+
+// io_uring is used through its raw system calls, so only the kernel header is needed
+#if defined(__linux__) && defined(__has_include) && !defined(SM_NO_IO_URING)
+#if __has_include(<linux/io_uring.h>)
+#define SM_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <stdint.h>
+#include <errno.h>
+#endif
+#endif
+
+// Pages a file grows by when it runs out of preallocated space, 1 MB with 4 KB pages
+#define DEFAULT_EXTENT_PAGES 256
+
+// Submission queue depth of a page file's io_uring
+#define IO_RING_ENTRIES 64
+
+// Tears down a handle's io_uring, defined with the asynchronous batch functions
+void releaseIORing(SM_FileInfo *fileInfo);
+
+// Deletes the segment files behind a page file, defined with the segment helpers
+void removeSegmentFiles(const char *fileName);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+// Sub-function to allocate memory on a direct I/O boundary
+void *alignedAlloc(size_t size)
+{
+    void *ptr = NULL;
+    if (posix_memalign(&ptr, DIRECT_IO_ALIGN, size) != 0)
+    {
+        return NULL;
+    }
+    return ptr;
+}
+#endif
 
-SM_PageHandle allocateAndInitializePage()
+SM_PageHandle allocateAndInitializePage(int pageSize)
 {
-    SM_PageHandle page = malloc(PAGE_SIZE);
+    SM_PageHandle page = alignedAlloc(pageSize);
     if (page != NULL)
     {
-        memset(page, '\0', PAGE_SIZE);
+        memset(page, '\0', pageSize);
     }
     return page;
 }
 
-// Function to write the metadata (total pages) and the page to the file
-RC writePageToFile(FILE *file, SM_PageHandle page)
+SM_PageHandle allocatePageBuffer(int pageSize)
 {
-    if (fprintf(file, "%d\n", 1) < 0)
+    return allocateAndInitializePage(pageSize); // Zeroed and aligned, usable for direct transfers
+}
+
+// Sub-function to check a page size, a power of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE so pages stay aligned for direct I/O
+bool isValidPageSize(int pageSize)
+{
+    return pageSize >= MIN_PAGE_SIZE && pageSize <= MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+void freePageBuffer(SM_PageHandle page)
+{
+    alignedFree(page);
+}
+
+// Sub-function to fill a header page for a file of totalPages pages
+void fillHeaderPage(char *headerPage, int pageSize, long long totalPages, long long segmentPages)
+{
+    SM_FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PAGE_FILE_MAGIC, sizeof(header.magic));
+    header.version = PAGE_FILE_VERSION;
+    header.pageSize = pageSize;
+    header.totalNumPages = totalPages;
+    header.segmentPages = segmentPages;
+
+    memset(headerPage, '\0', HEADER_PAGE_SIZE);
+    memcpy(headerPage, &header, sizeof(header));
+}
+
+// Function to write the header page (total pages) and the page to the file
+RC writePageToFile(FILE *file, SM_PageHandle page, int pageSize, long long segmentPages)
+{
+    char headerPage[HEADER_PAGE_SIZE];
+    fillHeaderPage(headerPage, pageSize, 1, segmentPages);
+
+    if (fwrite(headerPage, sizeof(char), HEADER_PAGE_SIZE, file) < HEADER_PAGE_SIZE)
     {
         return RC_WRITE_FAILED;
     }
 
-    if (fwrite(page, sizeof(char), PAGE_SIZE, file) < PAGE_SIZE)
+    if (fwrite(page, sizeof(char), pageSize, file) < (size_t)pageSize)
     {
         return RC_WRITE_FAILED;
     }
@@ -31,21 +168,62 @@ RC writePageToFile(FILE *file, SM_PageHandle page)
 }
 
 // Sub-function to open a file in read-write mode
-FILE *openFileForReadWrite(const char *fileName)
+int openFileForReadWrite(const char *fileName)
 {
-    FILE *file = fopen(fileName, "r+"); // Opening file in read-write mode
-    if (file == NULL)
+    int fd = open(fileName, OPEN_FLAGS); // Opening the raw descriptor in read-write mode
+    if (fd < 0)
     {
         printf("Error: Could not open file %s\n", fileName);
     }
-    return file;
+    return fd;
+}
+
+// Size of the text header of legacy page files, made compatible with Windows like macOS and Linux
+int pageOffet()
+{
+    int code;
+
+#if defined(_WIN32) || defined(_WIN64)
+    code = 3;
+#else
+    code = 5;
+#endif
+
+    return code;
 }
 
-// Sub-function to read total number of pages from the file
-int readTotalPages(FILE *file)
+// Sub-function to read total number of pages from the file and find where page 0 starts
+PageNumber readTotalPages(int fd, SM_FileInfo *fileInfo)
 {
-    int total_pages;
-    fscanf(file, "%d\n", &total_pages); // Reading the first line as total pages
+    char header[sizeof(SM_FileHeader)] = {0};
+    PageNumber total_pages = 0;
+
+    fileInfo->segmentPages = 0;
+    fileInfo->pageSize = PAGE_SIZE;
+    if (pread(fd, header, sizeof(header), 0) <= 0)
+    {
+        fileInfo->headerSize = HEADER_PAGE_SIZE;
+        return 0;
+    }
+
+    // Current files keep their metadata in a whole header page
+    if (memcmp(header, PAGE_FILE_MAGIC, 8) == 0)
+    {
+        SM_FileHeader fileHeader;
+        memcpy(&fileHeader, header, sizeof(fileHeader));
+        fileInfo->headerSize = HEADER_PAGE_SIZE;
+        fileInfo->segmentPages = fileHeader.segmentPages;
+        if (isValidPageSize(fileHeader.pageSize))
+        {
+            fileInfo->pageSize = fileHeader.pageSize;
+        }
+        return fileHeader.totalNumPages;
+    }
+
+    // Legacy files start with the page count as a line of text, stored in front of page 0
+    header[pageOffet()] = '\0';
+    sscanf(header, "%lld", &total_pages);
+    fileInfo->headerSize = pageOffet();
     return total_pages;
 }
 
@@ -54,7 +232,7 @@ void setFileName(SM_FileHandle *fHandle, char *fileName)
     fHandle->fileName = fileName; // Set the file name in the file handle
 }
 
-void setTotalNumPages(SM_FileHandle *fHandle, int totalPages)
+void setTotalNumPages(SM_FileHandle *fHandle, PageNumber totalPages)
 {
     fHandle->totalNumPages = totalPages; // Set the total number of pages
 }
@@ -64,23 +242,76 @@ void setCurrentPagePosition(SM_FileHandle *fHandle)
     fHandle->curPagePos = 0; // Initialize the current page position to 0
 }
 
-void setManagementInfo(SM_FileHandle *fHandle, FILE *pFile)
+void setManagementInfo(SM_FileHandle *fHandle, SM_FileInfo *fileInfo)
 {
-    fHandle->mgmtInfo = pFile; // Store the file descriptor in the file handle
+    fHandle->mgmtInfo = fileInfo; // Store the file descriptor in the file handle
 }
 
-void initializeFileHandle(SM_FileHandle *fHandle, char *fileName, int totalPages, FILE *pFile)
+void initializeFileHandle(SM_FileHandle *fHandle, char *fileName, PageNumber totalPages, SM_FileInfo *fileInfo)
 {
     setFileName(fHandle, fileName);
     setTotalNumPages(fHandle, totalPages);
     setCurrentPagePosition(fHandle);
-    setManagementInfo(fHandle, pFile);
+    setManagementInfo(fHandle, fileInfo);
+    fHandle->pageSize = fileInfo->pageSize;
+}
+
+// Sub-function to set up the latch of a handle, recursive because batches finish short transfers through readBlock
+void initHandleLatch(SM_FileInfo *fileInfo)
+{
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&fileInfo->latch, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}
+
+// Sub-function to read the page count of a handle, it grows under the handle latch while other threads check pages
+PageNumber pageCount(SM_FileHandle *fHandle)
+{
+    return __atomic_load_n(&fHandle->totalNumPages, __ATOMIC_ACQUIRE);
+}
+
+// Sub-function to remember the page a transfer ended on, threads sharing a handle may overwrite each other's
+void notePagePosition(SM_FileHandle *fHandle, PageNumber pageNum)
+{
+    __atomic_store_n(&fHandle->curPagePos, pageNum, __ATOMIC_RELAXED);
+}
+
+// Sub-function to reach the descriptor behind a file handle
+int fileDescriptor(SM_FileHandle *fHandle)
+{
+    return ((SM_FileInfo *)fHandle->mgmtInfo)->fd;
 }
 
 // Sub-function to close the file handle
-int closeFileHandle(FILE *file)
+int closeFileHandle(SM_FileInfo *fileInfo)
 {
-    return fclose(file); // fclose returns 0 on success, non-zero on failure
+    if (fileInfo == NULL)
+    {
+        return -1;
+    }
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (fileInfo->map != NULL)
+    {
+        munmap(fileInfo->map, fileInfo->mapReserve); // Drop the mapping and its reservation
+    }
+#endif
+    releaseIORing(fileInfo);
+    for (int i = 1; i < fileInfo->numSegmentFds; i++)
+    {
+        if (fileInfo->segmentFds[i] >= 0)
+        {
+            close(fileInfo->segmentFds[i]);
+        }
+    }
+    free(fileInfo->segmentFds);
+    free(fileInfo->segmentBase);
+    int fail = close(fileInfo->fd); // close returns 0 on success, -1 on failure
+    alignedFree(fileInfo->bounce);
+    pthread_mutex_destroy(&fileInfo->latch);
+    free(fileInfo);
+    return fail;
 }
 
 // Sub-function to clean up the SM_FileHandle structure
@@ -110,179 +341,590 @@ int removeFile(const char *fileName)
     return compatibleWithWindows(remove(fileName)); // remove returns 0 on success, -1 on error
 }
 
+// Sub-function to count the whole pages the file already has room for
+long long allocatedPagesOnDisk(int fd, long long headerSize, int pageSize)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    long long size = _filelengthi64(fd);
+#else
+    struct stat st;
+    long long size = (fstat(fd, &st) == 0) ? (long long)st.st_size : 0;
+#endif
+    return (size > headerSize) ? (size - headerSize) / pageSize : 0;
+}
+
 /*
  // Functions based on Page
 */
 
-// Main function to create the page file
-RC createPageFile(char *fileName)
+// Sub-function to create a page file with one empty page, its page size and segment size go into the header page
+RC createPageFileWithLayout(char *fileName, int pageSize, PageNumber segmentPages)
 {
-    FILE *pFile = fopen(fileName, "w");
+    if (!isValidPageSize(pageSize))
+    {
+        return RC_INVALID_PAGE_SIZE;
+    }
+    if (segmentPages < 0)
+    {
+        return RC_WRITE_FAILED;
+    }
+
+    // Segments of a file previously stored under this name would show through as stale pages
+    removeSegmentFiles(fileName);
+
+    FILE *pFile = fopen(fileName, "wb");
     if (pFile == NULL)
     {
         return RC_FILE_NOT_FOUND;
     }
 
-    SM_PageHandle page = allocateAndInitializePage();
+    SM_PageHandle page = allocateAndInitializePage(pageSize);
     if (page == NULL)
     {
         fclose(pFile);
         return RC_WRITE_FAILED;
     }
 
-    RC result = writePageToFile(pFile, page);
+    RC result = writePageToFile(pFile, page, pageSize, segmentPages);
     fclose(pFile);
 
-    free(page);
+    alignedFree(page);
     return result;
 }
 
+// Main function to create the page file
+RC createPageFile(char *fileName)
+{
+    return createPageFileWithLayout(fileName, PAGE_SIZE, 0);
+}
+
+RC createPageFileWithPageSize(char *fileName, int pageSize)
+{
+    return createPageFileWithLayout(fileName, pageSize, 0);
+}
+
+RC createSegmentedPageFile(char *fileName, PageNumber segmentPages)
+{
+    return createPageFileWithLayout(fileName, PAGE_SIZE, segmentPages);
+}
+
 RC openPageFile(char *fileName, SM_FileHandle *fHandle)
 {
-    FILE *pFile = openFileForReadWrite(fileName);
+    int fd = openFileForReadWrite(fileName);
 
     // If the file is not found, return error; else proceed to initialize the handle
-    if (pFile == NULL)
+    if (fd < 0)
     {
         return RC_FILE_NOT_FOUND;
     }
-    else
+
+    SM_FileInfo *fileInfo = malloc(sizeof(SM_FileInfo));
+    if (fileInfo == NULL)
     {
-        // Read total number of pages and initialize the file handle
-        int total_pages = readTotalPages(pFile);
-        initializeFileHandle(fHandle, fileName, total_pages, pFile);
-        return RC_OK;
+        close(fd);
+        return RC_MEMORY_ALLOCATION_ERROR;
+    }
+    fileInfo->fd = fd;
+    fileInfo->map = NULL;
+    fileInfo->mapLength = 0;
+    fileInfo->mapReserve = 0;
+    fileInfo->ioRing = NULL;
+    fileInfo->ioRingUnavailable = 0;
+    fileInfo->directIO = 0;
+    fileInfo->bounce = NULL;
+    fileInfo->extentPages = DEFAULT_EXTENT_PAGES;
+    fileInfo->headerDirty = 0;
+    fileInfo->segmentFds = NULL;
+    fileInfo->numSegmentFds = 0;
+    fileInfo->segmentBase = NULL;
+    initHandleLatch(fileInfo);
+
+    // Read total number of pages and initialize the file handle
+    PageNumber total_pages = readTotalPages(fd, fileInfo);
+    fileInfo->allocatedPages = allocatedPagesOnDisk(fd, fileInfo->headerSize, fileInfo->pageSize);
+    fileInfo->freshFrom = total_pages;
+    if (fileInfo->segmentPages > 0)
+    {
+        // Only the main file was measured, space in the other segments is reserved again as needed
+        fileInfo->allocatedPages = total_pages;
+        fileInfo->segmentBase = strdup(fileName);
+        if (fileInfo->segmentBase == NULL)
+        {
+            close(fd);
+            pthread_mutex_destroy(&fileInfo->latch);
+            free(fileInfo);
+            return RC_MEMORY_ALLOCATION_ERROR;
+        }
     }
+    initializeFileHandle(fHandle, fileName, total_pages, fileInfo);
+    return RC_OK;
 }
 
-RC closePageFile(SM_FileHandle *fHandle)
+/*
+    // Helper functions for segmented page files
+*/
+
+// Sub-function to compute the offset of a page in the file or segment holding it, in 64 bits so large files do not overflow
+long long pageFileOffset(SM_FileHandle *fHandle, PageNumber pageNum)
 {
-    int fail = closeFileHandle(fHandle->mgmtInfo);
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (fileInfo->segmentPages > 0 && pageNum >= fileInfo->segmentPages)
+    {
+        return (pageNum % fileInfo->segmentPages) * fHandle->pageSize; // Only the main file has a header page
+    }
+    return fileInfo->headerSize + pageNum * fHandle->pageSize;
+}
 
-    switch (fail)
+// Sub-function to count the pages from pageNum to the end of its segment
+PageNumber pagesLeftInSegment(SM_FileHandle *fHandle, PageNumber pageNum)
+{
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (fileInfo->segmentPages == 0)
     {
-    case 0:
-        cleanFileHandle(fHandle);
-        return RC_OK;
-        break;
+        return LLONG_MAX; // Unsegmented files never end
+    }
+    return fileInfo->segmentPages - pageNum % fileInfo->segmentPages;
+}
 
-    default:
-        return RC_FILE_HANDLE_NOT_INIT;
-        break;
+// Sub-function to build the name of a segment file, segment 0 is the page file itself
+void segmentFileName(char *name, size_t size, const char *fileName, long long segment)
+{
+    snprintf(name, size, "%s.%lld", fileName, segment);
+}
+
+// Sub-function to open a segment file, creating it on first use
+int openSegmentFile(SM_FileInfo *fileInfo, long long segment)
+{
+    size_t size = strlen(fileInfo->segmentBase) + 24;
+    char *name = malloc(size);
+    if (name == NULL)
+    {
+        return -1;
+    }
+    segmentFileName(name, size, fileInfo->segmentBase, segment);
+
+    int flags = OPEN_FLAGS | O_CREAT;
+#if defined(O_DIRECT)
+    if (fileInfo->directIO)
+    {
+        flags |= O_DIRECT; // Segments of a direct file bypass the page cache too
     }
+#endif
+    int fd = open(name, flags, CREATE_MODE);
+    free(name);
+    return fd;
 }
 
-RC destroyPageFile(char *fileName)
+// Sub-function to find the descriptor of the file holding a page, -1 when its segment cannot be opened
+int pageDescriptor(SM_FileHandle *fHandle, PageNumber pageNum)
 {
-    int fail = removeFile(fileName);
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (fileInfo->segmentPages == 0 || pageNum < fileInfo->segmentPages)
+    {
+        return fileInfo->fd;
+    }
 
-    switch (fail)
+    long long segment = pageNum / fileInfo->segmentPages;
+    pthread_mutex_lock(&fileInfo->latch);
+    if (segment >= fileInfo->numSegmentFds)
     {
-    case 0:
-        return RC_OK;
-        break;
+        // Grow the table of open segments, unopened ones are -1
+        int count = (int)segment * 2;
+        int *fds = realloc(fileInfo->segmentFds, sizeof(int) * count);
+        if (fds == NULL)
+        {
+            pthread_mutex_unlock(&fileInfo->latch);
+            return -1;
+        }
+        for (int i = fileInfo->numSegmentFds; i < count; i++)
+        {
+            fds[i] = -1;
+        }
+        fileInfo->segmentFds = fds;
+        fileInfo->numSegmentFds = count;
+    }
+    if (fileInfo->segmentFds[segment] < 0)
+    {
+        fileInfo->segmentFds[segment] = openSegmentFile(fileInfo, segment);
+    }
+    int fd = fileInfo->segmentFds[segment];
+    pthread_mutex_unlock(&fileInfo->latch);
+    return fd;
+}
 
-    default:
-        return RC_FILE_NOT_FOUND;
-        break;
+// Sub-function to delete the segment files behind a page file, found through its header
+void removeSegmentFiles(const char *fileName)
+{
+    int fd = open(fileName, OPEN_FLAGS);
+    if (fd < 0)
+    {
+        return; // No file, no segments
+    }
+    SM_FileInfo probe;
+    readTotalPages(fd, &probe);
+    close(fd);
+    if (probe.segmentPages == 0)
+    {
+        return;
+    }
+
+    // Segments are created in order as the file grows, the first missing one ends the list
+    size_t size = strlen(fileName) + 24;
+    char *name = malloc(size);
+    for (long long segment = 1; name != NULL; segment++)
+    {
+        segmentFileName(name, size, fileName, segment);
+        if (remove(name) != 0)
+        {
+            break;
+        }
     }
+    free(name);
 }
 
 /*
-    //   Helper Functions based on reading the data from pages on disc
+    // Helper functions for memory-mapped page files
 */
 
-// Sub-function to check if the page number is valid
-bool isInvalidPageNumber(int pageNum, int totalNumPages)
+// Sub-function to check if a handle serves its pages from a mapping
+bool isMapped(SM_FileHandle *fHandle)
 {
-    return pageNum > totalNumPages || pageNum < 0;
+    return fHandle->mgmtInfo != NULL && ((SM_FileInfo *)fHandle->mgmtInfo)->map != NULL;
 }
 
-// Sub-function to check if the file is initialized
-bool isFileNotInitialized(FILE *file)
+// Sub-function to make the mapping cover the first numPages pages, growing it in large steps
+bool mapCoverPages(SM_FileHandle *fHandle, PageNumber numPages)
 {
-    return file == NULL;
+#if defined(_WIN32) || defined(_WIN64)
+    return false;
+#else
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    long long needed = pageFileOffset(fHandle, numPages);
+
+    if (needed <= fileInfo->mapLength)
+    {
+        return true; // Already mapped
+    }
+
+    // Grow to at least double the current length, in whole steps, within the reservation
+    long long length = fileInfo->mapLength * 2;
+    if (length < needed)
+    {
+        length = needed;
+    }
+    length = (length + MAP_GROW_BYTES - 1) / MAP_GROW_BYTES * MAP_GROW_BYTES;
+    if (length > fileInfo->mapReserve)
+    {
+        length = fileInfo->mapReserve;
+    }
+    if (length < needed)
+    {
+        return false; // File outgrew the reserved address space
+    }
+
+    // Pages of a mapping past the end of the file cannot be touched, so extend the file first
+    struct stat st;
+    if (fstat(fileInfo->fd, &st) != 0)
+    {
+        return false;
+    }
+    if (st.st_size < length && ftruncate(fileInfo->fd, length) != 0)
+    {
+        return false;
+    }
+
+    // Remap in place, so pointers already handed out stay valid
+    void *map = mmap(fileInfo->map, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fileInfo->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+    fileInfo->mapLength = length;
+    return true;
+#endif
 }
 
-// Make this project compatible with Windows OS, just like it is with macOS and Linux OS.
-int pageOffet()
+// Sub-function to reserve address space and map the pages the file already has
+bool setupMapping(SM_FileHandle *fHandle)
 {
-    int code;
-
 #if defined(_WIN32) || defined(_WIN64)
-    code = 3;
+    return false;
 #else
-    code = 5;
-#endif
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (fileInfo->segmentPages > 0)
+    {
+        return false; // One mapping cannot span several segment files
+    }
+    void *reserve = mmap(NULL, MAP_RESERVE_BYTES, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserve == MAP_FAILED)
+    {
+        return false;
+    }
+    fileInfo->map = reserve;
+    fileInfo->mapReserve = MAP_RESERVE_BYTES;
 
-    return code;
+    if (!mapCoverPages(fHandle, fHandle->totalNumPages + 1))
+    {
+        munmap(reserve, MAP_RESERVE_BYTES);
+        fileInfo->map = NULL;
+        fileInfo->mapReserve = 0;
+        return false;
+    }
+    return true;
+#endif
 }
 
-// Sub-function to seek to the specified page
-void seekToPage(int pageNum, SM_FileHandle *fHandle)
+RC openPageFileMapped(char *fileName, SM_FileHandle *fHandle)
 {
-    fseek(fHandle->mgmtInfo, pageOffet() + pageNum * PAGE_SIZE, SEEK_SET); // Seek to the correct page
-}
+    RC result = openPageFile(fileName, fHandle);
+    if (result != RC_OK)
+    {
+        return result;
+    }
 
-// Sub-function to read the page content into memory
-void readPageIntoMemory(SM_PageHandle memPage, SM_FileHandle *fHandle)
-{
-    fread(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo); // Read the page into memory
+    // Without mmap support the handle keeps using positional reads and writes
+    setupMapping(fHandle);
+    return RC_OK;
 }
 
 /*
-    //  Functions based on reading the data from pages on disc
+    // Helper functions for page files opened for direct I/O
 */
 
-RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+// Sub-function to check if a transfer has to go through the bounce page to satisfy direct I/O
+bool needsBounce(SM_FileHandle *fHandle, const char *memPage)
 {
-    // Check if pageNum is valid, otherwise return an error
-    if (isInvalidPageNumber(pageNum, fHandle->totalNumPages))
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    return fileInfo->directIO && ((size_t)memPage % DIRECT_IO_ALIGN) != 0;
+}
+
+// Sub-function to switch an open descriptor to direct I/O, false when the platform or file system refuses
+bool enableDirectIO(SM_FileInfo *fileInfo)
+{
+#if defined(O_DIRECT) && defined(F_SETFL)
+    // Legacy headers leave every page misaligned
+    if (fileInfo->headerSize % DIRECT_IO_ALIGN != 0)
     {
-        return RC_READ_NON_EXISTING_PAGE;
+        return false;
     }
-    else if (isFileNotInitialized(fHandle->mgmtInfo))
+    fileInfo->bounce = allocateAndInitializePage(fileInfo->pageSize);
+    if (fileInfo->bounce == NULL)
     {
-        return RC_FILE_NOT_FOUND;
+        return false;
     }
-    else
+    int flags = fcntl(fileInfo->fd, F_GETFL);
+    if (flags < 0 || fcntl(fileInfo->fd, F_SETFL, flags | O_DIRECT) != 0)
     {
-        // Seek to the page and read the block
-        seekToPage(pageNum, fHandle);
-        readPageIntoMemory(memPage, fHandle);
-        fHandle->curPagePos = pageNum; // Update the current page position
-        return RC_OK;
+        alignedFree(fileInfo->bounce);
+        fileInfo->bounce = NULL;
+        return false;
     }
+    fileInfo->directIO = 1;
+    return true;
+#else
+    return false;
+#endif
 }
 
-int getBlockPos(SM_FileHandle *fHandle) {
-    int blockPosition = -1; // Initialize to an invalid position
-    int attempts = 0;       // To keep track of attempts
-
-    do {
-        blockPosition = fHandle->curPagePos; // Get the current page position
-        attempts++;
-    } while (attempts < 1); // Allow only one attempt
+RC openPageFileDirect(char *fileName, SM_FileHandle *fHandle)
+{
+    RC result = openPageFile(fileName, fHandle);
+    if (result != RC_OK)
+    {
+        return result;
+    }
 
-    return blockPosition; // Return the current page position
+    // Without O_DIRECT support the handle keeps going through the page cache
+    enableDirectIO(fHandle->mgmtInfo);
+    return RC_OK;
 }
 
-RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
-    RC returnValue;
-    int attempts = 0; // To keep track of the number of attempts
-
-    do {
-        returnValue = readBlock(0, fHandle, memPage); // Attempt to read the first block
-        attempts++;
-    } while (returnValue != RC_OK && attempts < 1); // Only allows one attempt in this case
-
+RC closePageFile(SM_FileHandle *fHandle)
+{
+    // The page count is only written lazily, so it has to reach the header before the file is closed
+    if (fHandle->mgmtInfo != NULL && flushPageFileHeader(fHandle) != RC_OK)
+    {
+        closeFileHandle(fHandle->mgmtInfo);
+        cleanFileHandle(fHandle);
+        return RC_WRITE_FAILED;
+    }
+    int fail = closeFileHandle(fHandle->mgmtInfo);
+
+    switch (fail)
+    {
+    case 0:
+        cleanFileHandle(fHandle);
+        return RC_OK;
+        break;
+
+    default:
+        return RC_FILE_HANDLE_NOT_INIT;
+        break;
+    }
+}
+
+RC destroyPageFile(char *fileName)
+{
+    removeSegmentFiles(fileName);
+    int fail = removeFile(fileName);
+
+    switch (fail)
+    {
+    case 0:
+        return RC_OK;
+        break;
+
+    default:
+        return RC_FILE_NOT_FOUND;
+        break;
+    }
+}
+
+/*
+    //   Helper Functions based on reading the data from pages on disc
+*/
+
+// Sub-function to check if the page number is valid
+bool isInvalidPageNumber(PageNumber pageNum, PageNumber totalNumPages)
+{
+    return pageNum > totalNumPages || pageNum < 0;
+}
+
+// Sub-function to check if the file is initialized
+bool isFileNotInitialized(void *fileInfo)
+{
+    return fileInfo == NULL;
+}
+
+// Sub-function to read up to length bytes at a file offset with positional reads, -1 on a read error
+long long readAtOffset(int fd, char *data, size_t length, long long offset)
+{
+    size_t done = 0;
+
+    while (done < length)
+    {
+        long long n = pread(fd, data + done, length - done, offset + done);
+        if (n < 0)
+        {
+            return -1; // Read error
+        }
+        if (n == 0)
+        {
+            break; // End of file, the rest was never written
+        }
+        done += n;
+    }
+    return (long long)done;
+}
+
+// Sub-function to read the page content into memory with a single positional read
+// The handle latch covers the bookkeeping, the read itself runs without it unless it goes through the bounce page
+bool readPageIntoMemory(PageNumber pageNum, SM_PageHandle memPage, SM_FileHandle *fHandle)
+{
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    pthread_mutex_lock(&fileInfo->latch);
+    if (isMapped(fHandle))
+    {
+        // Mapped files are copied straight out of the mapping, no system call
+        bool covered = mapCoverPages(fHandle, pageNum + 1);
+        pthread_mutex_unlock(&fileInfo->latch);
+        if (!covered)
+        {
+            return false;
+        }
+        memcpy(memPage, fileInfo->map + pageFileOffset(fHandle, pageNum), fHandle->pageSize);
+        return true;
+    }
+
+    // Pages added since the file was opened and never written are known to be zero
+    if (pageNum >= fileInfo->freshFrom)
+    {
+        pthread_mutex_unlock(&fileInfo->latch);
+        memset(memPage, '\0', fHandle->pageSize);
+        return true;
+    }
+
+    // Direct reads need an aligned buffer, unaligned callers get a copy of the bounce page
+    bool bounced = needsBounce(fHandle, memPage);
+    if (!bounced)
+    {
+        pthread_mutex_unlock(&fileInfo->latch);
+    }
+    char *target = bounced ? fileInfo->bounce : memPage;
+    int fd = pageDescriptor(fHandle, pageNum);
+    size_t pageSize = fHandle->pageSize;
+    long long done = (fd < 0) ? -1 : readAtOffset(fd, target, pageSize, pageFileOffset(fHandle, pageNum));
+
+    if (done >= 0)
+    {
+        memset(target + done, '\0', pageSize - done); // Unwritten bytes read as zeros
+        if (target != memPage)
+        {
+            memcpy(memPage, target, pageSize);
+        }
+    }
+    if (bounced)
+    {
+        pthread_mutex_unlock(&fileInfo->latch);
+    }
+    return done >= 0; // A segment that cannot be opened fails like a read error
+}
+
+/*
+    //  Functions based on reading the data from pages on disc
+*/
+
+RC readBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+{
+    // Check if pageNum is valid, otherwise return an error
+    if (isInvalidPageNumber(pageNum, pageCount(fHandle)))
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    else if (isFileNotInitialized(fHandle->mgmtInfo))
+    {
+        return RC_FILE_NOT_FOUND;
+    }
+    else
+    {
+        // Read the block at its offset, no seek and no stdio buffer in between
+        if (!readPageIntoMemory(pageNum, memPage, fHandle))
+        {
+            return RC_READ_FAILED;
+        }
+        notePagePosition(fHandle, pageNum); // Update the current page position
+        return RC_OK;
+    }
+}
+
+PageNumber getBlockPos(SM_FileHandle *fHandle) {
+    PageNumber blockPosition = -1; // Initialize to an invalid position
+    int attempts = 0;       // To keep track of attempts
+
+    do {
+        blockPosition = fHandle->curPagePos; // Get the current page position
+        attempts++;
+    } while (attempts < 1); // Allow only one attempt
+
+    return blockPosition; // Return the current page position
+}
+
+RC readFirstBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
+    RC returnValue;
+    int attempts = 0; // To keep track of the number of attempts
+
+    do {
+        returnValue = readBlock(0, fHandle, memPage); // Attempt to read the first block
+        attempts++;
+    } while (returnValue != RC_OK && attempts < 1); // Only allows one attempt in this case
+
     return returnValue; // Return the result of the read operation
 }
 
 RC readPreviousBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     // Get the previous page position
-    int prevPos = fHandle->curPagePos - 1;
+    PageNumber prevPos = fHandle->curPagePos - 1;
     if (prevPos < 0)
     {
         return RC_READ_NON_EXISTING_PAGE; // Ensure we do not go below 0
@@ -305,7 +947,7 @@ RC readCurrentBlock(SM_FileHandle *fHandle, SM_PageHandle memPage) {
 RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     // Get the next page position
-    int nextPos = fHandle->curPagePos + 1;
+    PageNumber nextPos = fHandle->curPagePos + 1;
     if (nextPos >= fHandle->totalNumPages)
     {
         return RC_READ_NON_EXISTING_PAGE; // Ensure we do not exceed total pages
@@ -313,10 +955,35 @@ RC readNextBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
     return readBlock(nextPos, fHandle, memPage); // Read the next block
 }
 
+RC getBlockPointer(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle *memPage)
+{
+    // Only mapped handles can lend out pages without copying them
+    if (isFileNotInitialized(fHandle->mgmtInfo) || !isMapped(fHandle))
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (isInvalidPageNumber(pageNum, pageCount(fHandle)))
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    pthread_mutex_lock(&fileInfo->latch);
+    bool covered = mapCoverPages(fHandle, pageNum + 1);
+    pthread_mutex_unlock(&fileInfo->latch);
+    if (!covered)
+    {
+        return RC_READ_FAILED;
+    }
+
+    *memPage = fileInfo->map + pageFileOffset(fHandle, pageNum);
+    notePagePosition(fHandle, pageNum); // Update the current page position
+    return RC_OK;
+}
+
 RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     // Read the last block (totalNumPages - 1)
-    int lastPos = fHandle->totalNumPages - 1;
+    PageNumber lastPos = fHandle->totalNumPages - 1;
     if (lastPos < 0)
     {
         return RC_READ_NON_EXISTING_PAGE; // Handle case when there are no pages
@@ -329,15 +996,26 @@ RC readLastBlock(SM_FileHandle *fHandle, SM_PageHandle memPage)
 */
 
 // Sub-function to check if the page number is valid
-bool isValidPageNum(int pageNum, SM_FileHandle *fHandle)
+bool isValidPageNum(PageNumber pageNum, SM_FileHandle *fHandle)
 {
-    return (pageNum >= 0 && pageNum <= fHandle->totalNumPages); // Check for valid page range
+    return (pageNum >= 0 && pageNum <= pageCount(fHandle)); // Check for valid page range
 }
 
-// Sub-function to set the file position
-bool setFilePosition(SM_FileHandle *fHandle, int pageNum)
+// Sub-function to write a buffer at a file offset with positional writes
+bool writeAtOffset(int fd, const char *data, size_t length, long long offset)
 {
-    return (fseek(fHandle->mgmtInfo, pageOffet() + pageNum * PAGE_SIZE, SEEK_SET) == 0); // Return true if fseek is successful
+    size_t done = 0;
+
+    while (done < length)
+    {
+        long long n = pwrite(fd, data + done, length - done, offset + done);
+        if (n <= 0)
+        {
+            return false; // Write error
+        }
+        done += n;
+    }
+    return true;
 }
 
 // Sub-function to check if the file handle is initialized
@@ -347,81 +1025,226 @@ bool isFileHandleInitialized(SM_FileHandle *fHandle)
 }
 
 // Sub-function to allocate an empty page filled with zero bytes
-SM_PageHandle allocateEmptyPage()
+SM_PageHandle allocateEmptyPage(int pageSize)
 {
-    return (SM_PageHandle)calloc(PAGE_SIZE, 1); // Allocate and initialize a page
+    return allocateAndInitializePage(pageSize); // Allocate and initialize an aligned page
 }
 
-// Sub-function to update the file handle after appending a new block
-void updateFileHandleForNewBlock(SM_FileHandle *fHandle)
+// Sub-function to update the file handle after appending new blocks, the header is written lazily
+// Called under the handle latch, like every change of the page count
+void updateFileHandleForNewBlock(SM_FileHandle *fHandle, PageNumber numberOfPages)
 {
-    fHandle->curPagePos = fHandle->totalNumPages; // Set current page position to the new block
-    fHandle->totalNumPages += 1;                  // Increment total number of pages
+    notePagePosition(fHandle, numberOfPages - 1);                              // Set current page position to the last new block
+    __atomic_store_n(&fHandle->totalNumPages, numberOfPages, __ATOMIC_RELEASE); // Raise the total number of pages
+    ((SM_FileInfo *)fHandle->mgmtInfo)->headerDirty = 1;
 }
 
-// Sub-function to update the total pages in the file
-bool updateTotalPagesInFile(SM_FileHandle *fHandle)
+// Sub-function to grow the logical page count when a write lands on the page right after the last one, under the handle latch
+void notePagesWritten(SM_FileHandle *fHandle, PageNumber lastPage)
 {
-    rewind(fHandle->mgmtInfo); // Reset file pointer to the beginning
-    if (fprintf(fHandle->mgmtInfo, "%d\n", fHandle->totalNumPages) < 0)
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (lastPage >= fileInfo->freshFrom)
     {
-        return false; // Return false if writing fails
+        fileInfo->freshFrom = lastPage + 1; // Written pages have to be read from the file again
+    }
+    if (lastPage >= fHandle->totalNumPages)
+    {
+        __atomic_store_n(&fHandle->totalNumPages, lastPage + 1, __ATOMIC_RELEASE);
+        fileInfo->headerDirty = 1;
+        if (fileInfo->allocatedPages < lastPage + 1)
+        {
+            fileInfo->allocatedPages = lastPage + 1;
+        }
     }
-    fseek(fHandle->mgmtInfo, pageOffet() + (fHandle->curPagePos) * PAGE_SIZE, SEEK_SET); // Recover file pointer
-    return true;                                                                         // Success
 }
 
-RC appendSingleEmptyBlock(SM_FileHandle *fHandle)
+// Sub-function to reserve length bytes of a file from offset on
+bool reserveFileRange(int fd, long long offset, long long length)
 {
-    // Attempt to append a single empty block and return the result
-    return appendEmptyBlock(fHandle);
+#if defined(_WIN32) || defined(_WIN64)
+    return _chsize_s(fd, offset + length) == 0;
+#else
+#if defined(__linux__)
+    if (fallocate(fd, 0, offset, length) == 0)
+    {
+        return true; // Real extents, new pages read as zeros
+    }
+#endif
+    // No fallocate on this file system or platform, a sparse extension still keeps the size right
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        return false;
+    }
+    return st.st_size >= offset + length || ftruncate(fd, offset + length) == 0;
+#endif
 }
 
-RC appendRequiredEmptyBlocks(int pagesToAppend, SM_FileHandle *fHandle)
+// Sub-function to reserve disk space for at least numberOfPages pages, a whole extent at a time
+bool preallocatePages(SM_FileHandle *fHandle, long long numberOfPages)
 {
-    RC return_value;
-    int i = 0;
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (numberOfPages <= fileInfo->allocatedPages)
+    {
+        return true; // Room already reserved
+    }
 
-    if (pagesToAppend <= 0)
+    // Round up to whole extents so bulk loads touch the file system once per extent
+    long long extent = fileInfo->extentPages;
+    long long target = (numberOfPages + extent - 1) / extent * extent;
+    if (target - numberOfPages >= pagesLeftInSegment(fHandle, numberOfPages - 1))
     {
-        return RC_OK; // No pages to append, return success
+        target = numberOfPages - 1 + pagesLeftInSegment(fHandle, numberOfPages - 1); // Never create a segment ahead of its first page
     }
 
-    do
+    // Reserve the new pages segment by segment, unsegmented files are a single piece
+    PageNumber page = fileInfo->allocatedPages;
+    while (page < target)
     {
-        return_value = appendSingleEmptyBlock(fHandle); // Append a single empty block
-        if (return_value != RC_OK)
+        PageNumber count = pagesLeftInSegment(fHandle, page);
+        if (count > target - page)
+        {
+            count = target - page;
+        }
+        int fd = pageDescriptor(fHandle, page);
+        if (fd < 0 || !reserveFileRange(fd, pageFileOffset(fHandle, page), count * fHandle->pageSize))
         {
-            return return_value; // Return error if appending fails
+            return false;
         }
-        i++;
-    } while (i < pagesToAppend); // Continue until the required number of pages is appended
+        page += count;
+    }
+    fileInfo->allocatedPages = target;
+    return true;
+}
 
-    return RC_OK; // Successfully appended all required blocks
+// Sub-function to make a range of pages past the logical end read as zeros, they may hold stale data
+bool zeroStalePages(SM_FileHandle *fHandle, PageNumber firstPage, PageNumber lastPage)
+{
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (fileInfo->headerSize != HEADER_PAGE_SIZE)
+    {
+        // Legacy files were never preallocated, the bytes behind their last page are whatever was there before
+        SM_PageHandle empty = allocateEmptyPage(fHandle->pageSize);
+        if (empty == NULL)
+        {
+            return false;
+        }
+        bool written = true;
+        for (PageNumber page = firstPage; page <= lastPage && written; page++)
+        {
+            written = writeAtOffset(fileInfo->fd, empty, fHandle->pageSize, pageFileOffset(fHandle, page));
+        }
+        alignedFree(empty);
+        return written;
+    }
+    return true; // Pages of a current file past its end only come from zero-filled extents
 }
 
-RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
+// Sub-function to grow the file to numberOfPages pages without writing them
+RC growToPages(PageNumber numberOfPages, SM_FileHandle *fHandle)
+{
+    PageNumber firstNewPage = fHandle->totalNumPages;
+    if (!preallocatePages(fHandle, numberOfPages))
+    {
+        return RC_WRITE_FAILED;
+    }
+    if (!zeroStalePages(fHandle, firstNewPage, numberOfPages - 1))
+    {
+        return RC_WRITE_FAILED;
+    }
+    updateFileHandleForNewBlock(fHandle, numberOfPages);
+    return RC_OK;
+}
+
+// Sub-function to update the total pages in the file
+bool updateTotalPagesInFile(SM_FileHandle *fHandle)
+{
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (fileInfo->headerSize == HEADER_PAGE_SIZE)
+    {
+        // The header page is rewritten whole, so direct I/O sees an aligned transfer
+        char *headerPage = alignedAlloc(HEADER_PAGE_SIZE);
+        if (headerPage == NULL)
+        {
+            return false;
+        }
+        fillHeaderPage(headerPage, fHandle->pageSize, fHandle->totalNumPages, fileInfo->segmentPages);
+        bool written = writeAtOffset(fileInfo->fd, headerPage, HEADER_PAGE_SIZE, 0);
+        alignedFree(headerPage);
+        return written;
+    }
+
+    char header[16];
+
+#if defined(_WIN32) || defined(_WIN64)
+    int length = snprintf(header, sizeof(header), "%lld\r\n", fHandle->totalNumPages);
+#else
+    int length = snprintf(header, sizeof(header), "%lld\n", fHandle->totalNumPages);
+#endif
+
+    return writeAtOffset(fileDescriptor(fHandle), header, length, 0); // Legacy header line sits at offset 0
+}
+
+RC writeBlock(PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
     if (!isValidPageNum(pageNum, fHandle))
     {
         return RC_WRITE_FAILED; // Return error if page number is invalid
     }
-    // Attempt to set the file position
-    if (!setFilePosition(fHandle, pageNum))
+    if (!isFileHandleInitialized(fHandle))
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (isMapped(fHandle))
     {
-        return RC_WRITE_FAILED; // Return error if fseek fails
+        // Mapped files are written by copying into the mapping, pages lent out by getBlockPointer need no copy
+        pthread_mutex_lock(&fileInfo->latch);
+        bool covered = mapCoverPages(fHandle, pageNum + 1);
+        pthread_mutex_unlock(&fileInfo->latch);
+        if (!covered)
+        {
+            return RC_WRITE_FAILED;
+        }
+        char *target = fileInfo->map + pageFileOffset(fHandle, pageNum);
+        if (target != memPage)
+        {
+            memmove(target, memPage, fHandle->pageSize);
+        }
     }
-    // Write the page to the file
-    size_t bytesWritten = fwrite(memPage, sizeof(char), PAGE_SIZE, fHandle->mgmtInfo);
-    if (bytesWritten < PAGE_SIZE)
+    else
     {
-        return RC_WRITE_FAILED; // Return error if not all bytes were written
+        // Direct writes need an aligned buffer, unaligned callers are copied to the bounce page first
+        // The bounce page is shared, so such writes hold the handle latch until they are done
+        char *source = memPage;
+        bool bounced = needsBounce(fHandle, memPage);
+        if (bounced)
+        {
+            pthread_mutex_lock(&fileInfo->latch);
+            source = fileInfo->bounce;
+            memcpy(source, memPage, fHandle->pageSize);
+        }
+
+        // Write the page at its offset with a single positional write
+        int fd = pageDescriptor(fHandle, pageNum);
+        bool written = fd >= 0 && writeAtOffset(fd, source, fHandle->pageSize, pageFileOffset(fHandle, pageNum));
+        if (bounced)
+        {
+            pthread_mutex_unlock(&fileInfo->latch);
+        }
+        if (!written)
+        {
+            return RC_WRITE_FAILED; // Return error if not all bytes were written
+        }
     }
+    pthread_mutex_lock(&fileInfo->latch);
+    notePagesWritten(fHandle, pageNum);
+    pthread_mutex_unlock(&fileInfo->latch);
     RC returnValue;
     int attempts = 0; // Counter for attempts
 
     do {
-        fHandle->curPagePos = pageNum; // Update the current page position
+        notePagePosition(fHandle, pageNum); // Update the current page position
         returnValue = RC_OK; // Set return value to success
         attempts++;
     } while (attempts < 1); // Only allow one attempt
@@ -448,54 +1271,616 @@ RC appendEmptyBlock(SM_FileHandle *fHandle)
         return RC_FILE_HANDLE_NOT_INIT; // Return error if file handle is not initialized
     }
 
-    // Allocate a new page filled with zero bytes
-    SM_PageHandle str = allocateEmptyPage();
-    if (str == NULL)
+    // The new page comes out of the current extent, only its count changes
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    pthread_mutex_lock(&fileInfo->latch);
+    RC result = growToPages(fHandle->totalNumPages + 1, fHandle);
+    pthread_mutex_unlock(&fileInfo->latch);
+    return result;
+}
+
+RC ensureCapacity(PageNumber numberOfPages, SM_FileHandle *fHandle)
+{
+    if (!isFileHandleInitialized(fHandle))
+    {
+        return RC_FILE_HANDLE_NOT_INIT; // Return error if file handle is not initialized
+    }
+    // Ensure the total number of pages meets the required capacity, checked again under the latch by growers
+    if (pageCount(fHandle) >= numberOfPages)
+    {
+        return RC_OK; // Capacity is already sufficient
+    }
+
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    RC result = RC_OK;
+    pthread_mutex_lock(&fileInfo->latch);
+    if (fHandle->totalNumPages < numberOfPages)
+    {
+        result = growToPages(numberOfPages, fHandle); // Grow in one step instead of page by page
+    }
+    pthread_mutex_unlock(&fileInfo->latch);
+    return result;
+}
+
+RC setExtentPages(int extentPages, SM_FileHandle *fHandle)
+{
+    if (!isFileHandleInitialized(fHandle))
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (extentPages <= 0)
+    {
+        return RC_WRITE_FAILED; // An extent holds at least one page
+    }
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    pthread_mutex_lock(&fileInfo->latch);
+    fileInfo->extentPages = extentPages;
+    pthread_mutex_unlock(&fileInfo->latch);
+    return RC_OK;
+}
+
+RC flushPageFileHeader(SM_FileHandle *fHandle)
+{
+    if (!isFileHandleInitialized(fHandle))
     {
-        return RC_WRITE_FAILED; // Return error if memory allocation fails
+        return RC_FILE_HANDLE_NOT_INIT;
     }
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    RC result = RC_OK;
+    pthread_mutex_lock(&fileInfo->latch);
+    if (fileInfo->headerDirty) // Otherwise the header already holds the current page count
+    {
+        result = updateTotalPagesInFile(fHandle) ? RC_OK : RC_WRITE_FAILED;
+        fileInfo->headerDirty = (result != RC_OK);
+    }
+    pthread_mutex_unlock(&fileInfo->latch);
+    return result;
+}
 
-    int totalPages = fHandle->totalNumPages;
-    RC writeResult = writeBlock(totalPages, fHandle, str);
+/*
+    // Helper functions for transfers of contiguous page ranges
+*/
 
-    switch (writeResult)
+// Most pages moved by one vectored system call
+#if defined(IOV_MAX)
+#define RANGE_MAX_PAGES IOV_MAX
+#else
+#define RANGE_MAX_PAGES 1024
+#endif
+
+// Sub-function to check if a range can be moved with vectored calls on the descriptor
+bool canTransferVectored(SM_FileHandle *fHandle, SM_PageHandle *memPages, int numPages)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    return false; // No preadv/pwritev, pages are moved one by one
+#else
+    if (isMapped(fHandle))
     {
-    case RC_OK:
-        break;
+        return false; // Mapped files are copied page by page without system calls
+    }
+    for (int i = 0; i < numPages; i++)
+    {
+        if (needsBounce(fHandle, memPages[i]))
+        {
+            return false; // Direct files need every buffer aligned
+        }
+    }
+    return true;
+#endif
+}
 
-    default:
-        free(str);
-        str = NULL; // Set to NULL to avoid dangling pointer
-        return writeResult;
-        break;
+#if !defined(_WIN32) && !defined(_WIN64)
+// Sub-function to move up to RANGE_MAX_PAGES contiguous pages with preadv or pwritev, resuming after short transfers
+bool transferVectored(SM_FileHandle *fHandle, PageNumber firstPage, int numPages, SM_PageHandle *memPages, bool isWrite)
+{
+    struct iovec iov[RANGE_MAX_PAGES];
+    int fd = pageDescriptor(fHandle, firstPage);
+    long long offset = pageFileOffset(fHandle, firstPage);
+    long long remaining = (long long)numPages * fHandle->pageSize;
+    int first = 0;
+
+    for (int i = 0; i < numPages; i++)
+    {
+        iov[i].iov_base = memPages[i];
+        iov[i].iov_len = fHandle->pageSize;
     }
-    // Update file handle for the new block
-    updateFileHandleForNewBlock(fHandle);
 
-    // Write the updated total pages to the file
-    if (!updateTotalPagesInFile(fHandle))
+    while (remaining > 0 && fd >= 0)
     {
-        return RC_WRITE_FAILED; // Return error if writing total pages fails
+        long long n = isWrite ? pwritev(fd, iov + first, numPages - first, offset)
+                              : preadv(fd, iov + first, numPages - first, offset);
+        if (n < 0 || (n == 0 && isWrite))
+        {
+            return false; // Transfer error
+        }
+        if (n == 0)
+        {
+            // End of file, the rest of the range was never written and reads as zeros
+            for (int i = first; i < numPages; i++)
+            {
+                memset(iov[i].iov_base, '\0', iov[i].iov_len);
+            }
+            return true;
+        }
+        offset += n;
+        remaining -= n;
+
+        // Skip the buffers that are done and trim the one cut short
+        while (n > 0 && first < numPages)
+        {
+            if ((size_t)n >= iov[first].iov_len)
+            {
+                n -= iov[first].iov_len;
+                first++;
+            }
+            else
+            {
+                iov[first].iov_base = (char *)iov[first].iov_base + n;
+                iov[first].iov_len -= n;
+                n = 0;
+            }
+        }
     }
-    else
+    return fd >= 0;
+}
+#endif
+
+// Sub-function to move a range of contiguous pages, vectored where possible and page by page otherwise
+RC transferBlockRange(PageNumber firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages, bool isWrite)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+    if (canTransferVectored(fHandle, memPages, numPages))
     {
-        free(str);    // Free allocated memory
+        int count;
+        for (int done = 0; done < numPages; done += count)
+        {
+            // A single call stays within one segment
+            count = (numPages - done < RANGE_MAX_PAGES) ? numPages - done : RANGE_MAX_PAGES;
+            if (count > pagesLeftInSegment(fHandle, firstPage + done))
+            {
+                count = (int)pagesLeftInSegment(fHandle, firstPage + done);
+            }
+            if (!transferVectored(fHandle, firstPage + done, count, memPages + done, isWrite))
+            {
+                return isWrite ? RC_WRITE_FAILED : RC_READ_FAILED;
+            }
+        }
+        if (isWrite)
+        {
+            SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+            pthread_mutex_lock(&fileInfo->latch);
+            notePagesWritten(fHandle, firstPage + numPages - 1);
+            pthread_mutex_unlock(&fileInfo->latch);
+        }
+        notePagePosition(fHandle, firstPage + numPages - 1); // Update the current page position
         return RC_OK;
     }
+#endif
+
+    for (int i = 0; i < numPages; i++)
+    {
+        RC result = isWrite ? writeBlock(firstPage + i, fHandle, memPages[i])
+                            : readBlock(firstPage + i, fHandle, memPages[i]);
+        if (result != RC_OK)
+        {
+            return result;
+        }
+    }
+    return RC_OK;
+}
+
+/*
+    // Functions that transfer contiguous page ranges
+*/
+
+RC readBlockRange(PageNumber firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
+{
+    // Every page of the range must be readable, the same rule as readBlock
+    if (numPages <= 0 || isInvalidPageNumber(firstPage, pageCount(fHandle)) ||
+        isInvalidPageNumber(firstPage + numPages - 1, pageCount(fHandle)))
+    {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    if (isFileNotInitialized(fHandle->mgmtInfo))
+    {
+        return RC_FILE_NOT_FOUND;
+    }
+    return transferBlockRange(firstPage, numPages, fHandle, memPages, false);
 }
 
-RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle)
+RC writeBlockRange(PageNumber firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages)
 {
+    // Every page of the range must be writable, the same rule as writeBlock
+    if (numPages <= 0 || !isValidPageNum(firstPage, fHandle) || !isValidPageNum(firstPage + numPages - 1, fHandle))
+    {
+        return RC_WRITE_FAILED;
+    }
     if (!isFileHandleInitialized(fHandle))
     {
-        return RC_FILE_HANDLE_NOT_INIT; // Return error if file handle is not initialized
+        return RC_FILE_HANDLE_NOT_INIT;
     }
-    // Ensure the total number of pages meets the required capacity
-    if (fHandle->totalNumPages < numberOfPages)
+    return transferBlockRange(firstPage, numPages, fHandle, memPages, true);
+}
+
+/*
+    // Helper functions for asynchronous batches of page transfers
+*/
+
+// Sub-function to run one request synchronously, used by the fallback and to finish short transfers
+void transferBlockNow(SM_FileHandle *fHandle, SM_IORequest *request)
+{
+    if (request->type == SM_IO_READ)
+    {
+        request->result = readBlock(request->pageNum, fHandle, request->memPage);
+    }
+    else
+    {
+        request->result = writeBlock(request->pageNum, fHandle, request->memPage);
+    }
+    __atomic_store_n(&request->completed, 1, __ATOMIC_RELEASE); // Another thread's reap may finish the request
+}
+
+// Sub-function to reject requests outside the file before they are queued
+bool rejectInvalidRequest(SM_FileHandle *fHandle, SM_IORequest *request)
+{
+    if (request->type == SM_IO_READ && isInvalidPageNumber(request->pageNum, pageCount(fHandle)))
+    {
+        request->result = RC_READ_NON_EXISTING_PAGE;
+    }
+    else if (request->type == SM_IO_WRITE && !isValidPageNum(request->pageNum, fHandle))
+    {
+        request->result = RC_WRITE_FAILED;
+    }
+    else
+    {
+        return false;
+    }
+    request->completed = 1;
+    return true;
+}
+
+#ifdef SM_HAVE_IO_URING
+
+// Submission and completion rings shared with the kernel
+typedef struct SM_IORing
+{
+    int ringFd;
+    unsigned entries;
+    unsigned *sqHead;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sqRing;
+    size_t sqRingSize;
+    void *cqRing;
+    size_t cqRingSize;
+    size_t sqesSize;
+    unsigned queued;   // Requests placed in the submission ring but not yet submitted
+    unsigned inFlight; // Requests submitted whose completion has not been reaped
+} SM_IORing;
+
+// Sub-function to set up an io_uring and map its rings, NULL when the kernel refuses
+SM_IORing *createIORing()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int ringFd = (int)syscall(__NR_io_uring_setup, IO_RING_ENTRIES, &params);
+    if (ringFd < 0)
     {
-        int pagesToAppend = numberOfPages - fHandle->totalNumPages; // Calculate the number of pages to append
-        return appendRequiredEmptyBlocks(pagesToAppend, fHandle);   // Append required blocks and return result
+        return NULL;
     }
 
-    return RC_OK; // Capacity is already sufficient
-}
\ No newline at end of file
+    SM_IORing *ring = calloc(1, sizeof(SM_IORing));
+    if (ring == NULL)
+    {
+        close(ringFd);
+        return NULL;
+    }
+    ring->ringFd = ringFd;
+    ring->entries = params.sq_entries;
+    ring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // Newer kernels share one mapping for both rings
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap)
+    {
+        if (ring->cqRingSize > ring->sqRingSize)
+        {
+            ring->sqRingSize = ring->cqRingSize;
+        }
+        ring->cqRingSize = ring->sqRingSize;
+    }
+
+    ring->sqRing = mmap(NULL, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    ring->cqRing = singleMap ? ring->sqRing
+                             : mmap(NULL, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (ring->sqRing == MAP_FAILED || ring->cqRing == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        if (ring->sqRing != MAP_FAILED)
+            munmap(ring->sqRing, ring->sqRingSize);
+        if (!singleMap && ring->cqRing != MAP_FAILED)
+            munmap(ring->cqRing, ring->cqRingSize);
+        if (ring->sqes != MAP_FAILED)
+            munmap(ring->sqes, ring->sqesSize);
+        close(ringFd);
+        free(ring);
+        return NULL;
+    }
+
+    char *sq = ring->sqRing;
+    char *cq = ring->cqRing;
+    ring->sqHead = (unsigned *)(sq + params.sq_off.head);
+    ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+    ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+    ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return ring;
+}
+
+// Sub-function to enter the kernel, submitting queued requests and optionally waiting for completions
+bool enterIORing(SM_IORing *ring, unsigned minComplete)
+{
+    unsigned flags = (minComplete > 0) ? IORING_ENTER_GETEVENTS : 0;
+    while (ring->queued > 0 || minComplete > 0)
+    {
+        long submitted = syscall(__NR_io_uring_enter, ring->ringFd, ring->queued, minComplete, flags, NULL, 0);
+        if (submitted < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        ring->queued -= (unsigned)submitted;
+        ring->inFlight += (unsigned)submitted;
+        if (ring->queued == 0)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+// Sub-function to collect every completion the kernel has posted
+int drainIORing(SM_FileHandle *fHandle, SM_IORing *ring)
+{
+    unsigned head = *ring->cqHead;
+    int reaped = 0;
+
+    while (head != __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE))
+    {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cqMask];
+        SM_IORequest *request = (SM_IORequest *)(uintptr_t)cqe->user_data;
+
+        if (cqe->res == fHandle->pageSize)
+        {
+            request->result = RC_OK;
+            notePagePosition(fHandle, request->pageNum);
+            if (request->type == SM_IO_WRITE)
+            {
+                notePagesWritten(fHandle, request->pageNum);
+            }
+            __atomic_store_n(&request->completed, 1, __ATOMIC_RELEASE); // The submitter may be waiting in another thread
+        }
+        else
+        {
+            // Short transfers (end of file) and kernel errors are finished synchronously
+            transferBlockNow(fHandle, request);
+        }
+        head++;
+        reaped++;
+    }
+
+    __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+    ring->inFlight -= reaped;
+    return reaped;
+}
+
+// Sub-function to place one request in the submission ring
+void queueIORequest(SM_IORing *ring, SM_FileHandle *fHandle, SM_IORequest *request)
+{
+    unsigned tail = *ring->sqTail;
+    unsigned index = tail & *ring->sqMask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (request->type == SM_IO_READ) ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd = pageDescriptor(fHandle, request->pageNum);
+    sqe->addr = (unsigned long long)(uintptr_t)request->memPage;
+    sqe->len = fHandle->pageSize;
+    sqe->off = pageFileOffset(fHandle, request->pageNum);
+    sqe->user_data = (unsigned long long)(uintptr_t)request;
+
+    ring->sqArray[index] = index;
+    __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+    ring->queued++;
+}
+
+// Sub-function to find the handle's ring, setting it up on first use
+SM_IORing *handleIORing(SM_FileHandle *fHandle)
+{
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+
+    // Mapped files are served by memcpy, a ring would only add overhead
+    if (fileInfo->ioRingUnavailable || fileInfo->map != NULL)
+    {
+        return NULL;
+    }
+    if (fileInfo->ioRing == NULL)
+    {
+        fileInfo->ioRing = createIORing();
+        fileInfo->ioRingUnavailable = (fileInfo->ioRing == NULL);
+    }
+    return fileInfo->ioRing;
+}
+
+void releaseIORing(SM_FileInfo *fileInfo)
+{
+    SM_IORing *ring = fileInfo->ioRing;
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    // The kernel may still write into request buffers, so wait for everything in flight
+    while (ring->inFlight > 0 && enterIORing(ring, ring->inFlight))
+    {
+        unsigned head = *ring->cqHead;
+        unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+        __atomic_store_n(ring->cqHead, tail, __ATOMIC_RELEASE);
+        ring->inFlight -= tail - head;
+    }
+
+    munmap(ring->sqes, ring->sqesSize);
+    if (ring->cqRing != ring->sqRing)
+    {
+        munmap(ring->cqRing, ring->cqRingSize);
+    }
+    munmap(ring->sqRing, ring->sqRingSize);
+    close(ring->ringFd);
+    free(ring);
+    fileInfo->ioRing = NULL;
+}
+
+#else
+
+void releaseIORing(SM_FileInfo *fileInfo)
+{
+    fileInfo->ioRing = NULL; // Nothing to tear down without io_uring
+}
+
+#endif
+
+/*
+    // Functions for asynchronous batches of page transfers
+*/
+
+RC submitBlockIO(SM_FileHandle *fHandle, SM_IORequest *requests, int count)
+{
+    if (!isFileHandleInitialized(fHandle))
+    {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+
+#ifdef SM_HAVE_IO_URING
+    // The ring is shared by the threads using the handle, so it is only touched under the handle latch
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    pthread_mutex_lock(&fileInfo->latch);
+    SM_IORing *ring = handleIORing(fHandle);
+    if (ring != NULL)
+    {
+        RC result = RC_OK;
+        for (int i = 0; i < count && result == RC_OK; i++)
+        {
+            requests[i].completed = 0;
+            if (rejectInvalidRequest(fHandle, &requests[i]))
+            {
+                continue;
+            }
+            if (needsBounce(fHandle, requests[i].memPage) || pageDescriptor(fHandle, requests[i].pageNum) < 0)
+            {
+                transferBlockNow(fHandle, &requests[i]); // Bounced direct pages and unopenable segments take the synchronous path
+                continue;
+            }
+
+            // Make room when the ring is full by waiting for one completion
+            while (result == RC_OK && ring->queued + ring->inFlight >= ring->entries)
+            {
+                result = enterIORing(ring, 1) ? RC_OK : RC_WRITE_FAILED;
+                drainIORing(fHandle, ring);
+            }
+            if (result == RC_OK)
+            {
+                queueIORequest(ring, fHandle, &requests[i]);
+            }
+        }
+
+        // One system call submits the whole batch
+        if (result == RC_OK && !enterIORing(ring, 0))
+        {
+            result = RC_WRITE_FAILED;
+        }
+        pthread_mutex_unlock(&fileInfo->latch);
+        return result;
+    }
+    pthread_mutex_unlock(&fileInfo->latch);
+#endif
+
+    // Synchronous fallback: every request is complete when submit returns
+    for (int i = 0; i < count; i++)
+    {
+        requests[i].completed = 0;
+        if (!rejectInvalidRequest(fHandle, &requests[i]))
+        {
+            transferBlockNow(fHandle, &requests[i]);
+        }
+    }
+    return RC_OK;
+}
+
+int reapBlockIO(SM_FileHandle *fHandle, int minComplete)
+{
+#ifdef SM_HAVE_IO_URING
+    SM_FileInfo *fileInfo = fHandle->mgmtInfo;
+    if (fileInfo == NULL)
+    {
+        return 0;
+    }
+
+    // Completions of every thread's requests are collected together, the waiter keeps the latch while it sleeps
+    pthread_mutex_lock(&fileInfo->latch);
+    SM_IORing *ring = fileInfo->ioRing;
+    int reaped = 0;
+    if (ring != NULL)
+    {
+        reaped = drainIORing(fHandle, ring);
+        while (reaped < minComplete && ring->inFlight > 0)
+        {
+            if (!enterIORing(ring, 1))
+            {
+                break;
+            }
+            reaped += drainIORing(fHandle, ring);
+        }
+    }
+    pthread_mutex_unlock(&fileInfo->latch);
+    return reaped;
+#endif
+
+    return 0; // Synchronous batches have nothing outstanding
+}
+
+RC waitBlockIO(SM_FileHandle *fHandle, SM_IORequest *requests, int count)
+{
+    RC result = RC_OK;
+
+    for (int i = 0; i < count; i++)
+    {
+        // Reap until this request is done, completions for later ones are collected on the way
+        while (!__atomic_load_n(&requests[i].completed, __ATOMIC_ACQUIRE))
+        {
+            if (reapBlockIO(fHandle, 1) == 0 && !__atomic_load_n(&requests[i].completed, __ATOMIC_ACQUIRE))
+            {
+                return RC_READ_FAILED; // Nothing in flight could complete it
+            }
+        }
+        if (requests[i].result != RC_OK && result == RC_OK)
+        {
+            result = requests[i].result; // Report the first failure
+        }
+    }
+    return result;
+}
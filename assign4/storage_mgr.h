@@ -2,42 +2,101 @@
 #define STORAGE_MGR_H
 
 #include "dberror.h"
+#include <pthread.h>
 
 /************************************************************
  *                    handle data structures                *
  ************************************************************/
 typedef struct SM_FileHandle {
 	char *fileName;
-	int totalNumPages;
-	int curPagePos;
+	PageNumber totalNumPages;
+	PageNumber curPagePos;
+	int pageSize; // bytes per page, chosen when the file was created
 	void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+// Per-handle state kept behind SM_FileHandle.mgmtInfo
+typedef struct SM_FileInfo {
+	int fd; // raw descriptor, all page I/O is positional (pread/pwrite)
+	int pageSize; // bytes per page as recorded in the header, PAGE_SIZE for legacy files
+	char *map; // start of the file mapping, NULL unless opened with openPageFileMapped
+	long long mapLength; // bytes of the file currently mapped
+	long long mapReserve; // address space reserved so the mapping never moves
+	void *ioRing; // io_uring instance for asynchronous batches, created on first use
+	int ioRingUnavailable; // set once io_uring could not be set up, batches then run synchronously
+	long long headerSize; // bytes in front of page 0, a whole aligned header page except in legacy files
+	int directIO; // opened with O_DIRECT, transfers bypass the kernel page cache
+	char *bounce; // aligned scratch page for direct transfers from unaligned buffers
+	long long allocatedPages; // pages the file has disk space for, at least totalNumPages
+	int extentPages; // pages reserved at a time when the file grows
+	int headerDirty; // totalNumPages changed since the header was last written
+	long long freshFrom; // pages from here on were added after opening and never written, they read as zeros
+	PageNumber segmentPages; // pages per segment file, 0 when the page file is not segmented
+	int *segmentFds; // descriptors of segment files opened so far, indexed by segment, -1 if not open
+	int numSegmentFds;
+	char *segmentBase; // page file name the segment names are derived from
+	pthread_mutex_t latch; // recursive, guards growth, the header, segments, mapping, io_uring and bounce page; transfers run outside it
+} SM_FileInfo;
+
+// One page transfer of an asynchronous batch
+typedef enum SM_IOType {
+	SM_IO_READ = 0,
+	SM_IO_WRITE = 1
+} SM_IOType;
+
+typedef struct SM_IORequest {
+	PageNumber pageNum;
+	SM_PageHandle memPage; // must stay valid until the request has completed
+	SM_IOType type;
+	int completed; // set when the transfer has finished
+	RC result; // outcome of the transfer once completed
+} SM_IORequest;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
+extern RC createSegmentedPageFile (char *fileName, PageNumber segmentPages);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileMapped (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileDirect (char *fileName, SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
-extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
-extern int getBlockPos (SM_FileHandle *fHandle);
+extern RC readBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern PageNumber getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readNextBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC getBlockPointer (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle *memPage);
+extern RC readBlockRange (PageNumber firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 
 /* writing blocks to a page file */
-extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlock (PageNumber pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
-extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC ensureCapacity (PageNumber numberOfPages, SM_FileHandle *fHandle);
+extern RC writeBlockRange (PageNumber firstPage, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
+
+/* file growth, the page count reaches the header on flushPageFileHeader and closePageFile */
+extern RC setExtentPages (int extentPages, SM_FileHandle *fHandle);
+extern RC flushPageFileHeader (SM_FileHandle *fHandle);
+
+/* page buffers aligned for direct I/O */
+extern SM_PageHandle allocatePageBuffer (int pageSize);
+extern void freePageBuffer (SM_PageHandle page);
+
+/* asynchronous batches of page transfers (io_uring, synchronous fallback) */
+extern RC submitBlockIO (SM_FileHandle *fHandle, SM_IORequest *requests, int count);
+extern int reapBlockIO (SM_FileHandle *fHandle, int minComplete);
+extern RC waitBlockIO (SM_FileHandle *fHandle, SM_IORequest *requests, int count);
 
 #endif
@@ -0,0 +1,2410 @@
+#include "storage_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "buffer_mgr.h"
+#include "dberror.h"
+#include "test_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// var to store the current test's name
+char *testName;
+
+// check whether two the content of a buffer pool is the same as an expected content 
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+// test and helper methods
+static void testCreatingAndReadingDummyPages (void);
+static void createDummyPages(BM_BufferPool *bm, int num);
+static void checkDummyPages(BM_BufferPool *bm, int num);
+
+static void testReadPage (void);
+
+static void testFIFO (void);
+static void testLRU (void);
+
+static void testPageTable (void);
+static void testPersistentFileHandle (void);
+static void testMappedPool (void);
+static void testBatchIO (void);
+static void testReadAhead (void);
+static void testDirectIOPool (void);
+static void testLegacyPageFile (void);
+static void testBlockRange (void);
+static void testSortedFlush (void);
+static void testExtentGrowth (void);
+static void testSegmentedFile (void);
+static void testPageSizes (void);
+static void testLRUK (void);
+static void test2Q (void);
+static void testARC (void);
+static void testARCDirtyVictims (void);
+static void testLFU (void);
+static void testShardedPool (void);
+static void *writeOwnPages (void *arg);
+static void testPageLatches (void);
+static void *readLatchedPage (void *arg);
+static void *flushWhileLatched (void *arg);
+static void testBackgroundWriter (void);
+static void waitForWrites (BM_BufferPool *bm, int numWrites);
+static void testPrefetch (void);
+static void testFrameArena (void);
+static void testResize (void);
+static void resizeWithStrategy (ReplacementStrategy strategy, void *stratData, BM_PoolOptions *options);
+static void testSharedPool (void);
+static void testPoolStats (void);
+static void testPoolTrace (void);
+static void testClockHitRatio (void);
+static void testScanRing (void);
+static void testFrameHandles (void);
+static void testWarmRestart (void);
+static long readTrace (const char *fileName, unsigned long long *records, int maxRecords);
+static int residentPages (BM_BufferPool *bm);
+static bool poolHolds(BM_BufferPool *bm, PageNumber pageNum);
+static void pinAndUnpin(BM_BufferPool *bm, PageNumber pageNum);
+
+// main method
+int 
+main (void) 
+{
+  initStorageManager();
+  testName = "";
+
+  testCreatingAndReadingDummyPages();
+  testReadPage();
+  testFIFO();
+  testLRU();
+  testPageTable();
+  testPersistentFileHandle();
+  testMappedPool();
+  testBatchIO();
+  testReadAhead();
+  testDirectIOPool();
+  testLegacyPageFile();
+  testBlockRange();
+  testSortedFlush();
+  testExtentGrowth();
+  testSegmentedFile();
+  testPageSizes();
+  testLRUK();
+  test2Q();
+  testARC();
+  testARCDirtyVictims();
+  testLFU();
+  testShardedPool();
+  testPageLatches();
+  testBackgroundWriter();
+  testPrefetch();
+  testFrameArena();
+  testResize();
+  testSharedPool();
+  testPoolStats();
+  testPoolTrace();
+  testClockHitRatio();
+  testScanRing();
+  testFrameHandles();
+  testWarmRestart();
+
+  return 0;
+}
+
+// create n pages with content "Page X" and read them back to check whether the content is right
+void
+testCreatingAndReadingDummyPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Creating and Reading Back Dummy Pages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+
+  createDummyPages(bm, 22);
+  checkDummyPages(bm, 20);
+
+  createDummyPages(bm, 10000);
+  checkDummyPages(bm, 10000);
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+
+void 
+createDummyPages(BM_BufferPool *bm, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  
+  for (i = 0; i < num; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(h);
+}
+
+void 
+checkDummyPages(BM_BufferPool *bm, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *expected = malloc(sizeof(char) * 512);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+
+      sprintf(expected, "%s-%lld", "Page", h->pageNum);
+      ASSERT_EQUALS_STRING(expected, h->data, "reading back dummy page content");
+
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+
+  CHECK(shutdownBufferPool(bm));
+
+  free(expected);
+  free(h);
+}
+
+void
+testReadPage ()
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Reading a page";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  
+  CHECK(pinPage(bm, h, 0));
+  CHECK(pinPage(bm, h, 0));
+
+  CHECK(markDirty(bm, h, h->pageNum));
+
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(unpinPage(bm, h, h->pageNum));
+
+  CHECK(forcePage(bm, h, h->pageNum));
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+
+  TEST_DONE();
+}
+
+void
+testFIFO ()
+{
+  // expected results
+  const char *poolContents[] = { 
+    "[0 0],[-1 0],[-1 0]" , 
+    "[0 0],[1 0],[-1 0]", 
+    "[0 0],[1 0],[2 0]", 
+    "[3 0],[1 0],[2 0]", 
+    "[3 0],[4 0],[2 0]",
+    "[3 0],[4 1],[2 0]",
+    "[3 0],[4 1],[5x0]",
+    "[6x0],[4 1],[5x0]",
+    "[6x0],[4 1],[0x0]",
+    "[6x0],[4 0],[0x0]",
+    "[6 0],[4 0],[0 0]"
+  };
+  const int requests[] = {0,1,2,3,4,4,5,6,0};
+  const int numLinRequests = 5;
+  const int numChangeRequests = 3;
+
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing FIFO page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+
+  createDummyPages(bm, 100);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+
+  // reading some pages linearly with direct unpin and no modifications
+  for(i = 0; i < numLinRequests; i++)
+    {
+      pinPage(bm, h, requests[i]);
+      unpinPage(bm, h, h->pageNum);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+    }
+
+  // pin one page and test remainder
+  i = numLinRequests;
+  pinPage(bm, h, requests[i]);
+  ASSERT_EQUALS_POOL(poolContents[i],bm,"pool content after pin page");
+
+  // read pages and mark them as dirty
+  for(i = numLinRequests + 1; i < numLinRequests + numChangeRequests + 1; i++)
+    {
+      pinPage(bm, h, requests[i]);
+      markDirty(bm, h, h->pageNum);
+      unpinPage(bm, h, h->pageNum);
+      ASSERT_EQUALS_POOL(poolContents[i], bm, "check pool content");
+    }
+
+  // flush buffer pool to disk
+  i = numLinRequests + numChangeRequests + 1;
+  h->pageNum = 4;
+  unpinPage(bm, h, h->pageNum);
+  ASSERT_EQUALS_POOL(poolContents[i],bm,"unpin last page");
+  
+  i++;
+  forceFlushPool(bm);
+  ASSERT_EQUALS_POOL(poolContents[i],bm,"pool content after flush");
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "check number of read I/Os");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test the LRU page replacement strategy
+void
+testLRU (void)
+{
+  // expected results
+  const char *poolContents[] = { 
+    // read first five pages and directly unpin them
+    "[0 0],[-1 0],[-1 0],[-1 0],[-1 0]" , 
+    "[0 0],[1 0],[-1 0],[-1 0],[-1 0]", 
+    "[0 0],[1 0],[2 0],[-1 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[3 0],[-1 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    // use some of the page to create a fixed LRU order without changing pool content
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    "[0 0],[1 0],[2 0],[3 0],[4 0]",
+    // check that pages get evicted in LRU order
+    "[0 0],[1 0],[2 0],[5 0],[4 0]",
+    "[0 0],[1 0],[2 0],[5 0],[6 0]",
+    "[7 0],[1 0],[2 0],[5 0],[6 0]",
+    "[7 0],[1 0],[8 0],[5 0],[6 0]",
+    "[7 0],[9 0],[8 0],[5 0],[6 0]"
+  };
+  const int orderRequests[] = {3,4,0,2,1};
+  const int numLRUOrderChange = 5;
+
+  int i;
+  int snapshot = 0;
+  PageNumber *contents;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  testName = "Testing LRU page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 100);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_LRU, NULL));
+
+  // reading first five pages linearly with direct unpin and no modifications
+  for(i = 0; i < 5; i++)
+  {
+      pinPage(bm, h, i);
+      unpinPage(bm, h, h->pageNum);
+      ASSERT_EQUALS_POOL(poolContents[snapshot], bm, "check pool content reading in pages");
+      snapshot++;
+  }
+
+  // read pages to change LRU order
+  for(i = 0; i < numLRUOrderChange; i++)
+  {
+      pinPage(bm, h, orderRequests[i]);
+      unpinPage(bm, h, h->pageNum);
+      ASSERT_EQUALS_POOL(poolContents[snapshot], bm, "check pool content using pages");
+      snapshot++;
+  }
+
+  // replace pages and check that it happens in LRU order
+  for(i = 0; i < 5; i++)
+  {
+      pinPage(bm, h, 5 + i);
+      unpinPage(bm, h, h->pageNum);
+      ASSERT_EQUALS_POOL(poolContents[snapshot], bm, "check pool content using pages");
+      snapshot++;
+  }
+
+  // check number of write IOs
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "check number of write I/Os");
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "check number of read I/Os");
+
+  // pinning the most recently used page again keeps every frame in the LRU order
+  pinPage(bm, h, 9);
+  unpinPage(bm, h, h->pageNum);
+  for(i = 10; i < 15; i++)
+  {
+      pinPage(bm, h, i);
+      unpinPage(bm, h, h->pageNum);
+  }
+  contents = getFrameContents(bm);
+  for(i = 0; i < 5; i++)
+      ASSERT_TRUE(contents[i] >= 10 && contents[i] < 15, "every frame is reused after a hit on the newest page");
+  free(contents);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that resident pages are found through the page table across evictions
+void
+testPageTable (void)
+{
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *expected = malloc(sizeof(char) * 512);
+  testName = "Testing page table lookups";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 300);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 100, RS_FIFO, NULL));
+
+  // fill the pool, then push the first 100 pages out again
+  for(i = 0; i < 200; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h, h->pageNum));
+  }
+  ASSERT_EQUALS_INT(200, getNumReadIO(bm), "every first access is a miss");
+
+  // resident pages are hits and return the right content
+  for(i = 199; i >= 100; i--)
+  {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "resident page content");
+      CHECK(unpinPage(bm, h, h->pageNum));
+  }
+  ASSERT_EQUALS_INT(200, getNumReadIO(bm), "resident pages do not cause reads");
+
+  // evicted pages are no longer known to the pool
+  ASSERT_ERROR(markDirty(bm, h, 0), "evicted page cannot be marked dirty");
+  ASSERT_ERROR(unpinPage(bm, h, 99), "evicted page cannot be unpinned");
+
+  // pinning an evicted page reads it again
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Page-0", h->data, "evicted page is read back");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  ASSERT_EQUALS_INT(201, getNumReadIO(bm), "evicted page causes a read");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test that forced pages reach the file while the pool keeps its handle open
+void
+testPersistentFileHandle (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *data = malloc(PAGE_SIZE);
+  testName = "Testing the pool's persistent file handle";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  CHECK(pinPage(bm, h, 7));
+  sprintf(h->data, "%s", "Forced-7");
+  CHECK(markDirty(bm, h, h->pageNum));
+  CHECK(forcePage(bm, h, h->pageNum));
+  CHECK(unpinPage(bm, h, h->pageNum));
+
+  // a second handle sees the forced page before the pool is shut down
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(7, &fh, data));
+  ASSERT_EQUALS_STRING("Forced-7", data, "forced page is visible to other handles");
+  CHECK(closePageFile(&fh));
+
+  ASSERT_EQUALS_INT(1, getNumReadIO(bm), "one read for the miss");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "one write for the forced page");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(data);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// test a pool that pins pages straight out of a mapping of the page file
+void
+testMappedPool (void)
+{
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .mappedIO = true };
+  char *expected = malloc(sizeof(char) * 512);
+  testName = "Testing memory-mapped buffer pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 50);
+
+  // scan more pages than the pool holds, twice
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_LRU, NULL, &options));
+  for(i = 0; i < 100; i++)
+  {
+      CHECK(pinPage(bm, h, i % 50));
+      sprintf(expected, "%s-%i", "Page", i % 50);
+      ASSERT_EQUALS_STRING(expected, h->data, "mapped page content");
+      CHECK(unpinPage(bm, h, h->pageNum));
+  }
+  ASSERT_EQUALS_INT(100, getNumReadIO(bm), "every pin of a 3 frame pool misses");
+
+  // modify pages in place and grow the file past its end
+  CHECK(pinPage(bm, h, 7));
+  sprintf(h->data, "%s", "Mapped-7");
+  CHECK(markDirty(bm, h, h->pageNum));
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(pinPage(bm, h, 400));
+  sprintf(h->data, "%s", "Mapped-400");
+  CHECK(markDirty(bm, h, h->pageNum));
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(shutdownBufferPool(bm));
+
+  // a regular pool sees the changes
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 7));
+  ASSERT_EQUALS_STRING("Mapped-7", h->data, "page written through the mapping");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(pinPage(bm, h, 400));
+  ASSERT_EQUALS_STRING("Mapped-400", h->data, "page appended through the mapping");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// write and read back a batch of pages through the asynchronous interface
+void
+testBatchIO (void)
+{
+  const int numPages = 200;
+  SM_FileHandle fh;
+  SM_IORequest *requests = malloc(sizeof(SM_IORequest) * numPages);
+  char *pages = calloc(numPages, PAGE_SIZE);
+  char *expected = malloc(sizeof(char) * 512);
+  int i;
+  testName = "Testing batched asynchronous page I/O";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(ensureCapacity(numPages, &fh));
+
+  // more requests than the submission queue holds, in reverse page order
+  for (i = 0; i < numPages; i++)
+    {
+      sprintf(pages + i * PAGE_SIZE, "%s-%i", "Batch", numPages - 1 - i);
+      requests[i].pageNum = numPages - 1 - i;
+      requests[i].memPage = pages + i * PAGE_SIZE;
+      requests[i].type = SM_IO_WRITE;
+    }
+  CHECK(submitBlockIO(&fh, requests, numPages));
+  CHECK(waitBlockIO(&fh, requests, numPages));
+
+  memset(pages, 0, numPages * PAGE_SIZE);
+  for (i = 0; i < numPages; i++)
+    {
+      requests[i].pageNum = i;
+      requests[i].type = SM_IO_READ;
+    }
+  CHECK(submitBlockIO(&fh, requests, numPages));
+  CHECK(waitBlockIO(&fh, requests, numPages));
+  for (i = 0; i < numPages; i++)
+    {
+      sprintf(expected, "%s-%i", "Batch", i);
+      ASSERT_EQUALS_STRING(expected, pages + i * PAGE_SIZE, "page read back from a batch");
+    }
+
+  // requests past the end of the file fail on their own
+  requests[0].pageNum = numPages + 10;
+  requests[0].type = SM_IO_READ;
+  requests[1].pageNum = 3;
+  requests[1].type = SM_IO_READ;
+  CHECK(submitBlockIO(&fh, requests, 2));
+  ASSERT_ERROR(waitBlockIO(&fh, requests, 2), "reading a non-existing page in a batch");
+  ASSERT_EQUALS_INT(RC_OK, requests[1].result, "the rest of the batch completes");
+  ASSERT_EQUALS_STRING("Batch-3", requests[1].memPage, "page read next to a failed one");
+
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(pages);
+  free(requests);
+  TEST_DONE();
+}
+
+// pages loaded by read-ahead are resident and unpinned, dirty victims are written first
+void
+testReadAhead (void)
+{
+  int i, totalFixCount;
+  int *fixCounts;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *expected = malloc(sizeof(char) * 512);
+  testName = "Testing read-ahead into the buffer pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 50);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s", "Dirty-0");
+  CHECK(markDirty(bm, h, h->pageNum));
+  CHECK(unpinPage(bm, h, h->pageNum));
+
+  // page 0 is resident, so 1..8 fill the pool and evict it
+  CHECK(readAheadPages(bm, 0, 9));
+  ASSERT_EQUALS_INT(9, getNumReadIO(bm), "one read per page loaded");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "dirty victim written back");
+  for (i = 1; i < 9; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page loaded by read-ahead");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  ASSERT_EQUALS_INT(9, getNumReadIO(bm), "pins of read-ahead pages hit");
+
+  // pinned frames are never replaced, and pages past the end are skipped
+  CHECK(pinPage(bm, h, 1));
+  CHECK(readAheadPages(bm, 40, 5));
+  CHECK(readAheadPages(bm, 1000, 5));
+  fixCounts = getFixCounts(bm);
+  for (i = 0, totalFixCount = 0; i < 8; i++)
+    totalFixCount += fixCounts[i];
+  ASSERT_EQUALS_INT(1, totalFixCount, "read-ahead leaves pages unpinned");
+  ASSERT_EQUALS_STRING("Page-1", h->data, "pinned page kept");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  ASSERT_EQUALS_INT(14, getNumReadIO(bm), "only existing pages read");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Dirty-0", h->data, "victim written before its frame was reused");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(fixCounts);
+  free(expected);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a direct I/O pool reads and writes the same pages as a regular one, unaligned buffers included
+void
+testDirectIOPool (void)
+{
+  int i;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .directIO = true };
+  SM_FileHandle fh;
+  char *unaligned = malloc(PAGE_SIZE + 1);
+  char *expected = malloc(sizeof(char) * 512);
+  testName = "Testing direct I/O buffer pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 50);
+
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &options));
+  for(i = 0; i < 50; i++)
+  {
+      CHECK(pinPage(bm, h, i));
+      ASSERT_TRUE(((size_t) h->data % 4096) == 0, "frame memory is page aligned");
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page read directly");
+      sprintf(h->data, "%s-%i", "Direct", i);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+  }
+  CHECK(shutdownBufferPool(bm));
+
+  // a handle opened for direct I/O also serves buffers that are not aligned
+  CHECK(openPageFileDirect("testbuffer.bin", &fh));
+  CHECK(readBlock(7, &fh, unaligned + 1));
+  ASSERT_EQUALS_STRING("Direct-7", unaligned + 1, "unaligned direct read");
+  sprintf(unaligned + 1, "%s", "Unaligned-8");
+  CHECK(writeBlock(8, &fh, unaligned + 1));
+  i = fh.totalNumPages;
+  CHECK(appendEmptyBlock(&fh));
+  CHECK(closePageFile(&fh));
+  CHECK(openPageFileDirect("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(i + 1, (int) fh.totalNumPages, "header page rewritten directly");
+  CHECK(closePageFile(&fh));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(bm, h, 8));
+  ASSERT_EQUALS_STRING("Unaligned-8", h->data, "unaligned direct write");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(pinPage(bm, h, 48));
+  ASSERT_EQUALS_STRING("Direct-48", h->data, "page written directly");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(unaligned);
+  free(expected);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// files with the old text header are still read and extended in their own format
+void
+testLegacyPageFile (void)
+{
+  SM_FileHandle fh;
+  SM_PageHandle page = calloc(PAGE_SIZE, 1);
+  FILE *file;
+  int i;
+  testName = "Testing page files with a legacy header";
+
+  // the page count line sits in the 5 bytes in front of page 0
+  file = fopen("testbuffer.bin", "wb");
+  fwrite("2\n\0\0\0", 1, 5, file);
+  for (i = 0; i < 2; i++)
+    {
+      memset(page, 0, PAGE_SIZE);
+      sprintf(page, "%s-%i", "Legacy", i);
+      fwrite(page, 1, PAGE_SIZE, file);
+    }
+  fclose(file);
+
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(2, (int) fh.totalNumPages, "legacy page count");
+  CHECK(readBlock(1, &fh, page));
+  ASSERT_EQUALS_STRING("Legacy-1", page, "legacy page content");
+  CHECK(appendEmptyBlock(&fh));
+  CHECK(closePageFile(&fh));
+
+  // direct I/O is declined for misaligned legacy pages, the handle keeps working
+  CHECK(openPageFileDirect("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(3, (int) fh.totalNumPages, "legacy page count rewritten");
+  ASSERT_EQUALS_INT(0, ((SM_FileInfo *) fh.mgmtInfo)->directIO, "no direct I/O on a legacy file");
+  CHECK(readBlock(0, &fh, page));
+  ASSERT_EQUALS_STRING("Legacy-0", page, "first legacy page content");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  TEST_DONE();
+}
+
+// contiguous ranges longer than one vectored call, past the end of the file and out of bounds
+void
+testBlockRange (void)
+{
+  const int numPages = 1500;
+  SM_FileHandle fh;
+  SM_PageHandle *pages = malloc(sizeof(SM_PageHandle) * numPages);
+  char *expected = malloc(sizeof(char) * 512);
+  int i;
+  testName = "Testing vectored page range transfers";
+
+  for (i = 0; i < numPages; i++)
+    pages[i] = calloc(PAGE_SIZE, 1);
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(ensureCapacity(numPages + 2, &fh));
+
+  for (i = 0; i < numPages; i++)
+    sprintf(pages[i], "%s-%i", "Range", i + 2);
+  CHECK(writeBlockRange(2, numPages, &fh, pages));
+
+  for (i = 0; i < numPages; i++)
+    memset(pages[i], 'x', PAGE_SIZE);
+  CHECK(readBlockRange(2, numPages, &fh, pages));
+  for (i = 0; i < numPages; i++)
+    {
+      sprintf(expected, "%s-%i", "Range", i + 2);
+      ASSERT_EQUALS_STRING(expected, pages[i], "page read back from a range");
+    }
+  CHECK(readBlock(700, &fh, pages[0]));
+  ASSERT_EQUALS_STRING("Range-700", pages[0], "range page read on its own");
+
+  ASSERT_ERROR(readBlockRange(numPages, 10, &fh, pages), "reading a range past the last page");
+  ASSERT_ERROR(writeBlockRange(numPages, 10, &fh, pages), "writing a range past the last page");
+  ASSERT_ERROR(readBlockRange(0, 0, &fh, pages), "reading an empty range");
+
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  for (i = 0; i < numPages; i++)
+    free(pages[i]);
+  free(pages);
+  free(expected);
+  TEST_DONE();
+}
+
+// a flush writes runs of consecutive dirty pages and isolated ones alike
+void
+testSortedFlush (void)
+{
+  const int dirtyPages[] = {17, 3, 12, 10, 40, 11, 13, 25, 16, 14, 15};
+  const int numDirty = 11;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *expected = malloc(sizeof(char) * 512);
+  int i;
+  testName = "Testing sorted flush of dirty pages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 50);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 20, RS_FIFO, NULL));
+  for (i = 0; i < numDirty; i++)
+    {
+      CHECK(pinPage(bm, h, dirtyPages[i]));
+      sprintf(h->data, "%s-%i", "Flushed", dirtyPages[i]);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(pinPage(bm, h, 18));
+  CHECK(unpinPage(bm, h, h->pageNum));
+
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(numDirty, getNumWriteIO(bm), "one write per dirty page");
+  CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(numDirty, getNumWriteIO(bm), "flushed pages are clean");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < numDirty; i++)
+    {
+      CHECK(pinPage(bm, h, dirtyPages[i]));
+      sprintf(expected, "%s-%i", "Flushed", dirtyPages[i]);
+      ASSERT_EQUALS_STRING(expected, h->data, "flushed page content");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(pinPage(bm, h, 18));
+  ASSERT_EQUALS_STRING("Page-18", h->data, "clean page between runs untouched");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(expected);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// files grow a whole extent at a time and write their page count lazily
+void
+testExtentGrowth (void)
+{
+  SM_FileHandle fh, other;
+  SM_PageHandle page = calloc(PAGE_SIZE, 1);
+  struct stat st;
+  int i;
+  testName = "Testing extent preallocation and lazy page counts";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(setExtentPages(64, &fh));
+  ASSERT_ERROR(setExtentPages(0, &fh), "extents hold at least one page");
+
+  CHECK(ensureCapacity(100, &fh));
+  ASSERT_EQUALS_INT(100, (int) fh.totalNumPages, "capacity reached in one step");
+  stat("testbuffer.bin", &st);
+  ASSERT_EQUALS_INT(PAGE_SIZE + 128 * PAGE_SIZE, (int) st.st_size, "file grown to whole extents");
+
+  for (i = 0; i < 30; i++)
+    CHECK(appendEmptyBlock(&fh));
+  ASSERT_EQUALS_INT(130, (int) fh.totalNumPages, "appended pages counted");
+  stat("testbuffer.bin", &st);
+  ASSERT_EQUALS_INT(PAGE_SIZE + 192 * PAGE_SIZE, (int) st.st_size, "appends use up the extent first");
+
+  // a write to the page right after the last one adds it to the file
+  sprintf(page, "%s", "Tail-130");
+  CHECK(writeBlock(130, &fh, page));
+  ASSERT_EQUALS_INT(131, (int) fh.totalNumPages, "write past the end grows the file");
+  CHECK(readBlock(120, &fh, page));
+  ASSERT_EQUALS_INT(0, page[0], "preallocated page reads as zeros");
+
+  // the header still holds the old count until it is flushed
+  CHECK(openPageFile("testbuffer.bin", &other));
+  ASSERT_EQUALS_INT(1, (int) other.totalNumPages, "page count written lazily");
+  CHECK(closePageFile(&other));
+  CHECK(flushPageFileHeader(&fh));
+  CHECK(openPageFile("testbuffer.bin", &other));
+  ASSERT_EQUALS_INT(131, (int) other.totalNumPages, "page count after flushing the header");
+  CHECK(readBlock(130, &other, page));
+  ASSERT_EQUALS_STRING("Tail-130", page, "page written past the end");
+  CHECK(closePageFile(&other));
+
+  CHECK(appendEmptyBlock(&fh));
+  CHECK(closePageFile(&fh));
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(132, (int) fh.totalNumPages, "page count written on close");
+  CHECK(closePageFile(&fh));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(page);
+  TEST_DONE();
+}
+
+// a page file split into segment files of 10 pages
+void
+testSegmentedFile (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle pages[20];
+  char expected[32];
+  struct stat st;
+  int i;
+  testName = "Testing segmented page files";
+
+  CHECK(createSegmentedPageFile("testbuffer.bin", 10));
+
+  // sorted flushes write runs that cross segment boundaries
+  CHECK(initBufferPool(bm, "testbuffer.bin", 40, RS_FIFO, NULL));
+  for (i = 0; i < 35; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%lld", "Page", h->pageNum);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  ASSERT_TRUE(stat("testbuffer.bin.3", &st) == 0, "last segment created");
+  ASSERT_TRUE(stat("testbuffer.bin.4", &st) != 0, "no segment past the last page");
+  stat("testbuffer.bin.1", &st);
+  ASSERT_EQUALS_INT(10 * PAGE_SIZE, (int) st.st_size, "segments have no header page");
+
+  // every page comes back through a small pool
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  for (i = 34; i >= 0; i--)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%lld", "Page", h->pageNum);
+      ASSERT_EQUALS_STRING(expected, h->data, "page read from its segment");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  // ranges are split at segment boundaries
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(35, (int) fh.totalNumPages, "page count kept in the main file");
+  for (i = 0; i < 20; i++)
+    pages[i] = calloc(PAGE_SIZE, 1);
+  CHECK(readBlockRange(5, 20, &fh, pages));
+  for (i = 0; i < 20; i++)
+    {
+      sprintf(expected, "%s-%d", "Page", i + 5);
+      ASSERT_EQUALS_STRING(expected, pages[i], "range read across segments");
+      sprintf(pages[i], "%s-%d", "Range", i + 5);
+    }
+  CHECK(writeBlockRange(5, 20, &fh, pages));
+  CHECK(readBlock(20, &fh, pages[0]));
+  ASSERT_EQUALS_STRING("Range-20", pages[0], "range written across segments");
+  CHECK(closePageFile(&fh));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  ASSERT_TRUE(stat("testbuffer.bin.1", &st) != 0, "segments destroyed with the file");
+
+  for (i = 0; i < 20; i++)
+    free(pages[i]);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// page files created with page sizes other than PAGE_SIZE
+void
+testPageSizes (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions direct = { .directIO = true };
+  SM_FileHandle fh;
+  SM_PageHandle page;
+  char expected[32];
+  struct stat st;
+  int pageSize, i;
+  testName = "Testing page files with larger pages";
+
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize("testbuffer.bin", 2048), "page size below the minimum");
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize("testbuffer.bin", 12288), "page size not a power of two");
+  ASSERT_EQUALS_INT(RC_INVALID_PAGE_SIZE, createPageFileWithPageSize("testbuffer.bin", 131072), "page size above the maximum");
+
+  for (pageSize = 8192; pageSize <= MAX_PAGE_SIZE; pageSize *= 2)
+    {
+      CHECK(createPageFileWithPageSize("testbuffer.bin", pageSize));
+
+      // the page size comes back from the header, pages are laid out behind the header page
+      CHECK(openPageFile("testbuffer.bin", &fh));
+      ASSERT_EQUALS_INT(pageSize, fh.pageSize, "page size read from the header");
+      page = allocatePageBuffer(pageSize);
+      page[pageSize - 1] = 'z';
+      CHECK(writeBlock(1, &fh, page));
+      CHECK(closePageFile(&fh));
+      stat("testbuffer.bin", &st);
+      ASSERT_EQUALS_INT(4096 + 2 * pageSize, (int) st.st_size, "pages of the chosen size");
+      freePageBuffer(page);
+
+      // pool frames hold whole pages, the last byte included
+      CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+      CHECK(pinPage(bm, h, 1));
+      ASSERT_EQUALS_INT('z', h->data[pageSize - 1], "last byte of a large page");
+      CHECK(unpinPage(bm, h, 1));
+      for (i = 0; i < 10; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          sprintf(h->data + pageSize - 16, "%s-%i", "Page", i);
+          CHECK(markDirty(bm, h, h->pageNum));
+          CHECK(unpinPage(bm, h, h->pageNum));
+        }
+      CHECK(shutdownBufferPool(bm));
+
+      // direct pools read the same pages back into aligned frames
+      CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_LRU, NULL, &direct));
+      for (i = 0; i < 10; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_STRING(expected, h->data + pageSize - 16, "end of a large page read back");
+          CHECK(unpinPage(bm, h, h->pageNum));
+        }
+      CHECK(shutdownBufferPool(bm));
+
+      CHECK(destroyPageFile("testbuffer.bin"));
+    }
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// LRU-K with K = 2 keeps twice referenced pages resident through a scan
+void
+testLRUK (void)
+{
+  const int hotPages[] = {0,1,0,1};
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber *contents;
+  char expected[32];
+  int k = 2, badK = 0;
+  int i;
+  testName = "Testing LRU-K page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+
+  ASSERT_ERROR(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &badK), "K below one");
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &k));
+
+  for (i = 0; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, hotPages[i]));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+
+  // pages referenced once are evicted before the hot ones
+  for (i = 2; i <= 5; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  contents = getFrameContents(bm);
+  ASSERT_EQUALS_INT(0, (int) contents[0], "hot page 0 survives the scan");
+  ASSERT_EQUALS_INT(1, (int) contents[1], "hot page 1 survives the scan");
+  ASSERT_EQUALS_INT(5, (int) contents[2], "scan cycles through one frame");
+  free(contents);
+
+  // page 2 was evicted, its retained history makes the new pin its second reference
+  CHECK(pinPage(bm, h, 2));
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(pinPage(bm, h, 6));
+  CHECK(unpinPage(bm, h, h->pageNum));
+  contents = getFrameContents(bm);
+  ASSERT_EQUALS_INT(6, (int) contents[0], "oldest second-to-last reference evicted");
+  ASSERT_EQUALS_INT(1, (int) contents[1], "page 1 stays");
+  ASSERT_EQUALS_INT(2, (int) contents[2], "page 2 kept through its retained history");
+  free(contents);
+
+  // back-to-back pins of the same page count once, so a scan of records cannot make its pages hot
+  for (i = 0; i < 5; i++)
+    {
+      CHECK(pinPage(bm, h, 7));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(pinPage(bm, h, 8));
+  CHECK(unpinPage(bm, h, h->pageNum));
+  contents = getFrameContents(bm);
+  ASSERT_EQUALS_INT(8, (int) contents[0], "correlated pins do not count as a second reference");
+  free(contents);
+
+  CHECK(shutdownBufferPool(bm));
+
+  // without stratData K defaults to 2
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, NULL));
+  for (i = 0; i < 20; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page read through an LRU-K pool");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// check whether a page is resident in any frame of the pool
+bool
+poolHolds (BM_BufferPool *bm, PageNumber pageNum)
+{
+  PageNumber *contents = getFrameContents(bm);
+  bool found = false;
+  int i;
+
+  for (i = 0; i < bm->numPages; i++)
+    if (contents[i] == pageNum)
+      found = true;
+
+  free(contents);
+  return found;
+}
+
+// reference a page once
+void
+pinAndUnpin (BM_BufferPool *bm, PageNumber pageNum)
+{
+  BM_PageHandle h;
+
+  CHECK(pinPage(bm, &h, pageNum));
+  CHECK(unpinPage(bm, &h, h.pageNum));
+}
+
+// 2Q with 4 frames keeps pages that came back from A1out through a scan
+void
+test2Q (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  int i;
+  testName = "Testing 2Q page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_2Q, NULL));
+
+  // page 0 is pushed out of A1in and remembered in A1out
+  for (i = 0; i <= 4; i++)
+    pinAndUnpin(bm, i);
+  ASSERT_TRUE(!poolHolds(bm, 0), "oldest page of A1in evicted first");
+
+  // coming back from A1out moves it to Am
+  pinAndUnpin(bm, 0);
+  ASSERT_TRUE(poolHolds(bm, 0), "ghost hit loads the page into Am");
+
+  // a scan only cycles through A1in
+  for (i = 5; i <= 12; i++)
+    pinAndUnpin(bm, i);
+  ASSERT_TRUE(poolHolds(bm, 0), "page in Am survives the scan");
+  ASSERT_TRUE(poolHolds(bm, 12), "scan pages go through A1in");
+
+  // a second pin while in A1in is correlated and does not promote
+  pinAndUnpin(bm, 11);
+  for (i = 13; i <= 15; i++)
+    pinAndUnpin(bm, i);
+  ASSERT_TRUE(!poolHolds(bm, 11), "repinned A1in page still leaves with the scan");
+  ASSERT_TRUE(poolHolds(bm, 0), "page in Am survives the second scan");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// ARC with 4 frames keeps twice referenced pages in T2 and adapts to hits in B1
+void
+testARC (void)
+{
+  const int hotPages[] = {0,1,0,1};
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int i;
+  testName = "Testing ARC page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_ARC, NULL));
+
+  for (i = 0; i < 4; i++)
+    pinAndUnpin(bm, hotPages[i]);
+
+  // back-to-back pins of one page count once, so a scan stays in T1
+  for (i = 2; i <= 9; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h, h->pageNum));
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  ASSERT_TRUE(poolHolds(bm, 0) && poolHolds(bm, 1), "pages in T2 survive the scan");
+  ASSERT_TRUE(poolHolds(bm, 8) && poolHolds(bm, 9), "scan cycles through T1");
+
+  // a hit in B1 raises T1's target and brings the page back into T2
+  pinAndUnpin(bm, 7);
+  ASSERT_TRUE(poolHolds(bm, 7), "ghost hit loads the page");
+  ASSERT_TRUE(!poolHolds(bm, 8), "T1 above its target gives up its oldest page");
+  ASSERT_TRUE(poolHolds(bm, 0) && poolHolds(bm, 1) && poolHolds(bm, 9), "other pages stay");
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// a ghost hit moves ARC's target once, also when a sharded pool has to write the dirty victim and choose again
+void
+testARCDirtyVictims (void)
+{
+  const int hotPages[] = {0,1,0,1};
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions sharded = { .shards = 1 };
+  int i, round;
+  testName = "Testing ARC adaptation with dirty victims";
+
+  CHECK(createPageFile("testbuffer.bin"));
+
+  for (round = 0; round < 2; round++)
+    {
+      CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_ARC, NULL, (round == 0) ? NULL : &sharded));
+      for (i = 0; i < 4; i++)
+        pinAndUnpin(bm, hotPages[i]);
+
+      // the scan leaves T1 = {8, 9} with page 8 dirty and pages 6 and 7 in B1
+      for (i = 2; i <= 9; i++)
+        {
+          CHECK(pinPage(bm, h, i));
+          if (i == 8)
+            {
+              CHECK(markDirty(bm, h, i));
+            }
+          CHECK(unpinPage(bm, h, h->pageNum));
+        }
+
+      // the hit in B1 raises the target to 1, so T1 gives up page 8 once it is written, T2 keeps its pages
+      pinAndUnpin(bm, 7);
+      ASSERT_TRUE(poolHolds(bm, 7), "ghost hit loads the page");
+      ASSERT_TRUE(!poolHolds(bm, 8), "the written victim leaves T1");
+      ASSERT_TRUE(poolHolds(bm, 0) && poolHolds(bm, 1) && poolHolds(bm, 9), "other pages stay");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// LFU evicts the least frequently pinned page, the oldest among equals, and halves counts when aging
+void
+testLFU (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int agingPeriod = 4, badPeriod = -1;
+  int i;
+  testName = "Testing LFU page replacement";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  ASSERT_ERROR(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, &badPeriod), "negative aging period");
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LFU, NULL));
+
+  for (i = 0; i < 3; i++)
+    pinAndUnpin(bm, 0);
+  for (i = 0; i < 2; i++)
+    pinAndUnpin(bm, 1);
+  pinAndUnpin(bm, 2);
+
+  pinAndUnpin(bm, 3);
+  ASSERT_TRUE(!poolHolds(bm, 2), "page pinned once evicted first");
+  pinAndUnpin(bm, 4);
+  ASSERT_TRUE(!poolHolds(bm, 3), "a new page starts over at one pin");
+  ASSERT_TRUE(poolHolds(bm, 0) && poolHolds(bm, 1) && poolHolds(bm, 4), "frequent pages stay");
+
+  // page 5 is still pinned with the lowest count, so page 1 of the next bucket goes
+  CHECK(pinPage(bm, h, 5));
+  pinAndUnpin(bm, 6);
+  ASSERT_TRUE(poolHolds(bm, 5) && !poolHolds(bm, 1) && poolHolds(bm, 0), "pinned page skipped");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  CHECK(shutdownBufferPool(bm));
+
+  // without aging page 0 keeps the eight pins it got long ago
+  CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LFU, NULL));
+  for (i = 0; i < 8; i++)
+    pinAndUnpin(bm, 0);
+  for (i = 0; i < 6; i++)
+    pinAndUnpin(bm, 1);
+  pinAndUnpin(bm, 2);
+  ASSERT_TRUE(poolHolds(bm, 0) && !poolHolds(bm, 1), "old pins protect page 0 forever");
+  CHECK(shutdownBufferPool(bm));
+
+  // halving every four pins lets the recent pins of page 1 outweigh them
+  CHECK(initBufferPool(bm, "testbuffer.bin", 2, RS_LFU, &agingPeriod));
+  for (i = 0; i < 8; i++)
+    pinAndUnpin(bm, 0);
+  for (i = 0; i < 6; i++)
+    pinAndUnpin(bm, 1);
+  pinAndUnpin(bm, 2);
+  ASSERT_TRUE(!poolHolds(bm, 0) && poolHolds(bm, 1), "aged out page 0 evicted");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pages of one thread of testShardedPool, the thread writes them and reads them back
+typedef struct ShardWorker {
+  BM_BufferPool *bm;
+  int firstPage;
+  int numPages;
+  int mismatches;
+} ShardWorker;
+
+void *
+writeOwnPages (void *arg)
+{
+  ShardWorker *worker = arg;
+  BM_PageHandle h;
+  char expected[64];
+  int round, i;
+
+  for (round = 0; round < 4; round++)
+    for (i = 0; i < worker->numPages; i++)
+      {
+        PageNumber pageNum = worker->firstPage + i;
+        sprintf(expected, "%s-%lld", "Page", pageNum);
+        CHECK(pinPage(worker->bm, &h, pageNum));
+        if (round == 0)
+          strcpy(h.data, expected);
+        else if (strcmp(expected, h.data) != 0)
+          worker->mismatches++;
+        CHECK(markDirty(worker->bm, &h, pageNum));
+        CHECK(unpinPage(worker->bm, &h, pageNum));
+      }
+  return NULL;
+}
+
+// thread-safe pool split into shards: dirty evictions, statistics and pages written by concurrent threads
+void
+testShardedPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .shards = 4 };
+  BM_PoolOptions tooMany = { .shards = 9 };
+  ShardWorker workers[4];
+  pthread_t threads[4];
+  PageNumber *contents;
+  int *fixCounts;
+  int i, used;
+  testName = "Testing thread-safe sharded buffer pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  ASSERT_ERROR(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &tooMany), "more shards than frames");
+
+  // 8 frames in 4 shards, every eviction writes a dirty page back
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &options));
+  for (i = 0; i < 40; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  ASSERT_EQUALS_INT(40, getNumReadIO(bm), "one read per page, summed over the shards");
+  ASSERT_TRUE(getNumWriteIO(bm) >= 32, "dirty victims written back");
+
+  contents = getFrameContents(bm);
+  fixCounts = getFixCounts(bm);
+  used = 0;
+  for (i = 0; i < 8; i++)
+    {
+      if (contents[i] != NO_PAGE)
+        used++;
+      ASSERT_EQUALS_INT(0, fixCounts[i], "no page left pinned");
+    }
+  ASSERT_TRUE(used >= 4, "every shard holds pages");
+  free(contents);
+  free(fixCounts);
+
+  // read-ahead fills each shard with its own pages, the pool keeps serving every page unchanged
+  CHECK(readAheadPages(bm, 0, 8));
+  for (i = 0; i < 40; i++)
+    {
+      char expected[32];
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page read through a sharded pool");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  // four threads write and reread their own pages through a pool much smaller than them
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 16, RS_CLOCK, NULL, &options));
+  for (i = 0; i < 4; i++)
+    {
+      workers[i].bm = bm;
+      workers[i].firstPage = 100 + 50 * i;
+      workers[i].numPages = 50;
+      workers[i].mismatches = 0;
+      pthread_create(&threads[i], NULL, writeOwnPages, &workers[i]);
+    }
+  for (i = 0; i < 4; i++)
+    {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUALS_INT(0, workers[i].mismatches, "pages read back as the thread wrote them");
+    }
+  CHECK(shutdownBufferPool(bm));
+
+  // a single-threaded pool sees what the threads wrote
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for (i = 100; i < 300; i++)
+    {
+      char expected[32];
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page written by a thread");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// reader of testPageLatches, copies page 3 under a shared latch
+typedef struct LatchReader {
+  BM_BufferPool *bm;
+  char seen[32];
+} LatchReader;
+
+void *
+readLatchedPage (void *arg)
+{
+  LatchReader *reader = arg;
+  BM_PageHandle h;
+
+  CHECK(pinPageLatched(reader->bm, &h, 3, BM_LATCH_SHARED));
+  strcpy(reader->seen, h.data);
+  CHECK(unpinPage(reader->bm, &h, 3));
+  return NULL;
+}
+
+// flusher of testPageLatches, its forceFlushPool waits for the exclusive latch on page 3
+typedef struct LatchFlusher {
+  BM_BufferPool *bm;
+  RC result;
+} LatchFlusher;
+
+void *
+flushWhileLatched (void *arg)
+{
+  LatchFlusher *flusher = arg;
+
+  flusher->result = forceFlushPool(flusher->bm);
+  return NULL;
+}
+
+// shared and exclusive page latches: readers share a page, a writer keeps them out until it unpins
+void
+testPageLatches (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h1 = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .shards = 2 };
+  LatchReader reader;
+  LatchFlusher flusher;
+  SM_FileHandle fh;
+  char *data = malloc(PAGE_SIZE);
+  pthread_t thread;
+  int *fixCounts;
+  bool *dirty;
+  int writes;
+  testName = "Testing shared and exclusive page latches";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &options));
+  ASSERT_ERROR(pinPageLatched(bm, h1, 3, (BM_LatchMode) 7), "unknown latch mode");
+
+  // two shared latches on the same page are held at once
+  CHECK(pinPageLatched(bm, h1, 3, BM_LATCH_SHARED));
+  CHECK(pinPageLatched(bm, h2, 3, BM_LATCH_SHARED));
+  ASSERT_EQUALS_INT(BM_LATCH_SHARED, h2->latch, "handle records its latch");
+  CHECK(unpinPage(bm, h1, 3));
+  CHECK(unpinPage(bm, h2, 3));
+  ASSERT_EQUALS_INT(BM_LATCH_NONE, h2->latch, "unpin releases the latch");
+
+  // a reader started while the page is latched exclusively only sees the finished write
+  CHECK(pinPageLatched(bm, h1, 3, BM_LATCH_EXCLUSIVE));
+  strcpy(h1->data, "before");
+  reader.bm = bm;
+  pthread_create(&thread, NULL, readLatchedPage, &reader);
+  usleep(50000);
+  strcpy(h1->data, "written under latch");
+  CHECK(markDirty(bm, h1, 3));
+  CHECK(unpinPage(bm, h1, 3));
+  pthread_join(thread, NULL);
+  ASSERT_EQUALS_STRING("written under latch", reader.seen, "reader waited for the writer");
+
+  // the latch holder's own flush cannot write its page in change and says so, its handle forces the page instead
+  CHECK(pinPageLatched(bm, h1, 3, BM_LATCH_EXCLUSIVE));
+  CHECK(markDirty(bm, h1, 3));
+  writes = getNumWriteIO(bm);
+  ASSERT_ERROR(forceFlushPool(bm), "flush of a page latched by the flushing thread");
+  ASSERT_EQUALS_INT(writes, getNumWriteIO(bm), "page in change not written by the flush");
+  CHECK(forcePage(bm, h1, 3));
+  ASSERT_EQUALS_INT(writes + 1, getNumWriteIO(bm), "the latch holder forces its page");
+  CHECK(unpinPage(bm, h1, 3));
+  CHECK(forceFlushPool(bm));
+  dirty = getDirtyFlags(bm);
+  ASSERT_TRUE(!dirty[0] && !dirty[1] && !dirty[2] && !dirty[3], "flushed once the latch is released");
+  free(dirty);
+
+  // a flush in another thread waits for the writer and writes the finished page
+  CHECK(pinPageLatched(bm, h1, 3, BM_LATCH_EXCLUSIVE));
+  strcpy(h1->data, "half written");
+  CHECK(markDirty(bm, h1, 3));
+  flusher.bm = bm;
+  pthread_create(&thread, NULL, flushWhileLatched, &flusher);
+  usleep(50000);
+  strcpy(h1->data, "flushed after the write");
+  CHECK(unpinPage(bm, h1, 3));
+  pthread_join(thread, NULL);
+  CHECK(flusher.result);
+  CHECK(openPageFile("testbuffer.bin", &fh));
+  CHECK(readBlock(3, &fh, data));
+  ASSERT_EQUALS_STRING("flushed after the write", data, "flush waited for the latch");
+  CHECK(closePageFile(&fh));
+
+  // plain pins take no latch and mix with latched ones
+  CHECK(pinPage(bm, h1, 3));
+  CHECK(pinPageLatched(bm, h2, 3, BM_LATCH_EXCLUSIVE));
+  CHECK(unpinPage(bm, h2, 3));
+  CHECK(unpinPage(bm, h1, 3));
+  fixCounts = getFixCounts(bm);
+  ASSERT_EQUALS_INT(0, fixCounts[0] + fixCounts[1] + fixCounts[2] + fixCounts[3], "no page left pinned");
+  free(fixCounts);
+
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h1);
+  free(data);
+  free(h2);
+  TEST_DONE();
+}
+
+// wait until the pool has written numWrites pages, giving the background writer up to two seconds
+void
+waitForWrites (BM_BufferPool *bm, int numWrites)
+{
+  int i;
+  for (i = 0; i < 400 && getNumWriteIO(bm) < numWrites; i++)
+    usleep(5000);
+}
+
+// background writer: the next victims are written ahead of eviction, pages further back stay dirty
+void
+testBackgroundWriter (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .cleanFraction = 0.5, .cleanIntervalMs = 5 };
+  BM_PoolOptions tooMuch = { .cleanFraction = 1.5 };
+  PageNumber *contents;
+  bool *dirty;
+  int i;
+  testName = "Testing background writer of dirty pages";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  ASSERT_ERROR(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &tooMuch), "clean fraction above 1");
+
+  // 8 dirty pages, the writer keeps the 4 least recently used clean
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &options));
+  for (i = 0; i < 8; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h, i));
+      CHECK(unpinPage(bm, h, i));
+    }
+  waitForWrites(bm, 4);
+  usleep(20000);
+  ASSERT_EQUALS_INT(4, getNumWriteIO(bm), "only the next victims are written");
+
+  contents = getFrameContents(bm);
+  dirty = getDirtyFlags(bm);
+  for (i = 0; i < 8; i++)
+    ASSERT_TRUE(dirty[i] == (contents[i] >= 4), "pages 0-3 clean, pages 4-7 still dirty");
+  free(contents);
+  free(dirty);
+
+  // evicting the clean pages needs no write, afterwards pages 4-7 are next and get written
+  for (i = 8; i < 12; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      CHECK(unpinPage(bm, h, i));
+    }
+  ASSERT_EQUALS_INT(12, getNumReadIO(bm), "one read per page");
+  waitForWrites(bm, 8);
+  ASSERT_EQUALS_INT(8, getNumWriteIO(bm), "pages 4-7 written ahead of their eviction");
+  CHECK(shutdownBufferPool(bm));
+
+  // every page reached the file
+  CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < 8; i++)
+    {
+      char expected[32];
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page written by the background writer");
+      CHECK(unpinPage(bm, h, i));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// asynchronous prefetch: pages are read in the background and pinned without another read
+void
+testPrefetch (void)
+{
+  int i, totalFixCount;
+  int *fixCounts;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions options = { .shards = 2 };
+  PageNumber pageList[] = { 3, 1, 3, 2, -1, 1000 };
+  char expected[32];
+  testName = "Testing asynchronous prefetch";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 50);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+  CHECK(pinPage(bm, h, 0));
+  sprintf(h->data, "%s", "Dirty-0");
+  CHECK(markDirty(bm, h, h->pageNum));
+  CHECK(unpinPage(bm, h, h->pageNum));
+
+  // repeated and missing pages of the list are skipped, pins wait for the reads in flight
+  CHECK(prefetchPageList(bm, pageList, 6));
+  for (i = 1; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page loaded by prefetch");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "one read per prefetched page");
+
+  // a window larger than the pool stops once every frame is taken, the dirty victim is written first
+  CHECK(prefetchPages(bm, 10, 20));
+  for (i = 10; i < 18; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page loaded by prefetch");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  ASSERT_EQUALS_INT(12, getNumReadIO(bm), "pins of prefetched pages hit");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "dirty victim written back");
+  fixCounts = getFixCounts(bm);
+  for (i = 0, totalFixCount = 0; i < 8; i++)
+    totalFixCount += fixCounts[i];
+  ASSERT_EQUALS_INT(0, totalFixCount, "finished prefetches leave pages unpinned");
+  free(fixCounts);
+
+  // reads still in flight at shutdown are waited for
+  CHECK(prefetchPages(bm, 30, 5));
+  CHECK(shutdownBufferPool(bm));
+
+  // thread-safe pools load the pages right away
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &options));
+  CHECK(prefetchPages(bm, 0, 4));
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "sharded prefetch reads every page");
+  CHECK(pinPage(bm, h, 0));
+  ASSERT_EQUALS_STRING("Dirty-0", h->data, "victim written before its frame was reused");
+  CHECK(unpinPage(bm, h, h->pageNum));
+  ASSERT_EQUALS_INT(4, getNumReadIO(bm), "pin of a prefetched page hits");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// frames slice their pages from one aligned arena
+void
+testFrameArena (void)
+{
+  const int numFrames = 1000;
+  int i;
+  char *lowest = NULL, *highest = NULL;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char expected[32];
+  testName = "Testing the frame arena";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  CHECK(initBufferPool(bm, "testbuffer.bin", numFrames, RS_FIFO, NULL));
+
+  for (i = 0; i < numFrames; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      ASSERT_TRUE(((size_t) h->data % 4096) == 0, "page data aligned for direct I/O");
+      if (lowest == NULL || h->data < lowest)
+        lowest = h->data;
+      if (highest == NULL || h->data > highest)
+        highest = h->data;
+      sprintf(h->data, "%s-%i", "Page", i);
+      CHECK(markDirty(bm, h, h->pageNum));
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  ASSERT_TRUE(highest - lowest == (long) (numFrames - 1) * PAGE_SIZE, "pages of all frames are contiguous");
+  CHECK(shutdownBufferPool(bm));
+
+  // the pages written from the arena read back in a new pool
+  CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_FIFO, NULL));
+  for (i = 0; i < numFrames; i += 111)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page written from the arena");
+      CHECK(unpinPage(bm, h, h->pageNum));
+    }
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// growing and shrinking open pools under every strategy
+void
+testResize (void)
+{
+  int k = 2;
+  BM_PoolOptions sharded = { .shards = 2 };
+  BM_PoolOptions cleaned = { .cleanFraction = 0.5, .cleanIntervalMs = 1 };
+  testName = "Testing online pool resizing";
+
+  resizeWithStrategy(RS_FIFO, NULL, NULL);
+  resizeWithStrategy(RS_LRU, NULL, NULL);
+  resizeWithStrategy(RS_CLOCK, NULL, NULL);
+  resizeWithStrategy(RS_LRU_K, &k, NULL);
+  resizeWithStrategy(RS_2Q, NULL, NULL);
+  resizeWithStrategy(RS_ARC, NULL, NULL);
+  resizeWithStrategy(RS_LFU, NULL, NULL);
+  resizeWithStrategy(RS_LRU, NULL, &sharded);
+  resizeWithStrategy(RS_CLOCK, NULL, &cleaned);
+
+  TEST_DONE();
+}
+
+void
+resizeWithStrategy (ReplacementStrategy strategy, void *stratData, BM_PoolOptions *options)
+{
+  int i, empty, numReads, numShards = (options != NULL && options->shards > 0) ? options->shards : 1;
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *held = MAKE_PAGE_HANDLE();
+  PageNumber *frameContents;
+  char expected[32];
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 40);
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, strategy, stratData, options));
+
+  // page 0 stays pinned through every resize, its handle keeps pointing at the same data
+  CHECK(pinPage(bm, held, 0));
+  for (i = 1; i < 4; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Resized", i);
+      CHECK(markDirty(bm, h, i));
+      CHECK(unpinPage(bm, h, i));
+    }
+
+  // growing keeps every resident page and adds empty frames
+  frameContents = getFrameContents(bm);
+  for (i = 0, empty = 0; i < 4; i++)
+    empty += (frameContents[i] == NO_PAGE) ? 1 : 0;
+  free(frameContents);
+  CHECK(resizeBufferPool(bm, 8));
+  ASSERT_EQUALS_INT(8, bm->numPages, "pool grew");
+  frameContents = getFrameContents(bm);
+  for (i = 0; i < 8; i++)
+    empty -= (frameContents[i] == NO_PAGE) ? 1 : 0;
+  ASSERT_EQUALS_INT(-4, empty, "new frames start empty");
+  numReads = getNumReadIO(bm);
+  for (i = 0; i < 8; i++)
+    if (frameContents[i] != NO_PAGE)
+      {
+        CHECK(pinPage(bm, h, frameContents[i]));
+        CHECK(unpinPage(bm, h, frameContents[i]));
+      }
+  ASSERT_EQUALS_INT(numReads, getNumReadIO(bm), "pages resident before the resize are still hits");
+  free(frameContents);
+
+  // shrinking writes back the dirty pages it evicts, the pinned page stays
+  CHECK(resizeBufferPool(bm, numShards));
+  ASSERT_EQUALS_INT(numShards, bm->numPages, "pool shrank");
+  ASSERT_EQUALS_STRING("Page-0", held->data, "pinned page kept its frame");
+  ASSERT_EQUALS_INT(RC_WRITE_FAILED, resizeBufferPool(bm, 0), "a pool needs a frame");
+  if (numShards == 1)
+    {
+      // pinned pages cannot be evicted, a shrink that would need them fails and changes nothing
+      CHECK(resizeBufferPool(bm, 3));
+      CHECK(pinPage(bm, h, 1));
+      ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, resizeBufferPool(bm, 1), "pinned frames stay");
+      ASSERT_EQUALS_INT(3, bm->numPages, "failed shrink keeps the size");
+      CHECK(unpinPage(bm, h, 1));
+    }
+
+  // growing again reuses the frames given up, pages read back through the resized pool
+  CHECK(resizeBufferPool(bm, 6));
+  for (i = 1; i < 40; i++)
+    {
+      CHECK(pinPage(bm, h, i));
+      if (i < 4)
+        sprintf(expected, "%s-%i", "Resized", i);
+      else
+        sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page content survives resizing");
+      CHECK(unpinPage(bm, h, i));
+    }
+  CHECK(unpinPage(bm, held, 0));
+  CHECK(shutdownBufferPool(bm));
+  CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  free(held);
+}
+
+// number of frames a pool's pages are in
+int
+residentPages (BM_BufferPool *bm)
+{
+  PageNumber *contents = getFrameContents(bm);
+  int i, resident = 0;
+
+  for (i = 0; i < bm->numPages; i++)
+    if (contents[i] != NO_PAGE)
+      resident++;
+
+  free(contents);
+  return resident;
+}
+
+// one process-wide pool for two files: keys by file and page, quotas, per-file flushes and I/O counters
+void
+testSharedPool (void)
+{
+  BM_BufferPool *table = MAKE_POOL();
+  BM_BufferPool *index = MAKE_POOL();
+  BM_BufferPool *other = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *g = MAKE_PAGE_HANDLE();
+  BM_PoolOptions shared = { .shared = true };
+  BM_PoolOptions limited = { .shared = true, .quota = 2 };
+  BM_PoolOptions sharded = { .shards = 2 };
+  ShardWorker workers[2];
+  pthread_t threads[2];
+  char expected[32];
+  int i;
+  testName = "Testing the process-wide shared buffer pool";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(table, 20);
+  CHECK(createPageFile("testshared.bin"));
+  CHECK(initBufferPool(index, "testshared.bin", 3, RS_FIFO, NULL));
+  for (i = 0; i < 20; i++)
+    {
+      CHECK(pinPage(index, h, i));
+      sprintf(h->data, "%s-%i", "Other", i);
+      CHECK(markDirty(index, h, i));
+      CHECK(unpinPage(index, h, i));
+    }
+  CHECK(shutdownBufferPool(index));
+
+  // 6 frames for both files, the index may take at most 2 of them
+  CHECK(initSharedBufferPool(6, RS_LRU, NULL, NULL));
+  ASSERT_ERROR(initSharedBufferPool(6, RS_LRU, NULL, NULL), "one shared pool per process");
+  CHECK(initBufferPoolWithOptions(table, "testbuffer.bin", 100, RS_FIFO, NULL, &shared));
+  CHECK(initBufferPoolWithOptions(index, "testshared.bin", 100, RS_FIFO, NULL, &limited));
+  ASSERT_EQUALS_INT(6, table->numPages, "a file sees every frame of the shared pool");
+
+  // the same page number of two files are two pages
+  CHECK(pinPage(table, h, 0));
+  CHECK(pinPage(index, g, 0));
+  ASSERT_EQUALS_STRING("Page-0", h->data, "table page read through its own file");
+  ASSERT_EQUALS_STRING("Other-0", g->data, "index page read through its own file");
+  ASSERT_EQUALS_INT(0, (int)g->pageNum, "handles carry the file's page number");
+  CHECK(unpinPage(table, h, 0));
+  CHECK(unpinPage(index, g, 0));
+
+  // the index at its quota replaces its own pages and leaves the table's alone
+  for (i = 1; i < 4; i++)
+    pinAndUnpin(table, i);
+  for (i = 1; i < 10; i++)
+    {
+      CHECK(pinPage(index, g, i));
+      sprintf(expected, "%s-%i", "Other", i);
+      ASSERT_EQUALS_STRING(expected, g->data, "index pages read back");
+      CHECK(unpinPage(index, g, i));
+    }
+  ASSERT_EQUALS_INT(2, residentPages(index), "index held to its quota");
+  ASSERT_EQUALS_INT(4, residentPages(table), "table pages stay");
+  ASSERT_EQUALS_INT(10, getNumReadIO(index), "I/O counted per file");
+  ASSERT_EQUALS_INT(4, getNumReadIO(table), "I/O counted per file");
+  CHECK(readAheadPages(index, 10, 5));
+  ASSERT_EQUALS_INT(2, residentPages(index), "read-ahead keeps to the quota");
+
+  // a lower quota evicts right away, dirty pages are written back first
+  CHECK(pinPage(index, g, 9));
+  sprintf(g->data, "%s", "Changed-9");
+  CHECK(markDirty(index, g, 9));
+  ASSERT_ERROR(resizeBufferPool(index, 0), "a quota needs a frame");
+  CHECK(unpinPage(index, g, 9));
+  CHECK(resizeBufferPool(index, 1));
+  ASSERT_EQUALS_INT(1, residentPages(index), "quota lowered");
+
+  // without a quota the table takes over the frames the index left and the one it no longer uses
+  for (i = 4; i < 20; i++)
+    pinAndUnpin(table, i);
+  ASSERT_EQUALS_INT(6, residentPages(table), "cold index frames serve the table");
+  ASSERT_EQUALS_INT(0, residentPages(index), "index pages replaced");
+
+  // leaving the pool writes back and drops only the file's own pages
+  ASSERT_ERROR(shutdownSharedBufferPool(), "files still registered");
+  CHECK(shutdownBufferPool(index));
+  ASSERT_EQUALS_INT(6, residentPages(table), "table pages stay when the index leaves");
+  CHECK(initBufferPool(other, "testshared.bin", 3, RS_FIFO, NULL));
+  CHECK(pinPage(other, g, 9));
+  ASSERT_EQUALS_STRING("Changed-9", g->data, "dirty index page reached its file");
+  CHECK(unpinPage(other, g, 9));
+  CHECK(shutdownBufferPool(other));
+  CHECK(shutdownBufferPool(table));
+  CHECK(shutdownSharedBufferPool());
+  ASSERT_ERROR(shutdownSharedBufferPool(), "no shared pool running");
+
+  // without a shared pool, files that ask for one get frames of their own
+  CHECK(initBufferPoolWithOptions(table, "testbuffer.bin", 3, RS_FIFO, NULL, &shared));
+  ASSERT_EQUALS_INT(3, table->numPages, "private pool");
+  CHECK(shutdownBufferPool(table));
+
+  // a thread-safe shared pool serves both files from concurrent threads
+  CHECK(initSharedBufferPool(4, RS_CLOCK, NULL, &sharded));
+  CHECK(initBufferPoolWithOptions(table, "testbuffer.bin", 1, RS_FIFO, NULL, &shared));
+  CHECK(initBufferPoolWithOptions(index, "testshared.bin", 1, RS_FIFO, NULL, &shared));
+  workers[0] = (ShardWorker) { .bm = table, .firstPage = 0, .numPages = 20 };
+  workers[1] = (ShardWorker) { .bm = index, .firstPage = 0, .numPages = 20 };
+  for (i = 0; i < 2; i++)
+    pthread_create(&threads[i], NULL, writeOwnPages, &workers[i]);
+  for (i = 0; i < 2; i++)
+    {
+      pthread_join(threads[i], NULL);
+      ASSERT_EQUALS_INT(0, workers[i].mismatches, "every file reads back its own pages");
+    }
+  CHECK(shutdownBufferPool(index));
+  CHECK(shutdownBufferPool(table));
+  CHECK(shutdownSharedBufferPool());
+  checkDummyPages(table, 20);
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  CHECK(destroyPageFile("testshared.bin"));
+  free(table);
+  free(index);
+  free(other);
+  free(h);
+  free(g);
+  TEST_DONE();
+}
+
+// hits, misses, evictions and latencies of a pool, and the layouts they are printed and dumped in
+void
+testPoolStats (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions timed = { .pinTiming = true };
+  BM_PoolOptions sharded = { .shards = 2 };
+  BM_LatencyHistogram histogram = { 0 };
+  BM_PoolStats stats;
+  char line[4096];
+  char *text;
+  FILE *dump;
+  int i;
+  testName = "Testing buffer pool statistics";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+
+  // FIFO with 3 frames: pages 0 to 2 are read, 1 is made dirty, 0 and 1 are hits, then 3 and 4 replace 0 and 1
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_FIFO, NULL, &timed));
+  ASSERT_ERROR(getBufferPoolStats(bm, NULL), "stats need somewhere to go");
+  for (i = 0; i < 3; i++)
+    pinAndUnpin(bm, i);
+  CHECK(pinPage(bm, h, 1));
+  CHECK(markDirty(bm, h, 1));
+  CHECK(unpinPage(bm, h, 1));
+  pinAndUnpin(bm, 0);
+  pinAndUnpin(bm, 3);
+  pinAndUnpin(bm, 4);
+  CHECK(forceFlushPool(bm));
+  CHECK(getBufferPoolStats(bm, &stats));
+  ASSERT_EQUALS_INT(2, (int)stats.hits, "pins of resident pages");
+  ASSERT_EQUALS_INT(5, (int)stats.misses, "pins that read their page");
+  ASSERT_TRUE(stats.hitRatio > 0.285 && stats.hitRatio < 0.286, "hit ratio");
+  ASSERT_EQUALS_INT(1, (int)stats.cleanEvictions, "page 0 replaced without a write");
+  ASSERT_EQUALS_INT(1, (int)stats.dirtyEvictions, "page 1 written back first");
+  ASSERT_EQUALS_INT(5, stats.readIO, "reads as getNumReadIO");
+  ASSERT_EQUALS_INT(1, stats.writeIO, "writes as getNumWriteIO");
+  ASSERT_EQUALS_INT(2, (int)stats.pinHit.count, "hits timed");
+  ASSERT_EQUALS_INT(5, (int)stats.pinMiss.count, "misses timed");
+  ASSERT_EQUALS_INT(1, (int)stats.flush.count, "flush timed");
+  ASSERT_TRUE(stats.pinMiss.maxNanos > 0 && stats.pinMiss.totalNanos >= stats.pinMiss.maxNanos, "miss latency");
+
+  // machine-readable layouts
+  text = sprintPoolStats(bm, BM_STATS_JSON);
+  ASSERT_TRUE(strncmp(text, "{\"hits\":2,\"misses\":5,", 21) == 0, "JSON object");
+  ASSERT_TRUE(strstr(text, "\"pin_miss\":{\"count\":5,") != NULL, "JSON histogram");
+  free(text);
+  text = sprintPoolStats(bm, BM_STATS_CSV);
+  ASSERT_TRUE(strncmp(text, "hits,misses,hit_ratio,", 22) == 0, "CSV header");
+  ASSERT_TRUE(strstr(text, "\n2,5,0.285714,1,1,") != NULL, "CSV row");
+  free(text);
+  unlink("teststats.csv");
+  CHECK(dumpPoolStats(bm, "teststats.csv", BM_STATS_CSV));
+  pinAndUnpin(bm, 4);
+  CHECK(dumpPoolStats(bm, "teststats.csv", BM_STATS_CSV));
+  dump = fopen("teststats.csv", "r");
+  ASSERT_TRUE(fgets(line, sizeof(line), dump) != NULL && strncmp(line, "hits,", 5) == 0, "header written once");
+  ASSERT_TRUE(fgets(line, sizeof(line), dump) != NULL && strncmp(line, "2,5,", 4) == 0, "first sample");
+  ASSERT_TRUE(fgets(line, sizeof(line), dump) != NULL && strncmp(line, "3,5,", 4) == 0, "second sample");
+  ASSERT_TRUE(fgets(line, sizeof(line), dump) == NULL, "one row per dump");
+  fclose(dump);
+  unlink("teststats.csv");
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_ERROR(getBufferPoolStats(bm, &stats), "pool closed");
+
+  // percentiles report the upper bound of their bucket, at most the largest latency seen
+  histogram.buckets[3] = 99;
+  histogram.buckets[10] = 1;
+  histogram.count = 100;
+  histogram.maxNanos = 1500;
+  ASSERT_EQUALS_INT(15, (int)latencyPercentile(&histogram, 0.5), "p50 in the 8-15 ns bucket");
+  ASSERT_EQUALS_INT(15, (int)latencyPercentile(&histogram, 0.99), "p99 in the 8-15 ns bucket");
+  ASSERT_EQUALS_INT(1500, (int)latencyPercentile(&histogram, 1.0), "p100 is the maximum");
+
+  // thread-safe pools add up their shards, pins are not timed unless asked for
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &sharded));
+  for (i = 0; i < 4; i++)
+    pinAndUnpin(bm, i);
+  for (i = 0; i < 4; i++)
+    pinAndUnpin(bm, i);
+  CHECK(getBufferPoolStats(bm, &stats));
+  ASSERT_EQUALS_INT(8, (int)(stats.hits + stats.misses), "every pin counted once");
+  ASSERT_EQUALS_INT(stats.readIO, (int)stats.misses, "a miss per read");
+  ASSERT_EQUALS_INT(0, (int)stats.pinHit.count, "pins not timed");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// records of a trace file after its magic, -1 if the magic is missing
+long
+readTrace (const char *fileName, unsigned long long *records, int maxRecords)
+{
+  FILE *file = fopen(fileName, "rb");
+  char magic[8];
+  long numRecords = -1;
+
+  if (file == NULL)
+    return -1;
+  if (fread(magic, 1, 8, file) == 8 && memcmp(magic, BM_TRACE_MAGIC, 8) == 0)
+    numRecords = fread(records, sizeof(unsigned long long), maxRecords, file);
+  fclose(file);
+  return numRecords;
+}
+
+// pins, unpins and markDirty calls that succeed are traced, in order
+void
+testPoolTrace (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions traced = { .traceFile = "testtrace.bin" };
+  BM_PoolOptions sharded = { .shards = 2 };
+  unsigned long long records[8];
+  testName = "Testing page-access traces";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 5);
+
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 3, RS_LRU, NULL, &traced));
+  ASSERT_ERROR(startPoolTrace(bm, "testtrace2.bin"), "one trace at a time");
+  CHECK(pinPage(bm, h, 0));
+  CHECK(markDirty(bm, h, 0));
+  CHECK(unpinPage(bm, h, 0));
+  ASSERT_ERROR(pinPage(bm, h, -1), "failed pins are not traced");
+  ASSERT_ERROR(unpinPage(bm, h, 4), "failed unpins are not traced");
+  pinAndUnpin(bm, 3);
+  CHECK(stopPoolTrace(bm));
+  ASSERT_ERROR(stopPoolTrace(bm), "no trace taken");
+  pinAndUnpin(bm, 2);
+
+  ASSERT_EQUALS_INT(5, (int) readTrace("testtrace.bin", records, 8), "one record per call");
+  ASSERT_TRUE(records[0] == BM_TRACE_RECORD(BM_TRACE_PIN, 0), "pin of page 0");
+  ASSERT_TRUE(records[1] == BM_TRACE_RECORD(BM_TRACE_DIRTY, 0), "page 0 made dirty");
+  ASSERT_TRUE(records[2] == BM_TRACE_RECORD(BM_TRACE_UNPIN, 0), "unpin of page 0");
+  ASSERT_EQUALS_INT(BM_TRACE_PIN, BM_TRACE_OP(records[3]), "pin of page 3");
+  ASSERT_EQUALS_INT(3, (int) BM_TRACE_PAGE(records[3]), "pin of page 3");
+  ASSERT_EQUALS_INT(BM_TRACE_UNPIN, BM_TRACE_OP(records[4]), "unpin of page 3");
+  CHECK(shutdownBufferPool(bm));
+
+  // thread-safe pools trace through the pool, shutting down ends the trace
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_CLOCK, NULL, &sharded));
+  CHECK(startPoolTrace(bm, "testtrace.bin"));
+  pinAndUnpin(bm, 1);
+  pinAndUnpin(bm, 2);
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_EQUALS_INT(4, (int) readTrace("testtrace.bin", records, 8), "trace written at shutdown");
+  ASSERT_TRUE(records[2] == BM_TRACE_RECORD(BM_TRACE_PIN, 2), "pins of every shard");
+
+  unlink("testtrace.bin");
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// CLOCK keeps a working set that fits, the reference bits survive unpins and the hand moves on after each victim
+void
+testClockHitRatio (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PoolStats stats;
+  int round, i;
+  testName = "Testing CLOCK hit ratio";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 12);
+
+  CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_CLOCK, NULL));
+  for (round = 0; round < 10; round++)
+    {
+      for (i = 0; i < 6; i++)
+        {
+          pinAndUnpin(bm, i);
+        }
+    }
+  ASSERT_EQUALS_INT(6, getNumReadIO(bm), "each page of the working set is read once");
+  CHECK(getBufferPoolStats(bm, &stats));
+  ASSERT_TRUE(stats.hitRatio > 0.899 && stats.hitRatio < 0.901, "hit ratio");
+
+  // with every bit set the hand clears them all and replaces the page it started from, then moves on to the next one
+  pinAndUnpin(bm, 6);
+  pinAndUnpin(bm, 7);
+  pinAndUnpin(bm, 8);
+  ASSERT_TRUE(!poolHolds(bm, 0) && poolHolds(bm, 1), "page under the hand replaced");
+  pinAndUnpin(bm, 9);
+  ASSERT_TRUE(!poolHolds(bm, 1) && poolHolds(bm, 2) && poolHolds(bm, 8), "next page replaced");
+  CHECK(shutdownBufferPool(bm));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  TEST_DONE();
+}
+
+// a scan through a ring only replaces its own pages once it is past the first ones, hot pages stay resident
+void
+testScanRing (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_ScanRing ring;
+  BM_PoolStats stats;
+  BM_PoolOptions sharded = { .shards = 2 };
+  int i, round;
+  testName = "Testing frame rings of sequential scans";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 200);
+
+  for (round = 0; round < 4; round++)
+    {
+      // LRU takes the ring's frames from the front of the pool, CLOCK from its hand
+      CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 24, (round < 2) ? RS_LRU : RS_CLOCK, NULL,
+                                      (round % 2 == 0) ? NULL : &sharded));
+      ASSERT_ERROR(initScanRing(bm, &ring, 0), "a ring needs frames");
+
+      // pages 190 to 193 are hot and page 194 is dirty, the scan takes the other frames
+      for (i = 190; i < 195; i++)
+        pinAndUnpin(bm, i);
+      CHECK(pinPage(bm, h, 194));
+      CHECK(markDirty(bm, h, 194));
+      CHECK(unpinPage(bm, h, 194));
+
+      CHECK(initScanRing(bm, &ring, 4));
+      for (i = 0; i < 150; i++)
+        {
+          if (i % 8 == 0)
+            {
+              CHECK(prefetchRingPages(&ring, i, 8));
+            }
+          CHECK(pinPageInRing(&ring, h, i, BM_LATCH_SHARED));
+          CHECK(pinPageInRing(&ring, h, i, BM_LATCH_NONE)); // repins of the current page count once
+          CHECK(unpinPage(bm, h, i));
+          CHECK(unpinPage(bm, h, i));
+        }
+      CHECK(closeScanRing(&ring));
+      ASSERT_ERROR(pinPageInRing(&ring, h, 0, BM_LATCH_NONE), "closed ring");
+
+      for (i = 190; i < 195; i++)
+        {
+          ASSERT_TRUE(poolHolds(bm, i), "hot and dirty pages survive the scan");
+        }
+      ASSERT_TRUE(poolHolds(bm, 149) && poolHolds(bm, 146), "last pages of the scan stay resident");
+      ASSERT_TRUE(!poolHolds(bm, 100), "pages behind the ring are dropped");
+      CHECK(getBufferPoolStats(bm, &stats));
+      ASSERT_EQUALS_INT(0, (int) stats.dirtyEvictions, "no dirty page written back for the scan");
+
+      // a page the pool held before the scan is left to the strategy
+      CHECK(initScanRing(bm, &ring, 1));
+      for (i = 190; i < 193; i++)
+        {
+          CHECK(pinPageInRing(&ring, h, i, BM_LATCH_NONE));
+          CHECK(unpinPage(bm, h, i));
+        }
+      CHECK(closeScanRing(&ring));
+      ASSERT_TRUE(poolHolds(bm, 190) && poolHolds(bm, 191), "resident pages stay");
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// handles refer to the frame of their pin until the frame takes another page, other handles still work by page number
+void
+testFrameHandles (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h1 = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  BM_PoolOptions sharded = { .shards = 2 };
+  int *fixCounts;
+  int round, writes;
+  testName = "Testing frame references of page handles";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 10);
+
+  for (round = 0; round < 2; round++)
+    {
+      CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, (round == 0) ? NULL : &sharded));
+      h1->latch = BM_LATCH_EXCLUSIVE;
+      ASSERT_ERROR(pinPage(bm, h1, -1), "failed pin");
+      ASSERT_EQUALS_INT(-1, h1->frame, "a failed pin refers to no frame");
+      ASSERT_EQUALS_INT(BM_LATCH_NONE, h1->latch, "a failed pin holds no latch");
+
+      // the handle of the pin finds the frame, another handle of the same page too
+      CHECK(pinPage(bm, h1, 0));
+      CHECK(pinPage(bm, h2, 0));
+      ASSERT_TRUE(h1->frame >= 0 && h1->frame == h2->frame, "pins of a page refer to its frame");
+      CHECK(markDirty(bm, h1, 0));
+      CHECK(unpinPage(bm, h1, 0));
+      CHECK(pinPage(bm, h1, 1));
+      CHECK(unpinPage(bm, h1, 0)); // refers to page 1, so page 0 is looked up
+      CHECK(unpinPage(bm, h1, 1));
+      ASSERT_ERROR(unpinPage(bm, h1, 1), "page is no longer pinned");
+
+      // page 0 leaves and comes back, the handle of its first pin is ignored
+      h2->frame = h1->frame;
+      h2->generation = h1->generation;
+      pinAndUnpin(bm, 2);
+      pinAndUnpin(bm, 3);
+      pinAndUnpin(bm, 4);
+      pinAndUnpin(bm, 5);
+      pinAndUnpin(bm, 6);
+      ASSERT_ERROR(markDirty(bm, h2, 1), "stale handle of a page that is not resident");
+      CHECK(pinPage(bm, h1, 1));
+      ASSERT_TRUE(h1->generation != h2->generation || h1->frame != h2->frame, "reloaded page has a new generation");
+      CHECK(unpinPage(bm, h2, 1));
+      fixCounts = getFixCounts(bm);
+      ASSERT_EQUALS_INT(0, fixCounts[0] + fixCounts[1] + fixCounts[2] + fixCounts[3], "stale handle unpins by page");
+      free(fixCounts);
+
+      // forcePage writes through the frame of the handle's pin, a handle without one through the page's frame
+      CHECK(pinPage(bm, h1, 7));
+      *h2 = *h1;
+      h2->frame = -1;
+      writes = getNumWriteIO(bm);
+      CHECK(forcePage(bm, h1, 7));
+      CHECK(forcePage(bm, h2, 7));
+      ASSERT_EQUALS_INT(writes + 2, getNumWriteIO(bm), "both handles force the page");
+      CHECK(unpinPage(bm, h1, 7));
+
+      // handles from outside the directory are looked up as well
+      CHECK(pinPage(bm, h1, 6));
+      h2->frame = 1 << 20;
+      CHECK(unpinPage(bm, h2, 6));
+      CHECK(shutdownBufferPool(bm));
+    }
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h1);
+  free(h2);
+  TEST_DONE();
+}
+
+// pools opened with warmRestart start with the hottest pages of their last shutdown that fit
+void
+testWarmRestart (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolOptions warm = { .warmRestart = true };
+  BM_PoolOptions warmSharded = { .warmRestart = true, .shards = 2 };
+  int i;
+  testName = "Testing warm restarts of buffer pools";
+
+  CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, 20);
+  ASSERT_TRUE(access("testbuffer.bin.warm", F_OK) != 0, "pools without the option save nothing");
+
+  // pages 2 to 9 are resident at shutdown, page 3 was used last
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &warm));
+  ASSERT_EQUALS_INT(0, residentPages(bm), "no saved pages yet");
+  for (i = 0; i < 10; i++)
+    pinAndUnpin(bm, i);
+  pinAndUnpin(bm, 3);
+  CHECK(shutdownBufferPool(bm));
+  ASSERT_TRUE(access("testbuffer.bin.warm", F_OK) == 0, "resident pages saved next to the file");
+
+  // a smaller pool takes the hottest ones
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 4, RS_LRU, NULL, &warm));
+  ASSERT_EQUALS_INT(4, residentPages(bm), "as many saved pages as fit");
+  ASSERT_TRUE(poolHolds(bm, 3) && poolHolds(bm, 9) && poolHolds(bm, 8) && poolHolds(bm, 7), "hottest pages loaded");
+  CHECK(pinPage(bm, h, 7));
+  ASSERT_EQUALS_STRING("Page-7", h->data, "preloaded page has its content");
+  CHECK(unpinPage(bm, h, 7));
+  CHECK(shutdownBufferPool(bm));
+
+  // thread-safe pools read the pages back in the background
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_CLOCK, NULL, &warmSharded));
+  for (i = 0; i < 100 && residentPages(bm) < 4; i++)
+    usleep(10000);
+  ASSERT_TRUE(poolHolds(bm, 3) && poolHolds(bm, 7), "loader thread reads the saved pages");
+  CHECK(shutdownBufferPool(bm));
+
+  // without a saved list the pool starts cold
+  CHECK(discardWarmPages("testbuffer.bin"));
+  ASSERT_TRUE(access("testbuffer.bin.warm", F_OK) != 0, "saved pages discarded");
+  CHECK(initBufferPoolWithOptions(bm, "testbuffer.bin", 8, RS_LRU, NULL, &warm));
+  ASSERT_EQUALS_INT(0, residentPages(bm), "nothing to load");
+  CHECK(shutdownBufferPool(bm));
+  CHECK(discardWarmPages("testbuffer.bin"));
+
+  CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}